@@ -167,6 +167,14 @@ void EventManager::poll_events() {
                     }
                 }
 
+                // Control-Alt-A: adaptive virtual time toggle
+                if (event.key.keysym.sym == SDLK_a && (event.key.keysym.mod & KMOD_ALL) == (KMOD_LCTRL | KMOD_LALT)) {
+                    if (event.type == SDL_KEYUP && !is_deterministic) {
+                        bool adaptive_status = toggle_adaptive_time();
+                        LOG_F(INFO, "adaptive time: %s", adaptive_status ? "enabled" : "disabled");
+                    }
+                }
+
                 // Control-L: log toggle
                 if (event.key.keysym.sym == SDLK_l && (event.key.keysym.mod & KMOD_ALL) == KMOD_LCTRL) {
                     if (event.type == SDL_KEYUP) {
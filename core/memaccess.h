@@ -30,6 +30,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <loguru.hpp>
 
 #include <cinttypes>
+#include <cstring>
 
 #if defined(WORDS_BIGENDIAN) || defined(__BIG_ENDIAN__)
 #undef __BIG_ENDIAN__
@@ -159,6 +160,64 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #endif // __BIG_ENDIAN__
 
+/* Access a value of type T at a possibly misaligned host address using
+   a single host load/store. A constant-sized memcpy is translated into
+   one unaligned move by all supported compilers, in contrast to the
+   bytewise *_U macros above. */
+template <class T>
+inline T read_host_u(const uint8_t* addr) {
+    T val;
+    std::memcpy(&val, addr, sizeof(T));
+    return val;
+}
+
+template <class T>
+inline void write_host_u(uint8_t* addr, T val) {
+    std::memcpy(addr, &val, sizeof(T));
+}
+
+template <class T>
+inline T byteswap_sized(T val) {
+    if constexpr (sizeof(T) == 2)
+        return BYTESWAP_16(val);
+    else if constexpr (sizeof(T) == 4)
+        return BYTESWAP_32(val);
+    else if constexpr (sizeof(T) == 8)
+        return BYTESWAP_64(val);
+    else
+        return val;
+}
+
+/* read an unaligned big-endian value with a single host load */
+template <class T>
+inline T read_be_host_u(const uint8_t* addr) {
+#ifdef __LITTLE_ENDIAN__
+    return byteswap_sized<T>(read_host_u<T>(addr));
+#else
+    return read_host_u<T>(addr);
+#endif
+}
+
+/* read an unaligned little-endian value with a single host load */
+template <class T>
+inline T read_le_host_u(const uint8_t* addr) {
+#ifdef __LITTLE_ENDIAN__
+    return read_host_u<T>(addr);
+#else
+    return byteswap_sized<T>(read_host_u<T>(addr));
+#endif
+}
+
+/* write an unaligned big-endian value with a single host store */
+template <class T>
+inline void write_be_host_u(uint8_t* addr, T val) {
+#ifdef __LITTLE_ENDIAN__
+    write_host_u<T>(addr, byteswap_sized<T>(val));
+#else
+    write_host_u<T>(addr, val);
+#endif
+}
+
 /* read an aligned native-endian DWORD */
 #define READ_DWORD_NE_A READ_DWORD_LE_A // native-endian = little-endian for now
 
@@ -24,25 +24,182 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <loguru.hpp>
 #include "timermanager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <memory>
-#include <mutex>
 
 TimerManager* TimerManager::timer_manager;
 
-uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb)
+TimerInfo* TimerQueue::alloc()
 {
-    TimerInfo* ti = new TimerInfo;
+    if (this->free_head == TIMER_NOT_QUEUED) {
+        // grow the descriptor pool by one chunk
+        if (this->num_slots >= TIMER_MAX_SLOTS) {
+            ABORT_F("TimerQueue: too many timers");
+        }
+        this->chunks.emplace_back(new TimerInfo[TIMER_CHUNK_SIZE]);
+        TimerInfo* chunk = this->chunks.back().get();
+        for (int i = TIMER_CHUNK_SIZE - 1; i >= 0; i--) {
+            chunk[i].id        = 0;
+            chunk[i].heap_pos  = TIMER_NOT_QUEUED;
+            chunk[i].slot      = this->num_slots + i;
+            chunk[i].gen       = 1;
+            chunk[i].next_free = this->free_head;
+            this->free_head    = chunk[i].slot;
+        }
+        this->num_slots += TIMER_CHUNK_SIZE;
+        this->heap.reserve(this->num_slots);
+    }
+
+    TimerInfo* ti = &this->chunks[this->free_head / TIMER_CHUNK_SIZE]
+                                 [this->free_head % TIMER_CHUNK_SIZE];
+    this->free_head = ti->next_free;
+    ti->id = (ti->gen << TIMER_SLOT_BITS) | ti->slot;
+    return ti;
+}
+
+void TimerQueue::release(TimerInfo* ti)
+{
+    if (ti->heap_pos != TIMER_NOT_QUEUED)
+        this->remove(ti);
+
+    ti->id = 0;
+    ti->cb = nullptr;
+    // bump the generation so that stale handles won't match anymore
+    ti->gen = (ti->gen + 1) & TIMER_GEN_MASK;
+    if (!ti->gen)
+        ti->gen = 1;
+    ti->next_free   = this->free_head;
+    this->free_head = ti->slot;
+}
+
+TimerInfo* TimerQueue::find(uint32_t id)
+{
+    uint32_t slot = id & (TIMER_MAX_SLOTS - 1);
+
+    if (!id || slot >= this->num_slots)
+        return nullptr;
+
+    TimerInfo* ti = &this->chunks[slot / TIMER_CHUNK_SIZE][slot % TIMER_CHUNK_SIZE];
+    return ti->id == id ? ti : nullptr;
+}
+
+void TimerQueue::push(TimerInfo* ti)
+{
+    this->heap.push_back(ti);
+    ti->heap_pos = static_cast<uint32_t>(this->heap.size() - 1);
+    this->sift_up(ti->heap_pos);
+}
+
+void TimerQueue::remove(TimerInfo* ti)
+{
+    uint32_t pos  = ti->heap_pos;
+    TimerInfo* last = this->heap.back();
+
+    this->heap.pop_back();
+    ti->heap_pos = TIMER_NOT_QUEUED;
+
+    if (last != ti) {
+        this->place(last, pos);
+        if (pos > 0 && earlier(last, this->heap[(pos - 1) >> 1]))
+            this->sift_up(pos);
+        else
+            this->sift_down(pos);
+    }
+}
+
+void TimerQueue::reschedule(TimerInfo* ti, uint64_t timeout_ns)
+{
+    uint64_t old_timeout = ti->timeout_ns;
+
+    ti->timeout_ns = timeout_ns;
+
+    if (timeout_ns < old_timeout)
+        this->sift_up(ti->heap_pos);
+    else
+        this->sift_down(ti->heap_pos);
+}
+
+void TimerQueue::sift_up(uint32_t pos)
+{
+    TimerInfo* ti = this->heap[pos];
+
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) >> 1;
+        if (!earlier(ti, this->heap[parent]))
+            break;
+        this->place(this->heap[parent], pos);
+        pos = parent;
+    }
+    this->place(ti, pos);
+}
+
+void TimerQueue::sift_down(uint32_t pos)
+{
+    TimerInfo* ti = this->heap[pos];
+    uint32_t   size = static_cast<uint32_t>(this->heap.size());
+
+    while (true) {
+        uint32_t child = (pos << 1) + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && earlier(this->heap[child + 1], this->heap[child]))
+            child++;
+        if (!earlier(this->heap[child], ti))
+            break;
+        this->place(this->heap[child], pos);
+        pos = child;
+    }
+    this->place(ti, pos);
+}
+
+uint64_t TimerQueue::next_wakeup() const
+{
+    if (this->heap.empty())
+        return 0;
+
+    uint64_t wakeup = UINT64_MAX;
+
+    this->scan_wakeup(0, wakeup);
+
+    return wakeup;
+}
+
+// Find the earliest timeout + slack. Timers are heap-ordered by timeout
+// and slack is never negative so subtrees whose root expires at or after
+// the current candidate can be skipped.
+void TimerQueue::scan_wakeup(uint32_t pos, uint64_t& wakeup) const
+{
+    if (pos >= this->heap.size())
+        return;
+
+    const TimerInfo* ti = this->heap[pos];
+
+    if (ti->timeout_ns >= wakeup)
+        return;
+
+    uint64_t deadline = ti->timeout_ns + ti->slack_ns;
+    if (deadline < ti->timeout_ns)
+        deadline = UINT64_MAX;
+    wakeup = std::min(wakeup, deadline);
 
-    ti->id          = ++this->id;
+    this->scan_wakeup((pos << 1) + 1, wakeup);
+    this->scan_wakeup((pos << 1) + 2, wakeup);
+}
+
+uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb,
+                                          uint64_t slack)
+{
+    TimerInfo* ti   = this->timer_queue.alloc();
+    ti->seq         = ++this->seq;
     ti->timeout_ns  = timeout_ns;
     ti->interval_ns = interval;
-    ti->cb          = cb;
-
-    std::shared_ptr<TimerInfo> timer_desc(ti);
+    ti->slack_ns    = slack;
+    ti->cb          = std::move(cb);
 
     // add new timer to the timer queue
-    this->timer_queue.push(timer_desc);
+    this->timer_queue.push(ti);
 
     // notify listeners about changes in the timer queue
     if (!this->cb_active) {
@@ -52,29 +209,41 @@ uint32_t TimerManager::add_absolute_timer(uint64_t timeout_ns, uint64_t interval
     return ti->id;
 }
 
-uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb)
+uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb, uint64_t slack)
 {
-    return TimerManager::add_absolute_timer(this->get_time_now() + timeout, 0, cb);
+    return TimerManager::add_absolute_timer(this->get_time_now() + timeout, 0, std::move(cb),
+                                            slack);
 }
 
 uint32_t TimerManager::add_immediate_timer(timer_cb cb)
 {
-    return TimerManager::add_absolute_timer(0, 0, cb);
+    if (!this->on_emu_thread()) {
+        this->post(std::move(cb));
+        return 0;
+    }
+
+    return TimerManager::add_absolute_timer(0, 0, std::move(cb));
 }
 
-uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb)
+uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb,
+                                        uint64_t slack)
 {
-    return TimerManager::add_absolute_timer(this->get_time_now() + delay, interval, cb);
+    return TimerManager::add_absolute_timer(this->get_time_now() + delay, interval,
+                                            std::move(cb), slack);
 }
 
-uint32_t TimerManager::add_cyclic_timer(uint64_t interval, timer_cb cb)
+uint32_t TimerManager::add_cyclic_timer(uint64_t interval, timer_cb cb, uint64_t slack)
 {
-    return this->add_cyclic_timer(interval, interval, cb);
+    return this->add_cyclic_timer(interval, interval, std::move(cb), slack);
 }
 
 void TimerManager::cancel_timer(uint32_t id)
 {
-    this->timer_queue.remove_by_id(id);
+    TimerInfo* ti = this->timer_queue.find(id);
+    if (ti) {
+        this->timer_queue.release(ti);
+    }
+
     if (!this->cb_active) {
         this->notify_timer_changes();
     }
@@ -82,31 +251,31 @@ void TimerManager::cancel_timer(uint32_t id)
 
 uint64_t TimerManager::process_timers()
 {
-    std::shared_ptr<TimerInfo> cur_timer;
-    uint64_t time_now = get_time_now();
+    TimerInfo* cur_timer;
 
-{ // mtx scope
-    std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-    if (this->timer_queue.empty()) {
-        return 0ULL;
-    }
+    // run callbacks posted by other threads first
+    if (this->mailbox.load(std::memory_order_relaxed) != nullptr)
+        this->drain_mailbox();
+
+    uint64_t time_now = get_time_now();
 
     // scan for expired timers
-    cur_timer = this->timer_queue.top();
-} // ] mtx scope
-    while (cur_timer->timeout_ns <= time_now) {
-        this->timer_queue.remove_by_id(cur_timer->id);
-        uint64_t timeout_ns = cur_timer->timeout_ns;
-        timer_cb cb = cur_timer->cb;
-
-        // re-arm cyclic timers
+    while ((cur_timer = this->timer_queue.top()) != nullptr &&
+           cur_timer->timeout_ns <= time_now) {
+        uint32_t timer_id = cur_timer->id;
+
+        // Take the callback out of the descriptor so the callback is free
+        // to cancel or re-arm timers including its own one.
+        timer_cb cb = std::move(cur_timer->cb);
+
         if (cur_timer->interval_ns) {
-            std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-            uint64_t timeout_ns_new = timeout_ns + cur_timer->interval_ns;
+            // re-arm cyclic timers
+            uint64_t timeout_ns_new = cur_timer->timeout_ns + cur_timer->interval_ns;
             if (timeout_ns_new <= time_now)
                 timeout_ns_new = time_now + cur_timer->interval_ns;
-            cur_timer->timeout_ns = timeout_ns_new;
-            this->timer_queue.push(cur_timer);
+            this->timer_queue.reschedule(cur_timer, timeout_ns_new);
+        } else {
+            this->timer_queue.release(cur_timer);
         }
 
         this->cb_active = true;
@@ -116,27 +285,74 @@ uint64_t TimerManager::process_timers()
 
         this->cb_active = false;
 
-        // process next timer
-{ // [ mtx scope
-        std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-        if (this->timer_queue.empty()) {
-            return 0ULL;
-        }
+        // return the callback to cyclic timers that are still armed
+        if (cur_timer->id == timer_id)
+            cur_timer->cb = std::move(cb);
+    }
 
-        cur_timer = this->timer_queue.top();
-} // ] mtx scope
+    if (cur_timer == nullptr) {
+        return 0ULL;
     }
 
-    // return time slice in nanoseconds until next timer's expiry
-    return cur_timer->timeout_ns - time_now;
+    // Return time slice in nanoseconds until the next timer's expiry.
+    // Timers with slack may be postponed so that they expire together
+    // with later timers, which results in longer execution slices.
+    return this->timer_queue.next_wakeup() - time_now;
+}
+
+void TimerManager::post(timer_cb cb)
+{
+    TimerPost* msg = new TimerPost{nullptr, std::move(cb)};
+    TimerPost* head = this->mailbox.load(std::memory_order_relaxed);
+
+    do {
+        msg->next = head;
+    } while (!this->mailbox.compare_exchange_weak(head, msg,
+        std::memory_order_release, std::memory_order_relaxed));
+
+    // ask the emulation thread to drain the mailbox
+    this->notify_timer_changes();
+}
+
+void TimerManager::drain_mailbox()
+{
+    TimerPost* msg  = this->mailbox.exchange(nullptr, std::memory_order_acquire);
+    TimerPost* fifo = nullptr;
+
+    // the mailbox is LIFO, restore posting order
+    while (msg) {
+        TimerPost* next = msg->next;
+        msg->next = fifo;
+        fifo = msg;
+        msg = next;
+    }
+
+    while (fifo) {
+        TimerPost* next = fifo->next;
+
+        this->cb_active = true;
+        fifo->cb();
+        this->cb_active = false;
+
+        delete fifo;
+        fifo = next;
+    }
 }
 
 void TimerManager::cancel_all_timers()
 {
-    std::shared_ptr<TimerInfo> cur_timer;
-    while (!this->timer_queue.empty()) {
-        cur_timer = this->timer_queue.top();
+    TimerInfo* cur_timer;
+
+    while ((cur_timer = this->timer_queue.top()) != nullptr) {
         LOG_F(WARNING, "Canceling timer id:%u ns:%llu", cur_timer->id, cur_timer->timeout_ns);
-        this->timer_queue.pop();
+        this->timer_queue.release(cur_timer);
+    }
+
+    // discard callbacks posted by other threads
+    TimerPost* msg = this->mailbox.exchange(nullptr, std::memory_order_acquire);
+    while (msg) {
+        TimerPost* next = msg->next;
+        delete msg;
+        msg = next;
     }
 }
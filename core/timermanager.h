@@ -23,13 +23,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define TIMER_MANAGER_H
 
 #include <atomic>
-#include <algorithm>
 #include <cinttypes>
 #include <functional>
 #include <memory>
-#include <queue>
+#include <thread>
 #include <vector>
-#include <mutex>
 
 constexpr auto NS_PER_SEC     = 1000000000;
 constexpr auto USEC_PER_SEC   = 1000000;
@@ -43,71 +41,84 @@ constexpr auto ONE_BILLION_NS = 1000000000;
 typedef std::function<void()> timer_cb;
 typedef std::function<void()> notify_changes_cb;
 
-/** Extend std::priority_queue as suggested here:
-    https://stackoverflow.com/a/36711682
-    to be able to remove arbitrary elements.
+constexpr uint32_t TIMER_SLOT_BITS   = 12; // max number of simultaneously armed timers = 4096
+constexpr uint32_t TIMER_MAX_SLOTS   = 1 << TIMER_SLOT_BITS;
+constexpr uint32_t TIMER_GEN_MASK    = 0xFFFFFFFFUL >> TIMER_SLOT_BITS;
+constexpr uint32_t TIMER_CHUNK_SIZE  = 64;  // descriptors allocated at once
+constexpr uint32_t TIMER_NOT_QUEUED  = 0xFFFFFFFFUL;
+
+/** Timer descriptor. Descriptors are pooled and never move in memory. */
+typedef struct TimerInfo {
+    uint32_t id;          // public timer handle, 0 if the descriptor is free
+    uint32_t heap_pos;    // index in the timer heap or TIMER_NOT_QUEUED
+    uint64_t seq;         // creation order, breaks ties between equal expiries
+    uint64_t timeout_ns;  // timer expiry
+    uint64_t interval_ns; // 0 for one-shot timers
+    uint64_t slack_ns;    // how late the timer may fire to be batched with others
+    timer_cb cb;          // timer callback
+    uint32_t slot;        // index of this descriptor in the pool
+    uint32_t gen;         // generation counter, makes stale handles harmless
+    uint32_t next_free;   // free list link
+} TimerInfo;
+
+/** Timer queue implemented as an intrusive binary min-heap of pooled
+    timer descriptors. Descriptors remember their heap position so that
+    cancellation and re-arming are O(log n). Neither of them allocates
+    memory once the pool and the heap reached their working size.
  */
-template <typename T, class Container = std::vector<T>, class Compare = std::less<typename Container::value_type>>
-class my_priority_queue : public std::priority_queue<T, Container, Compare> {
+class TimerQueue {
 public:
-    bool remove_by_id(const uint32_t id){
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        if (this->empty())
-            return false;
-        auto el = this->top();
-        if (el->id == id) {
-            std::priority_queue<T, Container, Compare>::pop();
-            return true;
-        }
-        auto it = std::find_if(
-            this->c.begin(), this->c.end(), [id](const T& el) { return el->id == id; });
-        if (it != this->c.end()) {
-            this->c.erase(it);
-            std::make_heap(this->c.begin(), this->c.end(), this->comp);
-            return true;
-        }
-        return false;
-    }
+    TimerQueue() = default;
 
-    void push(T val)
-    {
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        std::priority_queue<T, Container, Compare>::push(val);
-    }
+    TimerInfo* alloc();
+    void       release(TimerInfo* ti);
+    TimerInfo* find(uint32_t id);
 
-    T pop()
-    {
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        T val = std::priority_queue<T, Container, Compare>::top();
-        std::priority_queue<T, Container, Compare>::pop();
-        return val;
-    }
+    void push(TimerInfo* ti);
+    void remove(TimerInfo* ti);
+    void reschedule(TimerInfo* ti, uint64_t timeout_ns);
 
-    std::recursive_mutex& get_mtx()
-    {
-        return mtx;
-    }
+    TimerInfo* top() const { return this->heap.empty() ? nullptr : this->heap[0]; }
+    bool       empty() const { return this->heap.empty(); }
+
+    // latest time at which the next timer(s) must be processed
+    uint64_t   next_wakeup() const;
 
 private:
-    std::recursive_mutex mtx;
-};
+    static bool earlier(const TimerInfo* l, const TimerInfo* r) {
+        return l->timeout_ns < r->timeout_ns ||
+            (l->timeout_ns == r->timeout_ns && l->seq < r->seq);
+    }
 
-typedef struct TimerInfo {
-    uint32_t id;
-    uint64_t timeout_ns;  // timer expiry
-    uint64_t interval_ns; // 0 for one-shot timers
-    timer_cb cb;          // timer callback
-} TimerInfo;
+    void sift_up(uint32_t pos);
+    void sift_down(uint32_t pos);
+    void scan_wakeup(uint32_t pos, uint64_t& wakeup) const;
 
-// Custom comparator for sorting our timer queue in ascending order
-class MyGtComparator {
-public:
-    bool operator()(const std::shared_ptr<TimerInfo>& l, const std::shared_ptr<TimerInfo>& r) const {
-        return l.get()->timeout_ns > r.get()->timeout_ns ||
-            (l.get()->timeout_ns == r.get()->timeout_ns && l.get()->id > r.get()->id);
+    void place(TimerInfo* ti, uint32_t pos) {
+        this->heap[pos] = ti;
+        ti->heap_pos    = pos;
     }
+
+    std::vector<std::unique_ptr<TimerInfo[]>> chunks; // descriptor pool
+    std::vector<TimerInfo*> heap;
+    uint32_t num_slots = 0;
+    uint32_t free_head = TIMER_NOT_QUEUED;
 };
 
+/** Callback posted to the emulation thread by another host thread. */
+typedef struct TimerPost {
+    TimerPost* next;
+    timer_cb   cb;
+} TimerPost;
+
+/** Timer manager.
+
+    The timer queue is owned by the emulation thread and isn't protected
+    by any lock. Other host threads (audio, input etc.) must not touch it
+    directly. Instead, add_immediate_timer() called from such a thread
+    posts its callback to a lock-free MPSC mailbox that the emulation
+    thread drains at the next execution block boundary.
+ */
 class TimerManager {
 public:
     static TimerManager* get_instance() {
@@ -127,15 +138,25 @@ public:
         this->notify_timer_changes = cb;
     }
 
+    // declare the calling thread as the owner of the timer queue
+    void set_emu_thread() {
+        this->emu_thread = std::this_thread::get_id();
+    }
+
     // return current virtual time in nanoseconds
     uint64_t current_time_ns() const { return get_time_now(); }
 
     // creating and cancelling timers
-    uint32_t add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb);
-    uint32_t add_oneshot_timer(uint64_t timeout, timer_cb cb);
-    uint32_t add_immediate_timer(timer_cb cb);
-    uint32_t add_cyclic_timer(uint64_t interval, timer_cb cb);
-    uint32_t add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb);
+    // slack specifies how late a timer may fire so that timers with
+    // nearby deadlines can be processed together; only timers whose
+    // timing the guest can't observe (e.g. host event polling) may use it
+    uint32_t add_absolute_timer(uint64_t timeout_ns, uint64_t interval, timer_cb cb,
+                                uint64_t slack = 0);
+    uint32_t add_oneshot_timer(uint64_t timeout, timer_cb cb, uint64_t slack = 0);
+    uint32_t add_immediate_timer(timer_cb cb); // returns 0 if posted from another thread
+    uint32_t add_cyclic_timer(uint64_t interval, timer_cb cb, uint64_t slack = 0);
+    uint32_t add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb,
+                              uint64_t slack = 0);
     void cancel_timer(uint32_t id);
     void cancel_all_timers();
 
@@ -145,15 +166,26 @@ private:
     static TimerManager* timer_manager;
     TimerManager(){} // private constructor to implement a singleton
 
-    // timer queue
-    my_priority_queue<std::shared_ptr<TimerInfo>, std::vector<std::shared_ptr<TimerInfo>>, MyGtComparator> timer_queue;
+    bool on_emu_thread() const {
+        return this->emu_thread == std::thread::id() ||
+               this->emu_thread == std::this_thread::get_id();
+    }
+
+    void post(timer_cb cb);
+    void drain_mailbox();
+
+    // timer queue, accessed by the emulation thread only
+    TimerQueue              timer_queue;
+
+    // callbacks posted by other threads, newest first
+    std::atomic<TimerPost*> mailbox{nullptr};
+    std::thread::id         emu_thread;
 
     std::function<uint64_t()>   get_time_now;
     std::function<void()>       notify_timer_changes;
 
-    std::atomic<uint32_t> id{0};
+    uint64_t                    seq = 0;
 
-    // FIXME: Do we need this? It gets written in main thread and read in audio thread.
     bool cb_active = false; // true if a timer callback is executing
 };
 
@@ -728,6 +728,11 @@ extern int get_icnt_factor();
 /* toggle_g_realtime */
 extern bool toggle_g_realtime();
 
+/* Adaptive virtual time: the instruction-to-nanosecond ratio is
+   continuously recalibrated against the host clock. */
+extern bool g_adaptive_time;
+extern bool toggle_adaptive_time();
+
 /* force_cycle_counter_reload */
 static void force_cycle_counter_reload();
 
@@ -26,6 +26,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "ppcdisasm.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <iostream>
@@ -123,18 +124,31 @@ uint32_t pcp;
 uint32_t ppc_next_instruction_address;    // Used for branching, setting up the NIA
 
 unsigned exec_flags; // execution control flags
-// FIXME: exec_timer is read by main thread ppc_main_opcode;
-// written by audio dbdma DMAChannel::update_irq .. add_immediate_timer
-volatile bool exec_timer;
+// set by any thread to make the interpreter loop call process_events()
+// at the next instruction boundary
+std::atomic<bool> exec_timer;
 bool int_pin = false; // interrupt request pin state: true - asserted
 bool dec_exception_pending = false;
 
 /* variables related to virtual time */
 bool g_realtime = false;
+bool g_adaptive_time = false;
 uint64_t g_nanoseconds_base;
 uint64_t g_icycles;
 int      icnt_factor;
 
+/* variables related to the adaptive virtual time */
+constexpr int      ICNT_FRAC_BITS    = 16;          // fractional bits of ns_per_icycle
+constexpr uint64_t ICNT_RATIO_MIN    = 1ULL << (ICNT_FRAC_BITS - 4); // 1/16 ns per instruction
+constexpr uint64_t ICNT_RATIO_MAX    = 4096ULL << ICNT_FRAC_BITS;   // 4096 ns per instruction
+constexpr uint64_t CALIB_INTERVAL_NS = 10000000;    // recalibrate every 10 ms of virtual time
+
+static uint64_t ns_per_icycle;    // ns per instruction, 16.16 fixed point
+static uint64_t virt_base_ns;     // virtual time at the last calibration
+static uint64_t icycles_base;     // instruction counter at the last calibration
+static uint64_t host_base_ns;     // host time at the last calibration
+static uint64_t idle_debt_ns;     // idle skips virtual time hasn't given back yet
+
 /* global variables related to the timebase facility */
 uint64_t tbr_wr_timestamp;  // stores vCPU virtual time of the last TBR write
 uint64_t rtc_timestamp;     // stores vCPU virtual time of the last RTC write
@@ -330,14 +344,14 @@ void ppc_main_opcode(PPCOpcode *opcodeGrabber, uint32_t opcode)
     irec->paddr = pcp;
     irec->ins = opcode;
     irec->msr = ppc_state.msr;
-    irec->flags_before = exec_flags | (exec_timer << 7);
+    irec->flags_before = exec_flags | (exec_timer.load(std::memory_order_relaxed) << 7);
     irec->flags_after = 0;
 #endif
 
     opcodeGrabber[(opcode >> 15 & 0x1F800) | (opcode & 0x7FF)](opcode);
 
 #ifdef LOG_INSTRUCTIONS
-    irec->flags_after = exec_flags | (exec_timer << 7) | 0x80000000;
+    irec->flags_after = exec_flags | (exec_timer.load(std::memory_order_relaxed) << 7) | 0x80000000;
     irec->msr_after = ppc_state.msr;
 #endif
 }
@@ -355,15 +369,99 @@ uint64_t get_virt_time_ns()
 {
     if (g_realtime) {
         return cpu_now_ns() - g_nanoseconds_base;
+    } else if (g_adaptive_time) {
+        return virt_base_ns + (((g_icycles - icycles_base) * ns_per_icycle) >> ICNT_FRAC_BITS);
     } else {
         return g_icycles << icnt_factor;
     }
 }
 
+// convert a virtual time interval to the number of instructions
+static inline uint64_t ns_to_icycles(uint64_t ns)
+{
+    if (g_adaptive_time && !g_realtime) {
+        // divide before shifting so that distant deadlines can't overflow
+        uint64_t whole = ns / ns_per_icycle;
+        uint64_t rem   = ns % ns_per_icycle;
+        if (whole >= (UINT64_MAX >> (ICNT_FRAC_BITS + 1)))
+            return UINT64_MAX >> 1; // saturate, leaving room for the caller's sum
+        return (whole << ICNT_FRAC_BITS) + (rem << ICNT_FRAC_BITS) / ns_per_icycle;
+    } else
+        return ns >> icnt_factor;
+}
+
+// start a new calibration period at the given virtual time
+static void adaptive_time_rebase(uint64_t time_now)
+{
+    virt_base_ns = time_now;
+    icycles_base = g_icycles;
+    host_base_ns = cpu_now_ns();
+}
+
+/* Account for instructions skipped by the idle loop. They took no host
+   time, so they are kept out of the measured rate. Virtual time still
+   advances by the skipped interval and runs ahead of the host clock by
+   that much; adaptive_time_calibrate() pays it back once the guest is
+   busy again.
+ */
+static void adaptive_time_skip(uint64_t icycles)
+{
+    // split the product so that long idle periods can't overflow it
+    uint64_t skipped_ns = (icycles >> ICNT_FRAC_BITS) * ns_per_icycle +
+        (((icycles & ((1ULL << ICNT_FRAC_BITS) - 1)) * ns_per_icycle) >> ICNT_FRAC_BITS);
+
+    icycles_base       += icycles;
+    virt_base_ns       += skipped_ns;
+    g_nanoseconds_base -= skipped_ns;
+    idle_debt_ns       += skipped_ns;
+}
+
+/* Adjust the ns-per-instruction ratio so that virtual time converges
+   to the host time. Called from process_events() only so that the host
+   clock is sampled once per calibration period instead of on each
+   get_virt_time_ns() call. Virtual time stays monotonic because each
+   period continues exactly where the previous one ended.
+ */
+static void adaptive_time_calibrate()
+{
+    uint64_t icycles = g_icycles - icycles_base;
+    uint64_t time_now = get_virt_time_ns();
+
+    if (!icycles || time_now - virt_base_ns < CALIB_INTERVAL_NS)
+        return;
+
+    uint64_t host_now = cpu_now_ns();
+
+    // hand back skipped idle time as drift, at most a quarter of the host
+    // time per period so that the guest slows down instead of stalling
+    uint64_t repay = std::min(idle_debt_ns, (host_now - host_base_ns) / 4);
+    idle_debt_ns       -= repay;
+    g_nanoseconds_base += repay;
+
+    // how far virtual time lags behind (positive) or leads (negative) host time
+    int64_t drift = (int64_t)(host_now - g_nanoseconds_base) - (int64_t)time_now;
+
+    // host time spent per instruction during the last period, plus a
+    // correction that removes a quarter of the accumulated drift during
+    // the next period of the same length
+    int64_t target_ns = (int64_t)(host_now - host_base_ns) + drift / 4;
+    uint64_t target = target_ns > 0 ?
+        ((uint64_t)target_ns << ICNT_FRAC_BITS) / icycles : ICNT_RATIO_MIN;
+
+    // smooth the ratio to avoid jitter caused by host scheduling
+    ns_per_icycle = std::clamp((ns_per_icycle * 3 + target) >> 2, ICNT_RATIO_MIN, ICNT_RATIO_MAX);
+
+    adaptive_time_rebase(time_now);
+}
+
 void set_virt_time_ns(uint64_t time_now)
 {
     if (g_realtime) {
         g_nanoseconds_base = cpu_now_ns() - time_now - 5000;
+    } else if (g_adaptive_time) {
+        g_nanoseconds_base = cpu_now_ns() - time_now;
+        idle_debt_ns = 0;
+        adaptive_time_rebase(time_now);
     } else {
         g_icycles = time_now >> icnt_factor;
     }
@@ -377,20 +475,22 @@ void set_virt_time_ns(uint64_t time_now)
 
 static uint64_t process_events()
 {
-    exec_timer = false;
+    exec_timer.store(false, std::memory_order_relaxed);
+    if (g_adaptive_time && !g_realtime)
+        adaptive_time_calibrate();
     uint64_t slice_ns = TimerManager::get_instance()->process_timers();
     if (slice_ns == 0) {
         // execute 25.000 cycles
         // if there are no pending timers
         return g_icycles + 25000;
     }
-    return g_icycles + (slice_ns >> icnt_factor) + 1;
+    return g_icycles + ns_to_icycles(slice_ns) + 1;
 }
 
 static void force_cycle_counter_reload()
 {
     // tell the interpreter loop to reload cycle counter
-    exec_timer = true;
+    exec_timer.store(true, std::memory_order_relaxed);
 }
 
 int increment_icnt_factor()
@@ -418,6 +518,17 @@ int get_icnt_factor()
     return icnt_factor;
 }
 
+bool toggle_adaptive_time()
+{
+    uint64_t time_now = get_virt_time_ns();
+    g_adaptive_time = !g_adaptive_time;
+    if (g_adaptive_time)
+        ns_per_icycle = (1ULL << icnt_factor) << ICNT_FRAC_BITS;
+    set_virt_time_ns(time_now);
+    force_cycle_counter_reload();
+    return g_adaptive_time;
+}
+
 bool toggle_g_realtime()
 {
     uint64_t time_now = get_virt_time_ns();
@@ -460,7 +571,7 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
 
         opcode = ppc_read_instruction(pc_real);
         ppc_main_opcode(opcode_grabber, opcode);
-        if (g_icycles++ >= max_cycles || exec_timer) [[unlikely]]
+        if (g_icycles++ >= max_cycles || exec_timer.load(std::memory_order_relaxed)) [[unlikely]]
             max_cycles = process_events();
 
         if (exec_flags) {
@@ -471,6 +582,8 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
                         break;
                     }
                     if (max_cycles > g_icycles) {
+                        if (g_adaptive_time && !g_realtime)
+                            adaptive_time_skip(max_cycles - g_icycles);
                         g_icycles = max_cycles;
                     } else {
                         g_icycles++;
@@ -1031,6 +1144,7 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
     // initialize emulator timers
     TimerManager::get_instance()->set_time_now_cb(&get_virt_time_ns);
     TimerManager::get_instance()->set_notify_changes_cb(&force_cycle_counter_reload);
+    TimerManager::get_instance()->set_emu_thread();
 
     // initialize time base facility
 #ifdef __APPLE__
@@ -1053,6 +1167,13 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
 //  icnt_factor =  1; // 1 instruction =    2 ns =  500.000 MHz // 1A611A7B =   442.571387 MHz =    2.259 ns // (100...) MHz = invalid clock for PDM gestalt calculation
 //  icnt_factor =  0; // 1 instruction =    1 ns = 1500.000 MHz // 3465B2D9 =   879.080153 MHz =    1.137 ns // (100...) MHz = invalid clock for PDM gestalt calculation
 
+    // adaptive virtual time starts with the ratio given by icnt_factor
+    ns_per_icycle = (1ULL << icnt_factor) << ICNT_FRAC_BITS;
+    virt_base_ns  = 0;
+    icycles_base  = 0;
+    host_base_ns  = g_nanoseconds_base;
+    idle_debt_ns  = 0;
+
     tbr_wr_timestamp = 0;
     rtc_timestamp = 0;
     tbr_wr_value = 0;
@@ -1066,7 +1187,7 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
     tbr_period_ns = ((uint64_t)NS_PER_SEC << 32) / tb_freq;
 
     exec_flags = 0;
-    exec_timer = false;
+    exec_timer.store(false, std::memory_order_relaxed);
 
     dec_wr_value = 0;
 
@@ -24,18 +24,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/memaccess.h>
 #include <devices/memctrl/memctrlbase.h>
 #include <devices/common/mmiodevice.h>
+#include <utils/profiler.h>
 #include "ppcemu.h"
 #include "ppcmmu.h"
 
 #include <array>
 #include <cinttypes>
 #include <loguru.hpp>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
-//#define MMU_PROFILING // uncomment this to enable MMU profiling
-//#define TLB_PROFILING // uncomment this to enable SoftTLB profiling
-
 /* pointer to exception handler to be called when a MMU exception is occurred. */
 void (*mmu_exception_handler)(Except_Type exception_type, uint32_t srr1_bits);
 
@@ -47,35 +46,37 @@ std::function<void(uint32_t bat_reg)> dbat_update;
 PPC_BAT_entry ibat_array[4] = {{0}};
 PPC_BAT_entry dbat_array[4] = {{0}};
 
-#ifdef MMU_PROFILING
-
-/* global variables for lightweight MMU profiling */
-uint64_t    dmem_reads_total   = 0; // counts reads from data memory
-uint64_t    iomem_reads_total  = 0; // counts I/O memory reads
-uint64_t    dmem_writes_total  = 0; // counts writes to data memory
-uint64_t    iomem_writes_total = 0; // counts I/O memory writes
-uint64_t    exec_reads_total   = 0; // counts reads from executable memory
-uint64_t    bat_transl_total   = 0; // counts BAT translations
-uint64_t    ptab_transl_total  = 0; // counts page table translations
-uint64_t    unaligned_reads    = 0; // counts unaligned reads
-uint64_t    unaligned_writes   = 0; // counts unaligned writes
-uint64_t    unaligned_crossp_r = 0; // counts unaligned crosspage reads
-uint64_t    unaligned_crossp_w = 0; // counts unaligned crosspage writes
-
-#endif // MMU_PROFILING
-
-#ifdef TLB_PROFILING
-
-/* global variables for lightweight SoftTLB profiling */
-uint64_t    num_primary_itlb_hits   = 0; // number of hits in the primary ITLB
-uint64_t    num_secondary_itlb_hits = 0; // number of hits in the secondary ITLB
-uint64_t    num_itlb_refills        = 0; // number of ITLB refills
-uint64_t    num_primary_dtlb_hits   = 0; // number of hits in the primary DTLB
-uint64_t    num_secondary_dtlb_hits = 0; // number of hits in the secondary DTLB
-uint64_t    num_dtlb_refills        = 0; // number of DTLB refills
-uint64_t    num_entry_replacements  = 0; // number of entry replacements
-
-#endif // TLB_PROFILING
+/** Enables collection of the MMU and SoftTLB statistics below. */
+bool mmu_stats_enabled = false;
+
+/* Lightweight MMU and SoftTLB statistics. These counters are only touched
+   by the emulation thread so they don't need to be atomic. */
+static struct {
+    // MMU counters
+    uint64_t    dmem_reads_total;   // counts reads from data memory
+    uint64_t    iomem_reads_total;  // counts I/O memory reads
+    uint64_t    dmem_writes_total;  // counts writes to data memory
+    uint64_t    iomem_writes_total; // counts I/O memory writes
+    uint64_t    exec_reads_total;   // counts reads from executable memory
+    uint64_t    bat_transl_total;   // counts BAT translations
+    uint64_t    ptab_transl_total;  // counts page table translations
+    uint64_t    unaligned_reads;    // counts unaligned reads
+    uint64_t    unaligned_writes;   // counts unaligned writes
+    uint64_t    unaligned_crossp_r; // counts unaligned crosspage reads
+    uint64_t    unaligned_crossp_w; // counts unaligned crosspage writes
+
+    // SoftTLB counters
+    uint64_t    num_primary_itlb_hits;   // number of hits in the primary ITLB
+    uint64_t    num_secondary_itlb_hits; // number of hits in the secondary ITLB
+    uint64_t    num_itlb_refills;        // number of ITLB refills
+    uint64_t    num_primary_dtlb_hits;   // number of hits in the primary DTLB
+    uint64_t    num_secondary_dtlb_hits; // number of hits in the secondary DTLB
+    uint64_t    num_dtlb_refills;        // number of DTLB refills
+    uint64_t    num_entry_replacements;  // number of entry replacements
+} mmu_stats;
+
+#define MMU_STAT_INC(counter) \
+    do { if (mmu_stats_enabled) mmu_stats.counter++; } while (0)
 
 /** remember recently used physical memory regions for quicker translation. */
 AddressMapEntry last_ptab_area;
@@ -144,9 +145,7 @@ static BATResult mpc601_block_address_translation(uint32_t la)
 
             prot = access_conv[(key << 2) | bat_entry->prot];
 
-#ifdef MMU_PROFILING
-            bat_transl_total++;
-#endif
+            MMU_STAT_INC(bat_transl_total);
 
             // logical to physical translation
             pa = bat_entry->phys_hi | (la & ~bat_entry->hi_mask);
@@ -181,9 +180,7 @@ static BATResult ppc_block_address_translation(uint32_t la)
         if ((bat_entry->access & access_bits) != 0 && ((la & bat_entry->hi_mask) == bat_entry->bepi)) {
             bat_hit = true;
 
-#ifdef MMU_PROFILING
-            bat_transl_total++;
-#endif
+            MMU_STAT_INC(bat_transl_total);
             // logical to physical translation
             pa = bat_entry->phys_hi | (la & ~bat_entry->hi_mask);
             prot = bat_entry->prot;
@@ -294,6 +291,8 @@ static PATResult page_address_translation(uint32_t la, bool is_instr_fetch,
         mmu_exception_handler(Except_Type::EXC_ISI, 0x10000000);
     }
 
+    MMU_STAT_INC(ptab_transl_total);
+
     page_index = (la >> 12) & 0xFFFF;
     pteg_hash1 = (sr_val & 0x7FFFF) ^ page_index;
     vsid       = sr_val & 0x0FFFFFF;
@@ -459,11 +458,14 @@ fail:
     return MapDmaResult{RT_NONE, false, nullptr, nullptr, 0};
 }
 
-constexpr uint32_t TLB_SIZE        = 4096;
-constexpr uint32_t TLB2_WAYS       = 4;
 constexpr uint32_t TLB_INVALID_TAG = 0xFFFFFFFF;
 constexpr uint32_t TLB_VPS_MASK    = 0x0FFFF000; // mask for TLB invalidation
 
+// SoftTLB geometry, see mmu_set_tlb_geometry()
+static uint32_t tlb1_size = TLB1_DEF_SIZE; // entries in each primary TLB
+static uint32_t tlb2_sets = TLB2_DEF_SETS; // sets in each secondary TLB
+static uint32_t tlb2_ways = TLB2_DEF_WAYS; // associativity of the secondary TLB
+
 enum TLBFlags : uint16_t {
     PAGE_MEM      = 1 << 0, // memory page backed by host memory
     PAGE_IO       = 1 << 1, // memory mapped I/O page
@@ -581,32 +583,35 @@ static void promote_tlb_entry(TLBEntry *tlb1_entry, const TLBEntry *tlb2_entry)
     track_translated_entry<tlb_type>(tlb1_entry);
 }
 
+// TLB storage is allocated by ppc_mmu_init() according with the geometry above
+
 // primary ITLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode1;
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode2;
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode3;
+static std::vector<TLBEntry> itlb1_mode1;
+static std::vector<TLBEntry> itlb1_mode2;
+static std::vector<TLBEntry> itlb1_mode3;
 
 // secondary ITLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode1;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode2;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode3;
+static std::vector<TLBEntry> itlb2_mode1;
+static std::vector<TLBEntry> itlb2_mode2;
+static std::vector<TLBEntry> itlb2_mode3;
 
 // primary DTLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode1;
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode2;
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode3;
+static std::vector<TLBEntry> dtlb1_mode1;
+static std::vector<TLBEntry> dtlb1_mode2;
+static std::vector<TLBEntry> dtlb1_mode3;
 
 // secondary DTLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode1;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode2;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode3;
+static std::vector<TLBEntry> dtlb2_mode1;
+static std::vector<TLBEntry> dtlb2_mode2;
+static std::vector<TLBEntry> dtlb2_mode3;
 
 TLBEntry *pCurITLB1; // current primary ITLB
 TLBEntry *pCurITLB2; // current secondary ITLB
 TLBEntry *pCurDTLB1; // current primary DTLB
 TLBEntry *pCurDTLB2; // current secondary DTLB
 
-uint32_t tlb_size_mask = TLB_SIZE - 1;
+uint32_t tlb1_size_mask = TLB1_DEF_SIZE - 1;
+uint32_t tlb2_size_mask = TLB2_DEF_SETS - 1;
 
 // fake TLB entry for handling of unmapped memory accesses
 uint64_t    UnmappedVal = -1ULL;
@@ -666,69 +671,51 @@ void mmu_change_mode()
     }
 }
 
-template <uint32_t way>
-static inline void tlb2_touch_way(TLBEntry *tlb_entry)
+// Secondary TLB sets use LRU replacement. The lru_bits field of each way holds
+// its recency rank within the set, tlb2_ways - 1 being the most recently used.
+static inline void tlb2_touch_way(TLBEntry *tlb_set, uint32_t way)
 {
-    static_assert(way < TLB2_WAYS);
-
-    // Each pair is one branch of the four-way tree-based LRU. Mark the
-    // selected way as most recently used, its sibling as the next replacement
-    // candidate, and the other pair as less recently used.
-    if constexpr (way < 2) {
-        tlb_entry[0].lru_bits  = way == 0 ? 0x3 : 0x2;
-        tlb_entry[1].lru_bits  = way == 1 ? 0x3 : 0x2;
-        tlb_entry[2].lru_bits &= 0x1;
-        tlb_entry[3].lru_bits &= 0x1;
-    } else {
-        tlb_entry[0].lru_bits &= 0x1;
-        tlb_entry[1].lru_bits &= 0x1;
-        tlb_entry[2].lru_bits  = way == 2 ? 0x3 : 0x2;
-        tlb_entry[3].lru_bits  = way == 3 ? 0x3 : 0x2;
+    uint16_t old_rank = tlb_set[way].lru_bits;
+
+    for (uint32_t i = 0; i < tlb2_ways; i++) {
+        if (tlb_set[i].lru_bits > old_rank)
+            tlb_set[i].lru_bits--;
     }
+    tlb_set[way].lru_bits = tlb2_ways - 1;
 }
 
 template <const TLBType tlb_type>
-static TLBEntry* tlb2_target_entry(uint32_t gp_va)
+static inline TLBEntry* tlb2_get_set(uint32_t gp_va)
 {
-    TLBEntry *tlb_entry;
+    uint32_t set_index = (gp_va >> PPC_PAGE_SIZE_BITS) & tlb2_size_mask;
 
     if (tlb_type == TLBType::ITLB) {
-        tlb_entry = &pCurITLB2[((gp_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
+        return &pCurITLB2[set_index * tlb2_ways];
     } else {
-        tlb_entry = &pCurDTLB2[((gp_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
+        return &pCurDTLB2[set_index * tlb2_ways];
     }
+}
+
+template <const TLBType tlb_type>
+static TLBEntry* tlb2_target_entry(uint32_t gp_va)
+{
+    TLBEntry *tlb_set = tlb2_get_set<tlb_type>(gp_va);
+    uint32_t way, victim = 0;
 
     // select the target from invalid blocks first
-    if (tlb_entry[0].tag == TLB_INVALID_TAG) {
-        tlb2_touch_way<0>(tlb_entry);
-        return tlb_entry;
-    } else if (tlb_entry[1].tag == TLB_INVALID_TAG) {
-        tlb2_touch_way<1>(tlb_entry);
-        return &tlb_entry[1];
-    } else if (tlb_entry[2].tag == TLB_INVALID_TAG) {
-        tlb2_touch_way<2>(tlb_entry);
-        return &tlb_entry[2];
-    } else if (tlb_entry[3].tag == TLB_INVALID_TAG) {
-        tlb2_touch_way<3>(tlb_entry);
-        return &tlb_entry[3];
-    } else { // no free entries, replace an existing one according with the hLRU policy
-#ifdef TLB_PROFILING
-        num_entry_replacements++;
-#endif
-        if (tlb_entry[0].lru_bits == 0) {
-            tlb2_touch_way<0>(tlb_entry);
-            return tlb_entry;
-        } else if (tlb_entry[1].lru_bits == 0) {
-            tlb2_touch_way<1>(tlb_entry);
-            return &tlb_entry[1];
-        } else if (tlb_entry[2].lru_bits == 0) {
-            tlb2_touch_way<2>(tlb_entry);
-            return &tlb_entry[2];
-        } else {
-            tlb2_touch_way<3>(tlb_entry);
-            return &tlb_entry[3];
+    for (way = 0; way < tlb2_ways; way++) {
+        if (tlb_set[way].tag == TLB_INVALID_TAG) {
+            tlb2_touch_way(tlb_set, way);
+            return &tlb_set[way];
         }
+        if (tlb_set[way].lru_bits < tlb_set[victim].lru_bits)
+            victim = way;
     }
+
+    // no free entries, replace the least recently used one
+    MMU_STAT_INC(num_entry_replacements);
+    tlb2_touch_way(tlb_set, victim);
+    return &tlb_set[victim];
 }
 
 static TLBEntry* itlb2_refill(uint32_t guest_va)
@@ -886,29 +873,15 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
 
 template <const TLBType tlb_type>
 static inline TLBEntry* lookup_secondary_tlb(uint32_t guest_va, uint32_t tag) {
-    TLBEntry *tlb_entry;
+    TLBEntry *tlb_set = tlb2_get_set<tlb_type>(guest_va);
 
-    if (tlb_type == TLBType::ITLB) {
-        tlb_entry = &pCurITLB2[((guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
-    } else {
-        tlb_entry = &pCurDTLB2[((guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
-    }
-
-    if (tlb_entry[0].tag == tag) {
-        tlb2_touch_way<0>(tlb_entry);
-    } else if (tlb_entry[1].tag == tag) {
-        tlb2_touch_way<1>(tlb_entry);
-        tlb_entry = &tlb_entry[1];
-    } else if (tlb_entry[2].tag == tag) {
-        tlb2_touch_way<2>(tlb_entry);
-        tlb_entry = &tlb_entry[2];
-    } else if (tlb_entry[3].tag == tag) {
-        tlb2_touch_way<3>(tlb_entry);
-        tlb_entry = &tlb_entry[3];
-    } else {
-        return nullptr;
+    for (uint32_t way = 0; way < tlb2_ways; way++) {
+        if (tlb_set[way].tag == tag) {
+            tlb2_touch_way(tlb_set, way);
+            return &tlb_set[way];
+        }
     }
-    return tlb_entry;
+    return nullptr;
 }
 
 struct TLBLookupResult {
@@ -922,9 +895,9 @@ static inline TLBLookupResult lookup_tlb(uint32_t guest_va, uint32_t tag)
 {
     TLBEntry *primary_entry;
     if constexpr (tlb_type == TLBType::ITLB) {
-        primary_entry = &pCurITLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
+        primary_entry = &pCurITLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb1_size_mask];
     } else {
-        primary_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
+        primary_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb1_size_mask];
     }
 
     if (primary_entry->tag == tag) {
@@ -996,34 +969,26 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
     TLBEntry *tlb1_entry, *tlb2_entry;
     uint8_t *host_va;
 
-#ifdef MMU_PROFILING
-    exec_reads_total++;
-#endif
+    MMU_STAT_INC(exec_reads_total);
 
     const uint32_t tag = vaddr & ~0xFFFUL;
 
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::ITLB>(vaddr, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary ITLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_itlb_hits++;
-#endif
+        MMU_STAT_INC(num_primary_itlb_hits);
         host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + vaddr);
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_itlb_refills++;
-#endif
+            MMU_STAT_INC(num_itlb_refills);
             // secondary ITLB miss ->
             // perform full address translation and refill the secondary ITLB
             tlb2_entry = itlb2_refill(vaddr);
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_itlb_hits++;
+            MMU_STAT_INC(num_secondary_itlb_hits);
         }
-#endif
         // refill the primary ITLB
         promote_tlb_entry<TLBType::ITLB>(tlb1_entry, tlb2_entry);
         host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + vaddr);
@@ -1035,19 +1000,19 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
     return host_va;
 }
 
-static void tlb_flush_primary_entry(std::array<TLBEntry, TLB_SIZE> &tlb1, uint32_t tag)
+static void tlb_flush_primary_entry(std::vector<TLBEntry> &tlb1, uint32_t tag)
 {
-    TLBEntry *tlb_entry = &tlb1[(tag >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
+    TLBEntry *tlb_entry = &tlb1[(tag >> PPC_PAGE_SIZE_BITS) & tlb1_size_mask];
     if (tlb_entry->tag != TLB_INVALID_TAG && (tlb_entry->tag & TLB_VPS_MASK) == tag) {
         tlb_entry->tag = TLB_INVALID_TAG;
         //LOG_F(INFO, "Invalidated primary TLB entry at 0x%X", tag);
     }
 }
 
-static void tlb_flush_secondary_entry(std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> &tlb2, uint32_t tag)
+static void tlb_flush_secondary_entry(std::vector<TLBEntry> &tlb2, uint32_t tag)
 {
-    TLBEntry *tlb_entry = &tlb2[((tag >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
-    for (int i = 0; i < TLB2_WAYS; i++) {
+    TLBEntry *tlb_entry = &tlb2[((tag >> PPC_PAGE_SIZE_BITS) & tlb2_size_mask) * tlb2_ways];
+    for (uint32_t i = 0; i < tlb2_ways; i++) {
         if (tlb_entry[i].tag != TLB_INVALID_TAG && (tlb_entry[i].tag & TLB_VPS_MASK) == tag) {
             tlb_entry[i].tag = TLB_INVALID_TAG;
             //LOG_F(INFO, "Invalidated secondary TLB entry at 0x%X", tag);
@@ -1072,6 +1037,19 @@ void tlb_flush_entry(uint32_t ea)
     tlb_flush_secondary_entry(dtlb2_mode3, tag);
 }
 
+void mmu_phys_map_changed()
+{
+    // Host pointers and region descriptors cached in TLB entries may refer
+    // to regions that no longer exist so invalidate all entries regardless
+    // of their origin, including those created in real addressing mode.
+    for (auto tlb : {&itlb1_mode1, &itlb2_mode1, &itlb1_mode2, &itlb2_mode2,
+                     &itlb1_mode3, &itlb2_mode3, &dtlb1_mode1, &dtlb2_mode1,
+                     &dtlb1_mode2, &dtlb2_mode2, &dtlb1_mode3, &dtlb2_mode3}) {
+        for (auto &tlb_el : *tlb)
+            tlb_el.tag = TLB_INVALID_TAG;
+    }
+}
+
 static void mpc601_bat_update(uint32_t bat_reg)
 {
     PPC_BAT_entry *ibat_entry, *dbat_entry;
@@ -1184,9 +1162,9 @@ void mmu_pat_ctx_changed()
 
 // Forward declarations.
 template <class T>
-static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARGS_SWAP_MUNGED);
+static inline T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARGS_SWAP_MUNGED);
 template <class T>
-static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va, T value ARGS_SWAP_MUNGED);
+static inline void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va, T value ARGS_SWAP_MUNGED);
 
 template <class T>
 inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
@@ -1213,9 +1191,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::DTLB>(guest_va, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary TLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_dtlb_hits++;
-#endif
+        MMU_STAT_INC(num_primary_dtlb_hits);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
         needs_swap = mem_ctrl_instance->needs_swap_endian(false);
@@ -1229,9 +1205,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_dtlb_refills++;
-#endif
+            MMU_STAT_INC(num_dtlb_refills);
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 0);
@@ -1239,11 +1213,9 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
                 return (T)UnmappedVal;
             }
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_dtlb_hits++;
+            MMU_STAT_INC(num_secondary_dtlb_hits);
         }
-#endif
 
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
             // refill the primary TLB
@@ -1259,9 +1231,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
 
             host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
-#ifdef MMU_PROFILING
-            iomem_reads_total++;
-#endif
+            MMU_STAT_INC(iomem_reads_total);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(tlb2_entry->rgn_desc);
@@ -1315,9 +1285,7 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
         }
     }
 
-#ifdef MMU_PROFILING
-    dmem_reads_total++;
-#endif
+    MMU_STAT_INC(dmem_reads_total);
 
     // handle unaligned memory accesses
     if (sizeof(T) > 1 && (guest_va & (sizeof(T) - 1))) {
@@ -1384,9 +1352,7 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     TLBLookupResult tlb_lookup = lookup_tlb<TLBType::DTLB>(guest_va, tag);
     tlb1_entry = tlb_lookup.primary_entry;
     if (tlb_lookup.primary_hit) { // primary TLB hit -> fast path
-#ifdef TLB_PROFILING
-        num_primary_dtlb_hits++;
-#endif
+        MMU_STAT_INC(num_primary_dtlb_hits);
         if (prepare_dtlb_write(tlb1_entry, guest_va)) {
             // don't forget to update the secondary TLB as well
             tlb2_entry = lookup_secondary_tlb<TLBType::DTLB>(guest_va, tag);
@@ -1405,9 +1371,7 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     } else {
         tlb2_entry = tlb_lookup.matched_entry;
         if (tlb2_entry == nullptr) {
-#ifdef TLB_PROFILING
-            num_dtlb_refills++;
-#endif
+            MMU_STAT_INC(num_dtlb_refills);
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 1);
@@ -1415,11 +1379,9 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
                 return;
             }
         }
-#ifdef TLB_PROFILING
         else {
-            num_secondary_dtlb_hits++;
+            MMU_STAT_INC(num_secondary_dtlb_hits);
         }
-#endif
         prepare_dtlb_write(tlb2_entry, guest_va);
 
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
@@ -1436,9 +1398,7 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
 
             host_va = (uint8_t *)(tlb1_entry->host_va_offs_w + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
-#ifdef MMU_PROFILING
-            iomem_writes_total++;
-#endif
+            MMU_STAT_INC(iomem_writes_total);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             needs_swap = mem_ctrl_instance->needs_swap_endian(tlb2_entry->rgn_desc);
@@ -1485,9 +1445,7 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
         }
     }
 
-#ifdef MMU_PROFILING
-    dmem_writes_total++;
-#endif
+    MMU_STAT_INC(dmem_writes_total);
 
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
     // swap now if needed
@@ -1531,7 +1489,7 @@ template void mmu_write_vmem<uint32_t>(uint32_t opcode, uint32_t guest_va, uint3
 template void mmu_write_vmem<uint64_t>(uint32_t opcode, uint32_t guest_va, uint64_t value);
 
 template <class T>
-static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARGS_SWAP_MUNGED)
+static inline T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARGS_SWAP_MUNGED)
 {
     if ((sizeof(T) == 8) && (guest_va & 3)) {
 #ifndef PPC_TESTS
@@ -1539,16 +1497,31 @@ static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARG
 #endif
     }
 
+    const bool crosses_page = ((guest_va & 0xFFF) + sizeof(T)) > 0x1000;
+
+    // Misaligned accesses within a single memory page are serviced by
+    // a single host unaligned load followed by a byte swap.
+    if (!crosses_page
+#if SUPPORTS_PPC_LITTLE_ENDIAN_MODE || SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
+        && !(sizeof(T) == sizeof(uint64_t) && munged)
+#endif
+    ) {
+        MMU_STAT_INC(unaligned_reads);
+#if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
+        if (needs_swap)
+            return read_le_host_u<T>(host_va);
+#endif
+        return read_be_host_u<T>(host_va);
+    }
+
     T result = 0;
 
     // is it a misaligned cross-page read?
-    if ((sizeof(T) > 1) && ((guest_va & 0xFFF) + sizeof(T)) > 0x1000) {
-#ifdef MMU_PROFILING
-        unaligned_crossp_r++;
-#endif
+    if (crosses_page) {
+        MMU_STAT_INC(unaligned_crossp_r);
         // Break such a memory access into multiple, bytewise accesses.
-        // Because such accesses suffer a performance penalty, they will be
-        // presumably very rare so don't waste time optimizing the code below.
+        // The two halves may be backed by different host regions or even
+        // MMIO so they have to go through the full translation each.
         for (int i = 0; i < sizeof(T); guest_va++, i++) {
 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
             if (needs_swap) {
@@ -1562,7 +1535,7 @@ static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARG
             }
         }
 #if SUPPORTS_PPC_LITTLE_ENDIAN_MODE || SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-    } else if (sizeof(T) == sizeof(uint64_t) && munged) {
+    } else {
         // Munged host address for an unaligned 64-bit read.
         // Check for cross-page read, to read the upper 32 bits correctly.
         if (((guest_va & 0xFFF) + 12) > 0x1000) {
@@ -1571,43 +1544,17 @@ static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va ARG
         } else {
             result =
                 #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-                    needs_swap ? (READ_DWORD_LE_U(host_va + 8)) :
+                    needs_swap ? read_le_host_u<uint32_t>(host_va + 8) :
                 #endif
-                (READ_DWORD_BE_U(host_va + 8));
+                read_be_host_u<uint32_t>(host_va + 8);
         }
         result <<= 32;
         result |=
             #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-                needs_swap ? (READ_DWORD_LE_U(host_va)) :
+                needs_swap ? read_le_host_u<uint32_t>(host_va) :
             #endif
-            (READ_DWORD_BE_U(host_va));
+            read_be_host_u<uint32_t>(host_va);
 #endif
-    } else {
-#ifdef MMU_PROFILING
-        unaligned_reads++;
-#endif
-        switch(sizeof(T)) {
-            case 1:
-                return *host_va;
-            case 2:
-                return
-#if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-                    needs_swap ? (READ_WORD_LE_U(host_va)) :
-#endif
-                    (READ_WORD_BE_U(host_va));
-            case 4:
-                return
-#if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-                    needs_swap ? (READ_DWORD_LE_U(host_va)) :
-#endif
-                    (READ_DWORD_BE_U(host_va));
-            case 8:
-                return
-#if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-                    needs_swap ? (READ_QWORD_LE_U(host_va)) :
-#endif
-                    (READ_QWORD_BE_U(host_va));
-        }
     }
     return result;
 }
@@ -1618,7 +1565,7 @@ template uint32_t read_unaligned<uint32_t>(uint32_t opcode, uint32_t guest_va, u
 template uint64_t read_unaligned<uint64_t>(uint32_t opcode, uint32_t guest_va, uint8_t* host_va ARGS_SWAP_MUNGED);
 
 template <class T>
-static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va, T value ARGS_SWAP_MUNGED)
+static inline void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va, T value ARGS_SWAP_MUNGED)
 {
     if ((sizeof(T) == 8) && (guest_va & 3)) {
 #ifndef PPC_TESTS
@@ -1626,14 +1573,27 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
 #endif
     }
 
-    // is it a misaligned cross-page write?
-    if ((sizeof(T) > 1) && ((guest_va & 0xFFF) + sizeof(T)) > 0x1000) {
-#ifdef MMU_PROFILING
-        unaligned_crossp_w++;
+    const bool crosses_page = ((guest_va & 0xFFF) + sizeof(T)) > 0x1000;
+
+    // Misaligned accesses within a single memory page are serviced by
+    // a single host unaligned store. The value has already been swapped
+    // by the caller if the memory controller requires it.
+    if (!crosses_page
+#if SUPPORTS_PPC_LITTLE_ENDIAN_MODE || SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
+        && !(sizeof(T) == sizeof(uint64_t) && munged)
 #endif
+    ) {
+        MMU_STAT_INC(unaligned_writes);
+        write_be_host_u<T>(host_va, value);
+        return;
+    }
+
+    // is it a misaligned cross-page write?
+    if (crosses_page) {
+        MMU_STAT_INC(unaligned_crossp_w);
         // Break such a memory access into multiple, bytewise accesses.
-        // Because such accesses suffer a performance penalty, they will be
-        // presumably very rare so don't waste time optimizing the code below.
+        // The two halves may be backed by different host regions or even
+        // MMIO so they have to go through the full translation each.
 
         uint32_t shift = (sizeof(T) - 1) * 8;
 
@@ -1641,7 +1601,7 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
             mmu_write_vmem<uint8_t>(opcode, guest_va, (value >> shift) & 0xFF);
         }
 #if SUPPORTS_PPC_LITTLE_ENDIAN_MODE || SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
-    } else if (sizeof(T) == sizeof(uint64_t) && munged) {
+    } else {
         // Munged host address for an unaligned 64-bit write.
         // Check for cross-page write, to write the upper 32 bits correctly.
         uint32_t value32 = (value >> 32);
@@ -1657,7 +1617,7 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
             mmu_write_vmem<uint32_t>(opcode, guest_va + mem_munge_address<uint32_t>(8), value32);
         } else {
             // Not cross-page, so just write via host address.
-            WRITE_DWORD_BE_U(host_va + 8, value32);
+            write_be_host_u<uint32_t>(host_va + 8, value32);
         }
         // Write the lower 32 bits.
     #if SUPPORTS_MEMORY_CTRL_ENDIAN_MODE
@@ -1668,26 +1628,8 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
         {
             value32 = (uint32_t)value;
         }
-        WRITE_DWORD_BE_U(host_va, value32);
-#endif
-    } else {
-#ifdef MMU_PROFILING
-        unaligned_writes++;
+        write_be_host_u<uint32_t>(host_va, value32);
 #endif
-        switch(sizeof(T)) {
-            case 1:
-                *host_va = value;
-                break;
-            case 2:
-                WRITE_WORD_BE_U(host_va, value);
-                break;
-            case 4:
-                WRITE_DWORD_BE_U(host_va, value);
-                break;
-            case 8:
-                WRITE_QWORD_BE_U(host_va, value);
-                break;
-        }
     }
 }
 
@@ -1698,11 +1640,6 @@ template void write_unaligned<uint64_t>(uint32_t opcode, uint32_t guest_va, uint
 
 
 /* MMU profiling. */
-#ifdef MMU_PROFILING
-
-#include "utils/profiler.h"
-#include <memory>
-
 class MMUProfile : public BaseProfile {
 public:
     MMUProfile() : BaseProfile("PPC_MMU") {}
@@ -1712,71 +1649,65 @@ public:
 
         vars.push_back({.name = "Data Memory Reads Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = dmem_reads_total});
+                        .value = mmu_stats.dmem_reads_total});
 
         vars.push_back({.name = "I/O Memory Reads Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = iomem_reads_total});
+                        .value = mmu_stats.iomem_reads_total});
 
         vars.push_back({.name = "Data Memory Writes Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = dmem_writes_total});
+                        .value = mmu_stats.dmem_writes_total});
 
         vars.push_back({.name = "I/O Memory Writes Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = iomem_writes_total});
+                        .value = mmu_stats.iomem_writes_total});
 
         vars.push_back({.name = "Reads from Executable Memory",
                         .format = ProfileVarFmt::DEC,
-                        .value = exec_reads_total});
+                        .value = mmu_stats.exec_reads_total});
 
         vars.push_back({.name = "BAT Translations Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = bat_transl_total});
+                        .value = mmu_stats.bat_transl_total});
 
         vars.push_back({.name = "Page Table Translations Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = ptab_transl_total});
+                        .value = mmu_stats.ptab_transl_total});
 
         vars.push_back({.name = "Unaligned Reads Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = unaligned_reads});
+                        .value = mmu_stats.unaligned_reads});
 
         vars.push_back({.name = "Unaligned Writes Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = unaligned_writes});
+                        .value = mmu_stats.unaligned_writes});
 
         vars.push_back({.name = "Unaligned Crosspage Reads Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = unaligned_crossp_r});
+                        .value = mmu_stats.unaligned_crossp_r});
 
         vars.push_back({.name = "Unaligned Crosspage Writes Total",
                         .format = ProfileVarFmt::DEC,
-                        .value = unaligned_crossp_w});
+                        .value = mmu_stats.unaligned_crossp_w});
     }
 
     void reset() {
-        dmem_reads_total   = 0;
-        iomem_reads_total  = 0;
-        dmem_writes_total  = 0;
-        iomem_writes_total = 0;
-        exec_reads_total   = 0;
-        bat_transl_total   = 0;
-        ptab_transl_total  = 0;
-        unaligned_reads    = 0;
-        unaligned_writes   = 0;
-        unaligned_crossp_r = 0;
-        unaligned_crossp_w = 0;
+        mmu_stats.dmem_reads_total   = 0;
+        mmu_stats.iomem_reads_total  = 0;
+        mmu_stats.dmem_writes_total  = 0;
+        mmu_stats.iomem_writes_total = 0;
+        mmu_stats.exec_reads_total   = 0;
+        mmu_stats.bat_transl_total   = 0;
+        mmu_stats.ptab_transl_total  = 0;
+        mmu_stats.unaligned_reads    = 0;
+        mmu_stats.unaligned_writes   = 0;
+        mmu_stats.unaligned_crossp_r = 0;
+        mmu_stats.unaligned_crossp_w = 0;
     }
 };
-#endif
 
 /* SoftTLB profiling. */
-#ifdef TLB_PROFILING
-
-#include "utils/profiler.h"
-#include <memory>
-
 class TLBProfile : public BaseProfile {
 public:
     TLBProfile() : BaseProfile("PPC:MMU:TLB") {}
@@ -1784,43 +1715,68 @@ public:
     void populate_variables(std::vector<ProfileVar>& vars) {
         vars.clear();
 
+        uint64_t itlb_total = mmu_stats.num_primary_itlb_hits +
+            mmu_stats.num_secondary_itlb_hits + mmu_stats.num_itlb_refills;
+        uint64_t dtlb_total = mmu_stats.num_primary_dtlb_hits +
+            mmu_stats.num_secondary_dtlb_hits + mmu_stats.num_dtlb_refills;
+
         vars.push_back({.name = "Number of hits in the primary ITLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_primary_itlb_hits});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_primary_itlb_hits,
+            .count_total = itlb_total});
 
         vars.push_back({.name = "Number of hits in the secondary ITLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_secondary_itlb_hits});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_secondary_itlb_hits,
+            .count_total = itlb_total});
 
         vars.push_back({.name = "Number of ITLB refills",
-            .format = ProfileVarFmt::DEC,
-            .value = num_itlb_refills});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_itlb_refills,
+            .count_total = itlb_total});
 
         vars.push_back({.name = "Number of hits in the primary DTLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_primary_dtlb_hits});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_primary_dtlb_hits,
+            .count_total = dtlb_total});
 
         vars.push_back({.name = "Number of hits in the secondary DTLB",
-            .format = ProfileVarFmt::DEC,
-            .value = num_secondary_dtlb_hits});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_secondary_dtlb_hits,
+            .count_total = dtlb_total});
 
         vars.push_back({.name = "Number of DTLB refills",
-            .format = ProfileVarFmt::DEC,
-            .value = num_dtlb_refills});
+            .format = ProfileVarFmt::COUNT,
+            .value = mmu_stats.num_dtlb_refills,
+            .count_total = dtlb_total});
 
         vars.push_back({.name = "Number of replaced TLB entries",
             .format = ProfileVarFmt::DEC,
-            .value = num_entry_replacements});
+            .value = mmu_stats.num_entry_replacements});
+
+        vars.push_back({.name = "Primary TLB size",
+            .format = ProfileVarFmt::DEC,
+            .value = tlb1_size});
+
+        vars.push_back({.name = "Secondary TLB sets",
+            .format = ProfileVarFmt::DEC,
+            .value = tlb2_sets});
+
+        vars.push_back({.name = "Secondary TLB ways",
+            .format = ProfileVarFmt::DEC,
+            .value = tlb2_ways});
     }
 
     void reset() {
-        num_primary_dtlb_hits   = 0;
-        num_secondary_dtlb_hits = 0;
-        num_dtlb_refills        = 0;
-        num_entry_replacements = 0;
+        mmu_stats.num_primary_itlb_hits   = 0;
+        mmu_stats.num_secondary_itlb_hits = 0;
+        mmu_stats.num_itlb_refills        = 0;
+        mmu_stats.num_primary_dtlb_hits   = 0;
+        mmu_stats.num_secondary_dtlb_hits = 0;
+        mmu_stats.num_dtlb_refills        = 0;
+        mmu_stats.num_entry_replacements  = 0;
     }
 };
-#endif
 
 uint64_t mem_read_dbg(uint32_t virt_addr, uint32_t size) {
     uint32_t save_dsisr, save_dar;
@@ -1977,8 +1933,12 @@ bool mmu_translate_dbg(uint32_t guest_va, uint32_t &guest_pa) {
     return is_mapped;
 }
 
-template <std::size_t N>
-static void invalidate_tlb_entries(std::array<TLBEntry, N> &tlb) {
+static void init_tlb_entries(std::vector<TLBEntry> &tlb, size_t num_entries) {
+    if (tlb.size() != num_entries) {
+        tlb.resize(num_entries);
+        tlb.shrink_to_fit();
+    }
+
     for (auto &tlb_el : tlb) {
         tlb_el.tag = TLB_INVALID_TAG;
         tlb_el.flags = 0;
@@ -1990,6 +1950,32 @@ static void invalidate_tlb_entries(std::array<TLBEntry, N> &tlb) {
     }
 }
 
+bool mmu_set_tlb_geometry(uint32_t tlb1_entries, uint32_t tlb2_num_sets,
+                          uint32_t tlb2_num_ways)
+{
+    auto is_pow2 = [](uint32_t val) { return val && !(val & (val - 1)); };
+
+    if (!is_pow2(tlb1_entries) || tlb1_entries < TLB_MIN_SIZE ||
+        tlb1_entries > TLB_MAX_SIZE) {
+        LOG_F(ERROR, "Invalid primary TLB size %u", tlb1_entries);
+        return false;
+    }
+    if (!is_pow2(tlb2_num_sets) || tlb2_num_sets < TLB_MIN_SIZE ||
+        tlb2_num_sets > TLB_MAX_SIZE) {
+        LOG_F(ERROR, "Invalid number of secondary TLB sets %u", tlb2_num_sets);
+        return false;
+    }
+    if (!is_pow2(tlb2_num_ways) || tlb2_num_ways > TLB2_MAX_WAYS) {
+        LOG_F(ERROR, "Invalid secondary TLB associativity %u", tlb2_num_ways);
+        return false;
+    }
+
+    tlb1_size = tlb1_entries;
+    tlb2_sets = tlb2_num_sets;
+    tlb2_ways = tlb2_num_ways;
+    return true;
+}
+
 void ppc_mmu_init()
 {
     gPendingIInvalidationSources = 0;
@@ -2017,30 +2003,38 @@ void ppc_mmu_init()
     for (reg = 536; reg <= 543; reg++)
         dbat_update(reg);
 
-    // invalidate all IDTLB entries
-    invalidate_tlb_entries(itlb1_mode1);
-    invalidate_tlb_entries(itlb1_mode2);
-    invalidate_tlb_entries(itlb1_mode3);
-    invalidate_tlb_entries(itlb2_mode1);
-    invalidate_tlb_entries(itlb2_mode2);
-    invalidate_tlb_entries(itlb2_mode3);
-    // invalidate all DTLB entries
-    invalidate_tlb_entries(dtlb1_mode1);
-    invalidate_tlb_entries(dtlb1_mode2);
-    invalidate_tlb_entries(dtlb1_mode3);
-    invalidate_tlb_entries(dtlb2_mode1);
-    invalidate_tlb_entries(dtlb2_mode2);
-    invalidate_tlb_entries(dtlb2_mode3);
-
+    LOG_F(9, "SoftTLB geometry: %u primary entries, %u secondary sets x %u ways",
+          tlb1_size, tlb2_sets, tlb2_ways);
+
+    tlb1_size_mask = tlb1_size - 1;
+    tlb2_size_mask = tlb2_sets - 1;
+
+    // allocate and invalidate all ITLB entries
+    init_tlb_entries(itlb1_mode1, tlb1_size);
+    init_tlb_entries(itlb1_mode2, tlb1_size);
+    init_tlb_entries(itlb1_mode3, tlb1_size);
+    init_tlb_entries(itlb2_mode1, tlb2_sets * tlb2_ways);
+    init_tlb_entries(itlb2_mode2, tlb2_sets * tlb2_ways);
+    init_tlb_entries(itlb2_mode3, tlb2_sets * tlb2_ways);
+    // allocate and invalidate all DTLB entries
+    init_tlb_entries(dtlb1_mode1, tlb1_size);
+    init_tlb_entries(dtlb1_mode2, tlb1_size);
+    init_tlb_entries(dtlb1_mode3, tlb1_size);
+    init_tlb_entries(dtlb2_mode1, tlb2_sets * tlb2_ways);
+    init_tlb_entries(dtlb2_mode2, tlb2_sets * tlb2_ways);
+    init_tlb_entries(dtlb2_mode3, tlb2_sets * tlb2_ways);
+
+    // TLB storage may have moved so force reloading of the current TLB pointers
+    CurITLBMode = 0xFF;
+    CurDTLBMode = 0xFF;
     mmu_change_mode();
 
-#ifdef MMU_PROFILING
-    gProfilerObj->register_profile("PPC:MMU",
-        std::unique_ptr<BaseProfile>(new MMUProfile()));
-#endif
+    // standalone users of the CPU core (tests, benchmarks) have no profiler
+    if (gProfilerObj) {
+        gProfilerObj->register_profile("PPC:MMU",
+            std::unique_ptr<BaseProfile>(new MMUProfile()));
 
-#ifdef TLB_PROFILING
-    gProfilerObj->register_profile("PPC:MMU:TLB",
-    std::unique_ptr<BaseProfile>(new TLBProfile()));
-#endif
+        gProfilerObj->register_profile("PPC:MMU:TLB",
+            std::unique_ptr<BaseProfile>(new TLBProfile()));
+    }
 }
@@ -83,17 +83,32 @@ constexpr uint32_t PPC_PAGE_SIZE_BITS = 12;
 constexpr uint32_t PPC_PAGE_SIZE      = (1 << PPC_PAGE_SIZE_BITS);
 constexpr uint32_t PPC_PAGE_MASK      = ~(PPC_PAGE_SIZE - 1);
 
+/** SoftTLB geometry limits and defaults. */
+constexpr uint32_t TLB_MIN_SIZE       = 16;
+constexpr uint32_t TLB_MAX_SIZE       = 65536;
+constexpr uint32_t TLB2_MAX_WAYS      = 16;
+constexpr uint32_t TLB1_DEF_SIZE      = 4096;
+constexpr uint32_t TLB2_DEF_SETS      = 4096;
+constexpr uint32_t TLB2_DEF_WAYS      = 4;
+
 extern std::function<void(uint32_t bat_reg)> ibat_update;
 extern std::function<void(uint32_t bat_reg)> dbat_update;
 
 extern PPC_BAT_entry ibat_array[4];
 extern PPC_BAT_entry dbat_array[4];
 
+extern bool mmu_stats_enabled;
+
+/** Set SoftTLB geometry. Takes effect on the next ppc_mmu_init() call. */
+extern bool mmu_set_tlb_geometry(uint32_t tlb1_entries, uint32_t tlb2_num_sets,
+                                 uint32_t tlb2_num_ways);
+
 extern MapDmaResult mmu_map_dma_mem(uint32_t addr, uint32_t size, bool allow_mmio = false, bool is_dbg = false);
 
 extern void mmu_change_mode(void);
 extern void mmu_pat_ctx_changed();
 extern void tlb_flush_entry(uint32_t ea);
+extern void mmu_phys_map_changed();
 extern void mmu_dcbz(uint32_t opcode, uint32_t guest_va);
 
 extern uint64_t mem_read_dbg(uint32_t virt_addr, uint32_t size);
@@ -119,6 +119,7 @@ static void show_help() {
     cout << "  setenv V N     -- set NVRAM variable V to value N." << endl;
     cout << endl;
     cout << "  autograbmouse H -- auto grab the mouse if H is not zero." << endl;
+    cout << "  mmustats H     -- collect MMU/TLB statistics if H is not zero." << endl;
     cout << endl;
     cout << "  restart        -- restart the machine" << endl;
     cout << "  quit           -- quit the debugger" << endl;
@@ -1184,6 +1185,18 @@ void DppcDebugger::enter_debugger() {
                 continue;
             }
             g_auto_grab_mouse = num;
+        } else if (cmd == "mmustats") {
+            cmd = "";
+            string value;
+            int num;
+            ss >> value;
+            try {
+                num = str2num(value);
+            } catch (invalid_argument& exc) {
+                cout << exc.what() << endl;
+                continue;
+            }
+            mmu_stats_enabled = num;
         } else {
             if (!cmd.empty()) {
                 cout << "Unknown command: " << cmd << endl;
@@ -172,6 +172,37 @@ void AtaBaseDevice::write(const uint8_t reg_addr, const uint16_t value) {
     }
 }
 
+/* Bulk data port path. Accesses that don't finish the current block are
+   served straight from the data buffer; the access completing a block
+   goes through the word-wise path to run the end-of-block handling. */
+uint32_t AtaBaseDevice::read_data(const int size) {
+    const int len = (size == 4) ? 4 : 2; // narrower accesses still move a word
+
+    if (this->has_data() && this->chunk_cnt > len) {
+        this->chunk_cnt -= len;
+        uint32_t val = this->get_data();
+        if (size == 4)
+            val = (val << 16) | this->get_data();
+        return val;
+    }
+
+    return AtaInterface::read_data(size);
+}
+
+void AtaBaseDevice::write_data(const uint32_t val, const int size) {
+    const int len = (size == 4) ? 4 : 2;
+
+    if (this->is_selected() && this->has_data() && this->chunk_cnt > len) {
+        this->chunk_cnt -= len;
+        if (size == 4)
+            *this->cur_data_ptr++ = BYTESWAP_16(uint16_t(val >> 16));
+        *this->cur_data_ptr++ = BYTESWAP_16(uint16_t(val));
+        return;
+    }
+
+    AtaInterface::write_data(val, size);
+}
+
 void AtaBaseDevice::device_control(const uint8_t new_ctrl) {
     // perform ATA Soft Reset if requested
     if ((this->r_dev_ctrl ^ new_ctrl) & SRST) {
@@ -193,53 +224,74 @@ void AtaBaseDevice::device_control(const uint8_t new_ctrl) {
 }
 
 int AtaBaseDevice::pull_data(uint8_t *buf, int len) {
+    DmaSgEntry sg = {buf, uint32_t(len)};
+    return this->pull_data_sg(&sg, 1);
+}
+
+int AtaBaseDevice::push_data(uint8_t *buf, int len) {
+    DmaSgEntry sg = {buf, uint32_t(len)};
+    return this->push_data_sg(&sg, 1);
+}
+
+int AtaBaseDevice::pull_data_sg(const DmaSgEntry *sg, int count) {
     if (!this->xfer_cnt || !this->is_dma_xfer)
         return 0;
 
-    int xfer_size = std::min(this->xfer_cnt, len);
-
-    if (this->xfer_cnt != len) {
-        LOG_F(9, "%s: DMA pull size differs from descriptor, remaining=%d requested=%d",
-              this->name.c_str(), this->xfer_cnt, len);
-    }
+    int total = 0;
 
-    //for (int i = 0; i < xfer_size >> 1; i++)
-    //    this->data_ptr[i] = BYTESWAP_16(this->data_ptr[i]);
+    for (int i = 0; i < count && this->xfer_cnt; i++) {
+        int xfer_size = std::min(this->xfer_cnt, int(sg[i].len));
 
-    std::memcpy(buf, this->data_ptr, xfer_size);
-    this->data_ptr = (uint16_t *)((uint8_t *)this->data_ptr + xfer_size);
+        std::memcpy(sg[i].buf, this->data_ptr, xfer_size);
+        this->data_ptr = (uint16_t *)((uint8_t *)this->data_ptr + xfer_size);
+        this->xfer_cnt -= xfer_size;
+        total += xfer_size;
+    }
 
-    this->xfer_cnt -= xfer_size;
-    if (!this->xfer_cnt) {
-        this->is_dma_xfer = false;
-        this->data_ptr = nullptr;
-        TimerManager::get_instance()->add_oneshot_timer(500, [this]() {
-            this->r_status &= ~(BSY | DRQ);
-            this->update_intrq(1);
-        });
+    if (this->xfer_cnt) {
+        LOG_F(9, "%s: DMA pull shorter than the command, remaining=%d",
+              this->name.c_str(), this->xfer_cnt);
     } else {
-        this->r_status &= ~BSY;
-        this->r_status |= DRQ;
+        this->data_ptr = nullptr;
     }
 
-    return xfer_size;
+    this->dma_xfer_step();
+
+    return total;
 }
 
-int AtaBaseDevice::push_data(uint8_t *buf, int len) {
+int AtaBaseDevice::push_data_sg(const DmaSgEntry *sg, int count) {
     if (!this->xfer_cnt || !this->is_dma_xfer)
         return 0;
 
-    int xfer_size = std::min(this->xfer_cnt, len);
+    int total = 0;
+
+    for (int i = 0; i < count && this->xfer_cnt; i++) {
+        int xfer_size = std::min(this->xfer_cnt, int(sg[i].len));
 
-    std::memcpy(this->cur_data_ptr, buf, xfer_size);
-    this->cur_data_ptr = (uint16_t *)((uint8_t *)this->cur_data_ptr + xfer_size);
+        std::memcpy(this->cur_data_ptr, sg[i].buf, xfer_size);
+        this->cur_data_ptr = (uint16_t *)((uint8_t *)this->cur_data_ptr + xfer_size);
+        this->xfer_cnt -= xfer_size;
+        total += xfer_size;
+    }
 
-    this->xfer_cnt -= xfer_size;
     if (!this->xfer_cnt) {
         this->post_xfer_action();
-        this->is_dma_xfer = false;
         this->data_ptr = nullptr;
         this->cur_data_ptr = nullptr;
+    }
+
+    this->dma_xfer_step();
+
+    return total;
+}
+
+/* Update the device state after a DMA transfer has moved some data.
+   Completion is signalled once per transfer regardless of the number of
+   buffers involved. */
+void AtaBaseDevice::dma_xfer_step() {
+    if (!this->xfer_cnt) {
+        this->is_dma_xfer = false;
         TimerManager::get_instance()->add_oneshot_timer(500, [this]() {
             this->r_status &= ~(BSY | DRQ);
             this->update_intrq(1);
@@ -248,8 +300,6 @@ int AtaBaseDevice::push_data(uint8_t *buf, int len) {
         this->r_status &= ~BSY;
         this->r_status |= DRQ;
     }
-
-    return xfer_size;
 }
 
 void AtaBaseDevice::update_intrq(uint8_t new_intrq_state) {
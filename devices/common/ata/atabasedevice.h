@@ -47,8 +47,12 @@ public:
 
     uint16_t read(const uint8_t reg_addr) override;
     void write(const uint8_t reg_addr, const uint16_t value) override;
+    uint32_t read_data(const int size) override;
+    void write_data(const uint32_t val, const int size) override;
     int pull_data(uint8_t *buf, int len) override;
     int push_data(uint8_t *buf, int len) override;
+    int pull_data_sg(const DmaSgEntry *sg, int count) override;
+    int push_data_sg(const DmaSgEntry *sg, int count) override;
 
     virtual int perform_command() = 0;
 
@@ -78,6 +82,7 @@ protected:
     }
 
     void prepare_xfer(int xfer_size, int block_size);
+    void dma_xfer_step();
 
     uint8_t my_dev_id = 0; // my IDE device ID configured by the host
     uint8_t device_type = ata_interface::DEVICE_TYPE_UNKNOWN;
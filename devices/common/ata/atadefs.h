@@ -24,6 +24,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef ATA_INTERFACE_H
 #define ATA_INTERFACE_H
 
+#include <devices/common/dmacore.h>
+
 #include <cinttypes>
 
 namespace ata_interface {
@@ -169,6 +171,26 @@ public:
     virtual int pull_data(uint8_t *buf, int len) { return 0; };
     virtual int push_data(uint8_t *buf, int len) { return 0; };
 
+    // DMA transfers covering a whole descriptor chain at once.
+    virtual int pull_data_sg(const DmaSgEntry *sg, int count) { return 0; };
+    virtual int push_data_sg(const DmaSgEntry *sg, int count) { return 0; };
+
+    // Data port accesses; a 32-bit access transfers two consecutive words,
+    // the first one in the upper half. IdeChannel decides whether its bus
+    // passes 32-bit accesses through.
+    virtual uint32_t read_data(const int size) {
+        uint32_t val = this->read(ata_interface::DATA);
+        if (size == 4)
+            val = (val << 16) | this->read(ata_interface::DATA);
+        return val;
+    }
+
+    virtual void write_data(const uint32_t val, const int size) {
+        if (size == 4)
+            this->write(ata_interface::DATA, val >> 16);
+        this->write(ata_interface::DATA, val & 0xFFFFU);
+    }
+
     virtual int  get_device_id() = 0;
     virtual void pdiag_callback() {}
 };
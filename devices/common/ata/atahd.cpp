@@ -38,6 +38,11 @@ using namespace ata_interface;
 AtaHardDisk::AtaHardDisk(std::string name) : AtaBaseDevice(name, DEVICE_TYPE_ATA) {
 }
 
+AtaHardDisk::~AtaHardDisk() {
+    // completions may still be in the timer mailbox, io_seq going away voids them
+    this->hdd_img.wait_idle();
+}
+
 int AtaHardDisk::device_postinit() {
     std::string hdd_config = GET_STR_PROP("hdd_config");
     if (hdd_config.empty()) {
@@ -78,6 +83,14 @@ void AtaHardDisk::insert_image(std::string filename) {
     this->calc_chs_params();
 }
 
+void AtaHardDisk::device_reset(bool is_soft_reset) {
+    // The worker thread may still be filling this->buffer for an aborted
+    // read. Let it finish before the next command reuses the buffer.
+    this->hdd_img.wait_idle();
+    (*this->io_seq)++; // drop pending read completions
+    AtaBaseDevice::device_reset(is_soft_reset);
+}
+
 int AtaHardDisk::perform_command() {
     this->r_status |= BSY;
     this->r_error = 0;
@@ -117,20 +130,31 @@ int AtaHardDisk::perform_command() {
                 }
                 ints_size *= this->sectors_per_int;
             }
-            hdd_img.read(buffer, offset, xfer_size);
-            this->data_ptr = (uint16_t *)this->buffer;
-            this->prepare_xfer(xfer_size, ints_size);
-            if (is_dma_cmd) {
-                this->is_dma_xfer = true;
-                this->r_status &= ~(BSY | DRQ | ERR);
-                this->r_status |= DRDY | DSC;
-                // TODO: Model ATA DMAREQ as a latched signal instead of relying
-                // on this delay to avoid racing DBDMA command startup.
-                this->host_obj->assert_dmareq(500);
-            } else {
-                // PIO commands generate IRQ for each sector or multiple block.
-                this->signal_data_ready();
-            }
+            // The drive stays busy until the host has delivered the data.
+            // The guest CPU continues to run in the meantime.
+            uint32_t io_seq = ++(*this->io_seq);
+            std::weak_ptr<uint32_t> cur_seq = this->io_seq;
+            hdd_img.read_async(buffer, offset, xfer_size,
+                [this, cur_seq, io_seq, xfer_size, ints_size, is_dma_cmd](uint64_t) {
+                    // ignore completions of commands aborted by a reset or
+                    // of a disk that has been destroyed meanwhile
+                    auto seq = cur_seq.lock();
+                    if (!seq || *seq != io_seq)
+                        return;
+                    this->data_ptr = (uint16_t *)this->buffer;
+                    this->prepare_xfer(xfer_size, ints_size);
+                    if (is_dma_cmd) {
+                        this->is_dma_xfer = true;
+                        this->r_status &= ~(BSY | DRQ | ERR);
+                        this->r_status |= DRDY | DSC;
+                        // TODO: Model ATA DMAREQ as a latched signal instead of relying
+                        // on this delay to avoid racing DBDMA command startup.
+                        this->host_obj->assert_dmareq(500);
+                    } else {
+                        // PIO commands generate IRQ for each sector or multiple block.
+                        this->signal_data_ready();
+                    }
+                });
         }
         break;
     case WRITE_MULTIPLE:
@@ -218,6 +242,7 @@ int AtaHardDisk::perform_command() {
         this->update_intrq(1);
         break;
     case FLUSH_CACHE: // used by the XNU kernel driver
+        this->hdd_img.flush();
         this->r_status &= ~(BSY | DRQ | ERR);
         this->update_intrq(1);
         break;
@@ -27,10 +27,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/common/ata/atabasedevice.h>
 #include <utils/imgfile.h>
 
+#include <memory>
 #include <string>
 
 constexpr auto ATA_HD_SEC_SIZE = 512;
-constexpr auto SECTORS_PER_INT = 16;
+constexpr auto SECTORS_PER_INT = 128; // max. READ/WRITE MULTIPLE block size
 
 // C:16383 x H:16 x S:63 = C:1032 x H:254 x S:63 = 8063.5078125 MiB = 8.46 GB
 constexpr auto ATA_BIOS_LIMIT = 16514064;
@@ -43,7 +44,7 @@ class AtaHardDisk : public AtaBaseDevice
 {
 public:
     AtaHardDisk(std::string name);
-    ~AtaHardDisk() = default;
+    ~AtaHardDisk();
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<AtaHardDisk>(new AtaHardDisk("ATA-HD"));
@@ -53,6 +54,7 @@ public:
 
     void insert_image(std::string filename);
     int perform_command() override;
+    void device_reset(bool is_soft_reset) override;
 
 protected:
     void        prepare_identify_info();
@@ -65,6 +67,10 @@ private:
     uint32_t    total_sectors = 0;
     uint64_t    cur_fpos = 0;
 
+    // Identifies the current async read request. Completions hold a weak
+    // reference so that the ones posted after the disk is gone are dropped.
+    std::shared_ptr<uint32_t> io_seq = std::make_shared<uint32_t>(0);
+
     // fictive disk geometry for CHS-to-LBA translation
     uint16_t    cylinders;
     uint8_t     heads;
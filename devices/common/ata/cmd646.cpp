@@ -49,8 +49,11 @@ CmdIdeCtrl::CmdIdeCtrl() : PCIDevice("cmd-ide") {
         this->notify_bar_change(bar_num);
     };
 
-    gMachineObj->add_device("CmdAta0", std::unique_ptr<IdeChannel>(new IdeChannel("CmdAta0")));
-    gMachineObj->add_device("CmdAta1", std::unique_ptr<IdeChannel>(new IdeChannel("CmdAta1")));
+    // A 32-bit PIO access puts the first data word into byte lanes 0-1 of
+    // the little-endian PCI bus. The big-endian host sees those lanes as the
+    // upper half of the value, which matches the order used by IdeChannel.
+    gMachineObj->add_device("CmdAta0", std::unique_ptr<IdeChannel>(new IdeChannel("CmdAta0", true)));
+    gMachineObj->add_device("CmdAta1", std::unique_ptr<IdeChannel>(new IdeChannel("CmdAta1", true)));
 
     this->ch0 = dynamic_cast<IdeChannel*>(gMachineObj->get_comp_by_name("CmdAta0"));
     this->ch1 = dynamic_cast<IdeChannel*>(gMachineObj->get_comp_by_name("CmdAta1"));
@@ -45,11 +45,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 using namespace ata_interface;
 
-IdeChannel::IdeChannel(const std::string name)
+IdeChannel::IdeChannel(const std::string name, bool dword_data)
 {
     this->set_name(name);
     this->supports_types(HWCompType::IDE_BUS);
 
+    this->dword_data = dword_data;
+
     this->device_stub = std::unique_ptr<AtaNullDevice>(new AtaNullDevice());
 
     this->devices[0] = this->device_stub.get();
@@ -66,6 +68,9 @@ void IdeChannel::register_device(int id, AtaInterface* dev_obj) {
 }
 
 uint32_t IdeChannel::read(const uint8_t reg_addr, const int size) {
+    if (reg_addr == DATA)
+        return this->devices[this->cur_dev]->read_data(this->dword_data ? size : 2);
+
     return this->devices[this->cur_dev]->read(reg_addr);
 }
 
@@ -78,7 +83,10 @@ void IdeChannel::write(const uint8_t reg_addr, const uint32_t val, const int siz
 
     // redirect register writes to both devices
     for (auto& dev : this->devices) {
-        dev->write(reg_addr, val);
+        if (reg_addr == DATA)
+            dev->write_data(val, this->dword_data ? size : 2);
+        else
+            dev->write(reg_addr, val);
     }
 }
 
@@ -90,6 +98,14 @@ int IdeChannel::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
     return this->devices[this->cur_dev]->push_data(buf, len);
 }
 
+int IdeChannel::xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+    return this->devices[this->cur_dev]->pull_data_sg(sg, count);
+}
+
+int IdeChannel::xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+    return this->devices[this->cur_dev]->push_data_sg(sg, count);
+}
+
 void IdeChannel::assert_dmareq(uint64_t delay) {
     TimerManager::get_instance()->add_oneshot_timer(delay, [this]() {
         //LOG_F(INFO, "%s: DMAREQ asserted", this->name.c_str());
@@ -37,7 +37,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 class IdeChannel : public HWComponent, public DmaDevice
 {
 public:
-    IdeChannel(const std::string name);
+    IdeChannel(const std::string name, bool dword_data = false);
     ~IdeChannel() = default;
 
     void register_device(int id, AtaInterface* dev_obj);
@@ -47,6 +47,8 @@ public:
 
     int xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) override;
     int xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) override;
+    int xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override;
+    int xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override;
 
     void assert_pdiag() {
         this->devices[0]->pdiag_callback();
@@ -73,6 +75,11 @@ private:
     int             cur_dev = 0;
     AtaInterface*   devices[2];
 
+    // Whether a 32-bit DATA port access transfers two words. Only enabled
+    // for buses where the word order has been verified, a 32-bit access
+    // moves a single word everywhere else.
+    bool            dword_data;
+
     std::unique_ptr<AtaInterface>   device_stub;
 };
 
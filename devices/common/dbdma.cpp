@@ -31,6 +31,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/common/mmiodevice.h>
 #include <devices/memctrl/memctrlbase.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
 #include <loguru.hpp>
@@ -464,36 +465,101 @@ void DMAChannel::reg_write(uint32_t offset, uint32_t value, int size) {
 }
 
 void DMAChannel::xfer_from_device() {
-    if (this->dev_obj == nullptr)
-        return;
+    this->xfer_batch(DMA_DIR_FROM_DEV);
+}
 
-    this->xfer_dir = DMA_DIR_FROM_DEV;
+void DMAChannel::xfer_to_device() {
+    this->xfer_batch(DMA_DIR_TO_DEV);
+}
 
-    int got_bytes = this->dev_obj->xfer_from(this, this->queue_data, this->queue_len);
-    this->queue_data += got_bytes;
-    this->res_count -= got_bytes;
-    this->queue_len -= got_bytes;
-    if (!this->queue_len) {
-        this->finish_cmd();
-    } else if (got_bytes) {
-        LOG_F(WARNING, "%s: got unexpected amount of data in xfer_from_device",
-              this->get_name().c_str());
+/* Build a scatter-gather list starting with the remainder of the current
+   command followed by the INPUT/OUTPUT commands that come next in memory.
+   Only commands that complete without side effects are merged: the chain
+   ends with the first *_LAST command or with the first command having any
+   of the interrupt, branch or wait bits set. Returns the number of entries.
+ */
+int DMAChannel::gather_cmds(XferDir dir) {
+    uint8_t  more_cmd = (dir == DMA_DIR_TO_DEV) ? DBDMA_Cmd::OUTPUT_MORE
+                                                : DBDMA_Cmd::INPUT_MORE;
+    uint8_t  cmd      = this->cur_cmd;
+    uint8_t  cmd_bits = this->cur_host->cmd_bits;
+    uint32_t next_ptr = this->cmd_ptr + 16;
+    int      count    = 1;
+
+    this->sg_list[0] = {this->queue_data, this->queue_len};
+    this->batch[0]   = {this->cur_host, this->cur_is_writable, this->cur_cmd};
+
+    while (count < DBDMA_MAX_BATCH && cmd == more_cmd && !(cmd_bits & 0x3F)) {
+        MapDmaResult res = mmu_map_dma_mem(next_ptr, 16, false, true);
+        if (res.host_va == nullptr)
+            break;
+
+        DMACmd* cmd_host = (DMACmd*)res.host_va;
+        uint16_t req_count = READ_WORD_LE_A(&cmd_host->req_count);
+
+        // OUTPUT_MORE/OUTPUT_LAST or INPUT_MORE/INPUT_LAST with key 0 only
+        cmd = cmd_host->cmd_key >> 4;
+        if ((cmd & ~1) != more_cmd || (cmd_host->cmd_key & 7) || !req_count)
+            break;
+
+        MapDmaResult data = mmu_map_dma_mem(READ_DWORD_LE_A(&cmd_host->address),
+                                            req_count, false, true);
+        if (data.host_va == nullptr)
+            break;
+
+        this->sg_list[count] = {data.host_va, req_count};
+        this->batch[count]   = {cmd_host, res.is_writable, cmd};
+
+        cmd_bits  = cmd_host->cmd_bits;
+        next_ptr += 16;
+        count++;
     }
 
-    this->interpret_until_blocked();
+    return count;
 }
 
-void DMAChannel::xfer_to_device() {
+void DMAChannel::xfer_batch(XferDir dir) {
     if (this->dev_obj == nullptr)
         return;
 
-    this->xfer_dir = DMA_DIR_TO_DEV;
+    this->xfer_dir = dir;
+
+    int count = this->gather_cmds(dir);
+    int got_bytes;
+
+    if (dir == DMA_DIR_FROM_DEV)
+        got_bytes = this->dev_obj->xfer_from_sg(this, this->sg_list, count);
+    else
+        got_bytes = this->dev_obj->xfer_to_sg(this, this->sg_list, count);
+
+    // retire completed commands and write back their status
+    for (int i = 0; i < count; i++) {
+        if (i) {
+            // commands the device didn't touch will be fetched again regularly
+            if (!got_bytes)
+                break;
+            this->cur_host        = this->batch[i].host;
+            this->cur_is_writable = this->batch[i].is_writable;
+            this->cur_cmd         = this->batch[i].cmd;
+            this->queue_data      = this->sg_list[i].buf;
+            this->res_count       = this->sg_list[i].len;
+            this->queue_len       = this->sg_list[i].len;
+            this->cmd_in_progress = true;
+        }
+
+        uint32_t len = std::min((uint32_t)got_bytes, this->queue_len);
+        this->queue_data += len;
+        this->res_count  -= len;
+        this->queue_len  -= len;
+        got_bytes        -= len;
+
+        if (this->queue_len) {
+            if (dir == DMA_DIR_FROM_DEV && len)
+                LOG_F(WARNING, "%s: got unexpected amount of data in xfer_from_device",
+                      this->get_name().c_str());
+            break;
+        }
 
-    int got_bytes = this->dev_obj->xfer_to(this, this->queue_data, this->queue_len);
-    this->queue_data += got_bytes;
-    this->res_count -= got_bytes;
-    this->queue_len -= got_bytes;
-    if (!this->queue_len) {
         this->finish_cmd();
     }
 
@@ -103,6 +103,9 @@ namespace DBDMA_Cmd {
 
 typedef std::function<void(void)> DbdmaCallback;
 
+// max number of INPUT/OUTPUT commands passed to a device in one transfer
+constexpr int DBDMA_MAX_BATCH = 32;
+
 class DMAChannel : public DmaBidirChannel, public DmaChannel {
 public:
     DMAChannel(std::string name) : DmaBidirChannel(name) {}
@@ -144,6 +147,8 @@ protected:
     void update_irq(uint8_t cmd_bits);
     void xfer_from_device();
     void xfer_to_device();
+    void xfer_batch(XferDir dir);
+    int  gather_cmds(XferDir dir);
 
     void start(void);
     void resume(void);
@@ -174,6 +179,14 @@ private:
     DMACmd * cur_host = nullptr;   // host virtual address of current command
     bool     cur_is_writable = false;  // current command is writable
 
+    // descriptor chain batching
+    DmaSgEntry  sg_list[DBDMA_MAX_BATCH];
+    struct {
+        DMACmd*     host;
+        bool        is_writable;
+        uint8_t     cmd;
+    } batch[DBDMA_MAX_BATCH];
+
     // Interrupt related stuff
     InterruptCtrl* int_ctrl = nullptr;
     uint64_t       irq_id   = 0;
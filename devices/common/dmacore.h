@@ -101,6 +101,12 @@ enum XferDir : unsigned {
     DMA_DIR_FROM_DEV,
 };
 
+/** Scatter-gather list entry. */
+typedef struct DmaSgEntry {
+    uint8_t*    buf;
+    uint32_t    len;
+} DmaSgEntry;
+
 class DmaChannel;
 
 class DmaDevice {
@@ -112,6 +118,30 @@ public:
     virtual void notify(DmaChannel *ch_obj, DmaMsg msg) {}
     virtual int  xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) { return len; }
     virtual int  xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) { return len; }
+
+    // Scatter-gather transfers. They return the total number of bytes moved.
+    // The default implementations call xfer_from/xfer_to for each entry
+    // until one of them comes up short.
+    virtual int  xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+        int total = 0;
+        for (int i = 0; i < count; i++) {
+            int got = this->xfer_from(ch_obj, sg[i].buf, sg[i].len);
+            total += got;
+            if (got < (int)sg[i].len)
+                break;
+        }
+        return total;
+    }
+    virtual int  xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+        int total = 0;
+        for (int i = 0; i < count; i++) {
+            int got = this->xfer_to(ch_obj, sg[i].buf, sg[i].len);
+            total += got;
+            if (got < (int)sg[i].len)
+                break;
+        }
+        return total;
+    }
     virtual int  tell_xfer_size(DmaChannel *ch_obj) { return 0; }
 
 protected:
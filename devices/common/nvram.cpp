@@ -19,6 +19,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <core/timermanager.h>
 #include <cpu/ppc/ppcemu.h>
 #include <devices/common/hwcomponent.h>
 #include <devices/common/nvram.h>
@@ -26,10 +27,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/deviceregistry.h>
 
 #include <cinttypes>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <loguru.hpp>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 /** @file Non-volatile RAM implementation.
  */
 
@@ -38,6 +46,9 @@ using namespace std;
 /** the signature for NVRAM backing file identification. */
 static char NVRAM_FILE_ID[] = "DINGUSPPCNVRAM";
 
+/** delay between the first modification and the write-back in ns. */
+constexpr auto NVRAM_FLUSH_DELAY = NS_PER_SEC;
+
 NVram::NVram(std::string file_name, uint32_t ram_size)
 {
     this->name = "NVRAM";
@@ -57,7 +68,11 @@ NVram::NVram(std::string file_name, uint32_t ram_size)
 }
 
 NVram::~NVram() {
-    this->save();
+    if (this->flush_timer_id) {
+        TimerManager::get_instance()->cancel_timer(this->flush_timer_id);
+        this->flush_timer_id = 0;
+    }
+    this->flush();
 }
 
 uint8_t NVram::read_byte(uint32_t offset) {
@@ -65,7 +80,30 @@ uint8_t NVram::read_byte(uint32_t offset) {
 }
 
 void NVram::write_byte(uint32_t offset, uint8_t val) {
-    this->storage[offset] = val;
+    if (this->storage[offset] != val) {
+        this->storage[offset] = val;
+        this->mark_dirty();
+    }
+}
+
+void NVram::mark_dirty() {
+    this->dirty = true;
+
+    // coalesce all writes made until the timer fires into a single flush
+    if (!this->flush_timer_id && !is_deterministic) {
+        this->flush_timer_id = TimerManager::get_instance()->add_oneshot_timer(
+            NVRAM_FLUSH_DELAY,
+            [this]() {
+                this->flush_timer_id = 0;
+                this->flush();
+            }
+        );
+    }
+}
+
+void NVram::flush() {
+    if (this->dirty)
+        this->save();
 }
 
 void NVram::init() {
@@ -80,6 +118,7 @@ void NVram::init() {
         !f.read((char*)this->storage.get(), this->ram_size)) {
         LOG_F(WARNING, "Could not restore NVRAM content from the given file \"%s\".", this->file_name.c_str());
         memset(this->storage.get(), 0, this->ram_size);
+        this->dirty = true; // create the backing file on the next flush
     }
 
     f.close();
@@ -90,16 +129,50 @@ void NVram::save() {
         LOG_F(INFO, "Skipping NVRAM write to \"%s\" in deterministic mode", this->file_name.c_str());
         return;
     }
-    ofstream f(this->file_name, ios::out | ios::binary);
+
+    // write a temporary file and move it over the backing file so that
+    // an interrupted write never leaves a truncated NVRAM image behind
+    std::string tmp_name = this->file_name + ".tmp";
+
+    FILE* f = std::fopen(tmp_name.c_str(), "wb");
+    bool  ok = f != nullptr;
 
     /* write file identification */
-    f.write(NVRAM_FILE_ID, sizeof(NVRAM_FILE_ID));
-    f.write((char*)&this->ram_size, sizeof(this->ram_size));
+    ok = ok && std::fwrite(NVRAM_FILE_ID, sizeof(NVRAM_FILE_ID), 1, f) == 1;
+    ok = ok && std::fwrite(&this->ram_size, sizeof(this->ram_size), 1, f) == 1;
 
     /* write NVRAM content */
-    f.write((char*)this->storage.get(), this->ram_size);
+    ok = ok && std::fwrite(this->storage.get(), this->ram_size, 1, f) == 1;
+
+    // the data must be on disk before the rename makes it the backing file
+    ok = ok && !std::fflush(f);
+#ifdef _WIN32
+    ok = ok && !_commit(_fileno(f));
+#else
+    ok = ok && !fsync(fileno(f));
+#endif
+
+    if (f && std::fclose(f))
+        ok = false;
+
+    if (!ok) {
+        LOG_F(ERROR, "Could not write NVRAM content to \"%s\"", tmp_name.c_str());
+        std::remove(tmp_name.c_str());
+        return;
+    }
 
-    f.close();
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows
+    std::remove(this->file_name.c_str());
+#endif
+
+    if (std::rename(tmp_name.c_str(), this->file_name.c_str())) {
+        LOG_F(ERROR, "Could not replace NVRAM file \"%s\"", this->file_name.c_str());
+        std::remove(tmp_name.c_str());
+        return;
+    }
+
+    this->dirty = false;
 }
 
 static const DeviceDescription Nvram_Descriptor = {
@@ -32,6 +32,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
     It implements a non-volatile random access storage whose content will be
     automatically saved to and restored from the dedicated file.
+
+    Modifications are written back after a short delay so that bursts
+    of guest updates result in a single write of the backing file.
  */
 
 class NVram : public HWComponent {
@@ -47,14 +50,20 @@ public:
     void write_byte(uint32_t offset, uint8_t value);
     uint32_t get_of_nvram_offset() { return of_nvram_offset; }
 
+    // write modified content to the backing file immediately
+    void flush();
+
 private:
     std::string file_name; // file name for the backing file
     uint16_t    ram_size;  // NVRAM size
     std::unique_ptr<uint8_t[]>  storage;
     uint32_t of_nvram_offset = 0;
+    bool        dirty = false;
+    uint32_t    flush_timer_id = 0;
 
     void init();
     void save();
+    void mark_dirty();
 };
 
 #endif /* NVRAM_H */
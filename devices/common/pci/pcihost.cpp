@@ -30,6 +30,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <cinttypes>
 #include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcmmu.h>
 
 bool PCIHost::pci_register_device(int dev_fun_num, PCIBase* dev_instance)
 {
@@ -105,6 +106,36 @@ bool PCIHost::pci_unregister_mmio_region(uint32_t start_addr, uint32_t size, PCI
     return mem_ctrl->remove_mmio_region(start_addr, size, obj);
 }
 
+AddressMapEntry* PCIHost::pci_register_ram_region(uint32_t start_addr, uint32_t size, uint8_t* mem_ptr)
+{
+    MemCtrlBase *mem_ctrl = dynamic_cast<MemCtrlBase *>
+                           (gMachineObj->get_comp_by_type(HWCompType::MEM_CTRL));
+
+    // The MMU maps host memory a page at a time, so a partial page would
+    // expose whatever follows mem_ptr. Overlaps are rejected by add_ram_region.
+    if (!mem_ptr || !size || (start_addr | size) & ~PPC_PAGE_MASK ||
+        start_addr + size - 1 < start_addr) {
+        HWComponent *hwc = dynamic_cast<HWComponent*>(this);
+        LOG_F(ERROR, "%s: invalid RAM region 0x%08X, size 0x%X",
+              hwc ? hwc->get_name().c_str() : "PCIHost", start_addr, size);
+        return nullptr;
+    }
+
+    return mem_ctrl->add_ram_region(start_addr, size, mem_ptr);
+}
+
+bool PCIHost::pci_unregister_ram_region(AddressMapEntry* entry)
+{
+    if (!entry)
+        return false;
+
+    MemCtrlBase *mem_ctrl = dynamic_cast<MemCtrlBase *>
+                           (gMachineObj->get_comp_by_type(HWCompType::MEM_CTRL));
+    AddressMapEntry *removed = mem_ctrl->remove_region(entry);
+    delete removed;
+    return removed != nullptr;
+}
+
 void PCIHost::attach_pci_device(const std::string& dev_name, int slot_id)
 {
     this->attach_pci_device(dev_name, slot_id, "");
@@ -73,6 +73,8 @@ public:
 
     virtual AddressMapEntry* pci_register_mmio_region(uint32_t start_addr, uint32_t size, PCIBase* obj);
     virtual bool           pci_unregister_mmio_region(uint32_t start_addr, uint32_t size, PCIBase* obj);
+    virtual AddressMapEntry* pci_register_ram_region(uint32_t start_addr, uint32_t size, uint8_t* mem_ptr);
+    virtual bool           pci_unregister_ram_region(AddressMapEntry* entry);
 
     virtual void attach_pci_device(const std::string& dev_name, int slot_id);
     PCIBase *attach_pci_device(const std::string& dev_name, int slot_id,
@@ -71,6 +71,7 @@ void Sc53C94::reset_device()
     // clear data FIFO
     this->data_fifo_pos = 0;
     this->data_fifo[0]  = 0;
+    this->pdma_clear();
 
     this->sync_period = 5;
     this->sync_offset = 0;
@@ -123,7 +124,8 @@ uint8_t Sc53C94::read(uint8_t reg_offset)
         value = this->seq_step;
         break;
     case Read::Reg53C94::FIFO_Flags:
-        value = (this->cur_step << 5) | (this->data_fifo_pos & 0x1F);
+        value = (this->cur_step << 5) | (std::min(DATA_FIFO_MAX,
+                this->data_fifo_pos + this->pdma_len - this->pdma_pos) & 0x1F);
         break;
     case Read::Reg53C94::Config_1:
         value = this->config1;
@@ -200,16 +202,15 @@ void Sc53C94::write(uint8_t reg_offset, uint8_t value)
     }
 }
 
-uint16_t Sc53C94::pseudo_dma_read()
+uint16_t Sc53C94::pseudo_dma_read_slow()
 {
     uint16_t data_word;
     bool     is_done = false;
 
-    if (this->data_fifo_pos >= 2) {
+    if (this->data_fifo_pos + this->pdma_len - this->pdma_pos >= 2) {
         // remove one word from FIFO
-        data_word = (this->data_fifo[0] << 8) | this->data_fifo[1];
-        this->data_fifo_pos -= 2;
-        std::memmove(this->data_fifo, &this->data_fifo[2], this->data_fifo_pos);
+        data_word  = this->fifo_pop() << 8;
+        data_word |= this->fifo_pop();
 
         // update DMA status
         if (this->is_dma_cmd) {
@@ -228,7 +229,7 @@ uint16_t Sc53C94::pseudo_dma_read()
     }
 
     // see if we need to refill FIFO
-    if (!this->data_fifo_pos && !is_done) {
+    if (!this->data_fifo_pos && this->pdma_pos >= this->pdma_len && !is_done) {
         this->sequencer();
     }
 
@@ -308,6 +309,7 @@ void Sc53C94::exec_command()
     case CMD_CLEAR_FIFO:
         this->data_fifo_pos = 0; // set the bottom of the data FIFO to zero
         this->data_fifo[0] = 0;
+        this->pdma_clear();
         exec_next_command();
         break;
     case CMD_RESET_DEVICE:
@@ -401,17 +403,20 @@ void Sc53C94::exec_command()
         LOG_F(9, "%s: SELECT W/O ATN command started", this->name.c_str());
         break;
     case CMD_SELECT_WITH_ATN:
+    case CMD_SELECT_WITH_ATN3:
         static SeqDesc * sel_with_atn_desc = new SeqDesc[3]{
             {0, ScsiPhase::MESSAGE_OUT, SeqState::SEND_MSG,     INTSTAT_SR | INTSTAT_SO},
             {2, ScsiPhase::COMMAND,     SeqState::SEND_CMD,     INTSTAT_SR | INTSTAT_SO},
             {4, -1,                     SeqState::CMD_COMPLETE, INTSTAT_SR | INTSTAT_SO},
         };
         this->seq_step = this->cur_step = 0;
-        this->bytes_out = 1; // set message length
+        // ATN3 sends IDENTIFY followed by a two-byte queue tag message
+        this->bytes_out = (cmd == CMD_SELECT_WITH_ATN3) ? 3 : 1;
         this->cmd_steps = sel_with_atn_desc;
         this->cur_state = SeqState::BUS_FREE;
         this->sequencer();
-        LOG_F(9, "%s: SELECT WITH ATN command started", this->name.c_str());
+        LOG_F(9, "%s: SELECT WITH ATN%s command started", this->name.c_str(),
+              (cmd == CMD_SELECT_WITH_ATN3) ? "3" : "");
         break;
     case CMD_SELECT_WITH_ATN_AND_STOP:
         static SeqDesc * sel_with_atn_stop_desc = new SeqDesc[3]{
@@ -461,7 +466,11 @@ uint8_t Sc53C94::fifo_pop()
 {
     uint8_t data = 0;
 
-    if (this->data_fifo_pos < 1) {
+    if (this->data_fifo_pos < 1 && this->pdma_pos < this->pdma_len) {
+        data = this->pdma_buf[this->pdma_pos++];
+        if (this->pdma_pos >= this->pdma_len)
+            this->pdma_clear();
+    } else if (this->data_fifo_pos < 1) {
         LOG_F(ERROR, "%s: data FIFO underflow!", this->name.c_str());
         this->status |= STAT_GE; // signal IOE/Gross Error
     } else {
@@ -563,7 +572,14 @@ void Sc53C94::sequencer()
             if (this->drq_cb)
                 this->drq_cb(1);
         } else {
-            this->bus_obj->target_xfer_data();
+            // send IDENTIFY followed by the queue tag message for SELECT WITH ATN3
+            int fifo_start = this->data_fifo_pos;
+            int fifo_prev;
+            do {
+                fifo_prev = this->data_fifo_pos;
+                this->bus_obj->target_xfer_data();
+            } while (this->data_fifo_pos && this->data_fifo_pos != fifo_prev &&
+                     fifo_start - this->data_fifo_pos < this->bytes_out);
             if (this->cur_state == SeqState::SEND_MSG_EX) {
                 this->notify(ScsiNotification::BUS_PHASE_CHANGE, ScsiPhase::MESSAGE_OUT);
             } else {
@@ -780,6 +796,17 @@ bool Sc53C94::rcv_data()
     }
 
     if (this->is_dma_cmd && this->cur_bus_phase == ScsiPhase::DATA_IN) {
+        // stage as much of the data phase as possible for pseudo-DMA
+        if (!this->data_fifo_pos) {
+            if (this->pdma_pos < this->pdma_len)
+                return true;
+            req_count = std::min((int)this->xfer_count, PDMA_BUF_SIZE);
+            if (this->bus_obj->pull_data(this->target_id, this->pdma_buf.get(), req_count)) {
+                this->pdma_pos = 0;
+                this->pdma_len = req_count;
+            }
+            return true;
+        }
         req_count = std::min((int)this->xfer_count, DATA_FIFO_MAX - this->data_fifo_pos);
     } else {
         req_count = 1;
@@ -791,87 +818,130 @@ bool Sc53C94::rcv_data()
 }
 
 int Sc53C94::xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) {
-    int bytes_moved = 0;
+    DmaSgEntry sg = {buf, uint32_t(len)};
+    return this->xfer_from_sg(ch_obj, &sg, 1);
+}
 
-    if (this->cur_cmd != CMD_XFER || !this->is_dma_cmd ||
-        this->cur_bus_phase != ScsiPhase::DATA_IN) {
-        LOG_F(9, "%s: ignoring DMA data transfer request", this->name.c_str());
-        return 0;
-    }
+int Sc53C94::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
+    DmaSgEntry sg = {buf, uint32_t(len)};
+    return this->xfer_to_sg(ch_obj, &sg, 1);
+}
 
-    len = std::min(len, (int)(this->xfer_count));
+/* Fill a host buffer with DATA_IN bytes. Bytes already in the FIFO go
+   first, followed by data staged for pseudo-DMA and then by data pulled
+   from the target. Returns the number of bytes moved. */
+int Sc53C94::dma_pull(uint8_t *buf, int len) {
+    int bytes_moved = 0;
 
     // see if there are data bytes in the FIFO we want to grab first
     if (this->data_fifo_pos) {
         int fifo_bytes = std::min(this->data_fifo_pos, len);
         std::memcpy(buf, this->data_fifo, fifo_bytes);
         this->data_fifo_pos -= fifo_bytes;
+        std::memmove(this->data_fifo, &this->data_fifo[fifo_bytes], this->data_fifo_pos);
+        this->xfer_count -= fifo_bytes;
+        len -= fifo_bytes;
+        bytes_moved += fifo_bytes;
+        buf += fifo_bytes;
+    }
+
+    // then drain data staged for pseudo-DMA
+    if (len && this->pdma_pos < this->pdma_len) {
+        int fifo_bytes = std::min(this->pdma_len - this->pdma_pos, len);
+        std::memcpy(buf, &this->pdma_buf[this->pdma_pos], fifo_bytes);
+        this->pdma_pos += fifo_bytes;
+        if (this->pdma_pos >= this->pdma_len)
+            this->pdma_clear();
         this->xfer_count -= fifo_bytes;
         len -= fifo_bytes;
         bytes_moved += fifo_bytes;
         buf += fifo_bytes;
-        if (!this->xfer_count) {
-            this->status |= STAT_TC; // signal zero transfer count
-            this->cur_state = SeqState::XFER_END;
-            this->sequencer();
-            return bytes_moved;
-        }
     }
 
-    if (this->bus_obj->pull_data(this->target_id, buf, len)) {
+    if (len && this->bus_obj->pull_data(this->target_id, buf, len)) {
         bytes_moved += len;
         this->xfer_count -= len;
-        if (!this->xfer_count) {
-            this->status |= STAT_TC; // signal zero transfer count
-            this->cur_state = SeqState::XFER_END;
-            this->sequencer();
-        }
     }
 
     return bytes_moved;
 }
 
-int Sc53C94::xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) {
+/* Advance the sequencer once the transfer count reaches zero.
+   end_xfer selects whether the data phase ends right away. */
+void Sc53C94::dma_xfer_done(bool end_xfer) {
+    if (this->xfer_count)
+        return;
+
+    this->status |= STAT_TC; // signal zero transfer count
+    if (end_xfer)
+        this->cur_state = SeqState::XFER_END;
+    this->sequencer();
+}
+
+/* Serve a whole DMA descriptor chain. The sequencer is advanced once,
+   after all buffers have been processed. */
+int Sc53C94::xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
     int bytes_moved = 0;
 
-    if (!this->xfer_count || !this->is_dma_xfer) {
+    if (this->cur_cmd != CMD_XFER || !this->is_dma_cmd ||
+        this->cur_bus_phase != ScsiPhase::DATA_IN) {
         LOG_F(9, "%s: ignoring DMA data transfer request", this->name.c_str());
         return 0;
     }
 
-    len = std::min(len, (int)(this->xfer_count));
+    for (int i = 0; i < count && this->xfer_count; i++) {
+        int len = std::min(int(sg[i].len), int(this->xfer_count));
+        int got = this->dma_pull(sg[i].buf, len);
+        bytes_moved += got;
+        if (got < len)
+            break;
+    }
+
+    this->dma_xfer_done(true);
 
-    // Being in the DATA_OUT phase means that we're about to move
-    // a big chunk of data. The real device uses its FIFO as buffer.
-    // For simplicity, the code below transfers the whole chunk at once.
-    // This can be broken into smaller chunks later if desired.
-    if (this->cur_bus_phase == ScsiPhase::DATA_OUT) {
-        if (this->bus_obj->push_data(this->target_id, buf, len)) {
-            this->xfer_count -= len;
-            bytes_moved += len;
-            if (!this->xfer_count) {
-                this->status |= STAT_TC; // signal zero transfer count
-                this->cur_state = SeqState::XFER_END;
-                this->sequencer();
+    return bytes_moved;
+}
+
+int Sc53C94::xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+    int  bytes_moved = 0;
+    bool pushed      = false;
+
+    if (!this->xfer_count || !this->is_dma_xfer) {
+        LOG_F(9, "%s: ignoring DMA data transfer request", this->name.c_str());
+        return 0;
+    }
+
+    for (int i = 0; i < count && this->xfer_count; i++) {
+        uint8_t* buf = sg[i].buf;
+        int      len = std::min(int(sg[i].len), int(this->xfer_count));
+
+        // Being in the DATA_OUT phase means that we're about to move
+        // a big chunk of data. The real device uses its FIFO as buffer.
+        // For simplicity, the code below transfers the whole chunk at once.
+        // This can be broken into smaller chunks later if desired.
+        if (this->cur_bus_phase == ScsiPhase::DATA_OUT) {
+            if (this->bus_obj->push_data(this->target_id, buf, len)) {
+                this->xfer_count -= len;
+                bytes_moved += len;
+                pushed = true;
+                continue;
             }
-            len = 0;
-        } else
             LOG_F(WARNING, "%s: xfer_to failed to transfer data", this->name.c_str());
-    }
+        }
 
-    if (this->xfer_count) {
-        // fill in the data FIFO first
-        uint32_t fifo_bytes = std::min(len, DATA_FIFO_MAX - this->data_fifo_pos);
+        // fill in the data FIFO
+        int fifo_bytes = std::min(len, DATA_FIFO_MAX - this->data_fifo_pos);
         std::memcpy(&this->data_fifo[this->data_fifo_pos], buf, fifo_bytes);
         this->data_fifo_pos += fifo_bytes;
         this->xfer_count -= fifo_bytes;
         bytes_moved += fifo_bytes;
-        if (!this->xfer_count) {
-            this->status |= STAT_TC; // signal zero transfer count
-            this->sequencer();
-        }
+        pushed = false;
+        if (fifo_bytes < len)
+            break;
     }
 
+    this->dma_xfer_done(pushed);
+
     return bytes_moved;
 }
 
@@ -29,6 +29,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef SC_53C94_H
 #define SC_53C94_H
 
+#include <core/memaccess.h>
 #include <devices/common/scsi/scsi.h>
 #include <devices/common/dbdma.h>
 
@@ -120,7 +121,7 @@ enum {
     CMD_SELECT_WITH_ATN_AND_STOP        = 0x43,
     CMD_ENA_SEL_RESEL                   = 0x44, // no interrupt
   //CMD_DISABLE_SEL_RESEL               = 0x45,
-  //CMD_SELECT_WITH_ATN3_STEPS          = 0x46,
+    CMD_SELECT_WITH_ATN3                = 0x46,
   //CMD_RESELECT_WITH_ATN3_STEPS        = 0x47,
 
     // Flags
@@ -185,6 +186,7 @@ namespace SeqState {
 }
 
 constexpr auto DATA_FIFO_MAX = 16;
+constexpr auto PDMA_BUF_SIZE = 65536; // pseudo-DMA staging buffer size
 
 /** Sequence descriptor for multistep commands. */
 typedef struct {
@@ -211,9 +213,21 @@ public:
     // 53C94 registers access
     uint8_t  read(uint8_t reg_offset);
     void     write(uint8_t reg_offset, uint8_t value);
-    uint16_t pseudo_dma_read();
     void     pseudo_dma_write(uint16_t data);
 
+    // Pseudo-DMA data port. DMA data-in phases are staged in a host buffer
+    // behind the FIFO so that reads within it bypass the FIFO and the sequencer.
+    uint16_t pseudo_dma_read() {
+        if (this->pdma_len - this->pdma_pos > 2 && this->xfer_count > 2 &&
+            !this->data_fifo_pos) {
+            uint16_t data_word = READ_WORD_BE_U(&this->pdma_buf[this->pdma_pos]);
+            this->pdma_pos   += 2;
+            this->xfer_count -= 2;
+            return data_word;
+        }
+        return this->pseudo_dma_read_slow();
+    }
+
     void set_drq_callback(DrqCb cb) {
         this->drq_cb = cb;
     }
@@ -227,6 +241,8 @@ public:
     // DmaDevice methods
     int xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) override;
     int xfer_to(DmaChannel *ch_obj, uint8_t *buf, int len) override;
+    int xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override;
+    int xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override;
     int tell_xfer_size(DmaChannel *ch_obj) override {
         return this->xfer_count;
     }
@@ -239,6 +255,13 @@ protected:
     void exec_next_command();
     void fifo_push(const uint8_t data);
     uint8_t fifo_pop();
+    void pdma_clear() {
+        this->pdma_pos = 0;
+        this->pdma_len = 0;
+    }
+    uint16_t pseudo_dma_read_slow();
+    int  dma_pull(uint8_t *buf, int len);
+    void dma_xfer_done(bool end_xfer);
 
     void sequencer();
     void seq_defer_state(uint64_t delay_ns);
@@ -296,6 +319,11 @@ private:
 
     // DMA related stuff
     DrqCb               drq_cb = nullptr;
+
+    // data-in bytes staged for pseudo-DMA, consumed after the FIFO
+    std::unique_ptr<uint8_t[]>  pdma_buf = std::make_unique<uint8_t[]>(PDMA_BUF_SIZE);
+    int                         pdma_pos = 0;
+    int                         pdma_len = 0;
 };
 
 #endif // SC_53C94_H
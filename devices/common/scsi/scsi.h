@@ -307,6 +307,14 @@ public:
         this->post_xfer_action = cb;
     }
 
+    bool supports_direct_read() override {
+        return true;
+    }
+
+    void set_direct_read_cb(direct_read_cb_t cb) override {
+        this->direct_read = cb;
+    }
+
     void set_status(uint8_t status_code, uint8_t sense_key) override {
         this->status = status_code;
     }
@@ -359,6 +367,8 @@ protected:
 
     more_data_cb_t  read_more_data  = {};
     more_data_cb_t  write_more_data = {};
+
+    direct_read_cb_t direct_read    = {};
 };
 
 /** This class provides a higher level abstraction for the SCSI bus. */
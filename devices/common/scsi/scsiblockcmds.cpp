@@ -33,6 +33,7 @@ ScsiBlockCmds::ScsiBlockCmds() {
     this->enable_cmd(ScsiCommand::START_STOP_UNIT);
     this->enable_cmd(ScsiCommand::PREVENT_ALLOW_MEDIUM_REMOVAL);
     this->enable_cmd(ScsiCommand::READ_CAPACITY);
+    this->enable_cmd(ScsiCommand::SYNC_CACHE);
 
     this->add_page_getter(this, ModePage::ERROR_RECOVERY,
                           &ScsiBlockCmds::get_error_recovery_page);
@@ -44,6 +45,12 @@ void ScsiBlockCmds::init_block_device(uint8_t medium_type, uint8_t dev_flags,
     this->medium_type  = medium_type;
     this->device_flags = dev_flags;
 
+    phy_impl->set_direct_read_cb(
+        [this](uint8_t* dst_ptr, int count) -> int {
+            return this->blk_dev->read_direct(dst_ptr, count);
+        }
+    );
+
     phy_impl->set_read_more_data_cb(
         [this](int* dsize, uint8_t** dptr) -> bool {
             if (this->blk_dev->get_remaining_size()) {
@@ -105,6 +112,11 @@ void ScsiBlockCmds::process_command() {
     case ScsiCommand::READ_CAPACITY:
         next_phase = this->read_capacity();
         break;
+    case ScsiCommand::SYNC_CACHE:
+        if (this->blk_dev->medium_writable())
+            this->blk_dev->flush();
+        next_phase = ScsiPhase::STATUS;
+        break;
     default:
         ScsiCommonCmds::process_command();
         return;
@@ -137,6 +149,14 @@ int ScsiBlockCmds::read() {
     }
 
     this->blk_dev->set_fpos(this->get_lba());
+
+    // read straight into the initiator's buffer whenever possible
+    if (phy_impl->supports_direct_read() && this->blk_dev->can_read_direct()) {
+        phy_impl->set_xfer_len(this->blk_dev->read_begin_direct(nblocks));
+        phy_impl->set_buffer(nullptr);
+        return ScsiPhase::DATA_IN;
+    }
+
     phy_impl->set_xfer_len(this->blk_dev->read_begin(nblocks));
     phy_impl->set_buffer(this->blk_dev->get_cache_ptr());
 
@@ -233,30 +233,57 @@ int ScsiBusController::send_data(uint8_t* dst_ptr, int count) {
 }
 
 int ScsiBusController::xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) {
-    if (len > this->to_xfer + this->fifo_pos)
+    DmaSgEntry sg = {buf, uint32_t(len)};
+    return this->xfer_from_sg(ch_obj, &sg, 1);
+}
+
+/* Move DATA_IN bytes into a chain of host buffers, draining the FIFO first.
+   The sequencer is advanced once, after the whole chain has been served.
+   Returns the number of bytes moved. */
+int ScsiBusController::xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) {
+    int bytes_moved = 0;
+    int total_len   = 0;
+
+    for (int i = 0; i < count; i++)
+        total_len += sg[i].len;
+
+    if (total_len > this->to_xfer + this->fifo_pos)
         LOG_F(WARNING, "%s: DMA xfer len > command xfer len", this->name.c_str());
 
-    if (this->fifo_pos) {
-        int fifo_bytes = std::min(this->fifo_pos, len);
-        std::memcpy(buf, this->data_fifo, fifo_bytes);
-        this->fifo_pos -= fifo_bytes;
-        len -= fifo_bytes;
-        buf += fifo_bytes;
-    }
+    for (int i = 0; i < count; i++) {
+        uint8_t* buf = sg[i].buf;
+        int      len = sg[i].len;
 
-    int dma_bytes = std::min(this->to_xfer, len);
+        if (this->fifo_pos) {
+            int fifo_bytes = std::min(this->fifo_pos, len);
+            std::memcpy(buf, this->data_fifo, fifo_bytes);
+            this->fifo_pos -= fifo_bytes;
+            if (this->fifo_pos)
+                std::memmove(this->data_fifo, &this->data_fifo[fifo_bytes], this->fifo_pos);
+            len -= fifo_bytes;
+            buf += fifo_bytes;
+            bytes_moved += fifo_bytes;
+        }
+
+        int dma_bytes = std::max(std::min(this->to_xfer, len), 0);
+
+        if (!this->bus_obj->pull_data(this->dst_id, buf, dma_bytes))
+            break;
 
-    if (this->bus_obj->pull_data(this->dst_id, buf, dma_bytes)) {
         this->to_xfer -= dma_bytes;
-        if (this->to_xfer <= 0) {
-            this->xfer_count = this->to_xfer;
-            this->cur_state = SeqState::XFER_END;
-            this->sequencer();
-        }
-        return 0;
+        bytes_moved   += dma_bytes;
+
+        if (this->to_xfer <= 0)
+            break;
+    }
+
+    if (this->to_xfer <= 0) {
+        this->xfer_count = this->to_xfer;
+        this->cur_state = SeqState::XFER_END;
+        this->sequencer();
     }
 
-    return len;
+    return bytes_moved;
 }
 
 void ScsiBusController::update_irq() {
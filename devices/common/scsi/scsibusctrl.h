@@ -82,6 +82,7 @@ public:
 
     // DmaDevice methods
     int xfer_from(DmaChannel *ch_obj, uint8_t *buf, int len) override;
+    int xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override;
 
 protected:
     void seq_defer_state(uint64_t delay_ns);
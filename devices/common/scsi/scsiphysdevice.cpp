@@ -183,7 +183,9 @@ int ScsiPhysDevice::xfer_data() {
             } else {
                 this->process_message();
             }
-            if (this->last_selection_has_attention)
+            // only IDENTIFY carries the LUN, queue tag messages follow it
+            if (this->last_selection_has_attention &&
+                (this->msg_buf[0] & ScsiMessage::IDENTIFY))
                 this->last_selection_message = this->msg_buf[0];
         }
         break;
@@ -216,7 +218,19 @@ int ScsiPhysDevice::send_data(uint8_t* dst_ptr, const int count)
     while (remainder) {
         if (this->data_size) {
             int chunk_size = std::min(this->data_size, remainder);
-            if (chunk_size) {
+            if (this->data_ptr == nullptr) {
+                // no intermediate buffer: let the medium fill dst_ptr directly
+                if (!this->direct_read)
+                    break;
+                int got = this->direct_read(dst_ptr, chunk_size);
+                // a short read at the end of the image returns zeroes so that
+                // the initiator still gets all the data it's waiting for
+                if (got < chunk_size)
+                    std::memset(dst_ptr + got, 0, chunk_size - got);
+                dst_ptr         += chunk_size;
+                this->data_size -= chunk_size;
+                remainder       -= chunk_size;
+            } else if (chunk_size) {
                 std::memcpy(dst_ptr, this->data_ptr, chunk_size);
                 dst_ptr         += chunk_size;
                 this->data_ptr  += chunk_size;
@@ -275,8 +289,8 @@ int ScsiPhysDevice::rcv_data(const uint8_t* src_ptr, const int count)
 }
 
 void ScsiPhysDevice::process_message() {
-    static int sdtr_response_seq[4] = {ScsiPhase::MESSAGE_OUT, ScsiPhase::MESSAGE_IN,
-                                       ScsiPhase::COMMAND, -1};
+    static int msg_response_seq[4] = {ScsiPhase::MESSAGE_OUT, ScsiPhase::MESSAGE_IN,
+                                      ScsiPhase::COMMAND, -1};
 
     if (this->msg_buf[0] == 1) { // extended messages
         if (!this->bus_obj->pull_data(this->initiator_id, &this->msg_buf[1], 1) ||
@@ -287,7 +301,7 @@ void ScsiPhysDevice::process_message() {
         case ScsiExtMessage::SYNCH_XFER_REQ:
             LOG_F(INFO, "%s: SDTR message received", this->name.c_str());
             // confirm synchronous transfer capability by sending back the SDTR message
-            this->seq_steps = sdtr_response_seq;
+            this->seq_steps = msg_response_seq;
             this->data_ptr = this->msg_buf;
             this->data_size = 5;
             break;
@@ -297,5 +311,21 @@ void ScsiPhysDevice::process_message() {
     } else if ((this->msg_buf[0] >> 4) == 2) { // two-byte messages
         if (!this->bus_obj->pull_data(this->initiator_id, &this->msg_buf[1], 1))
             ABORT_F("%s: incomplete message received", this->name.c_str());
+
+        switch(this->msg_buf[0]) {
+        case ScsiMessage::SIMPLE_QUEUE_TAG:
+        case ScsiMessage::HEAD_OF_QUEUE_TAG:
+        case ScsiMessage::ORDERED_QUEUE_TAG:
+            // tagged queuing isn't supported, the command will run untagged
+            LOG_F(INFO, "%s: rejecting queue tag message 0x%X", this->name.c_str(),
+                  this->msg_buf[0]);
+            this->seq_steps  = msg_response_seq;
+            this->msg_buf[0] = ScsiMessage::MESSAGE_REJECT;
+            this->data_ptr   = this->msg_buf;
+            this->data_size  = 1;
+            break;
+        default:
+            break;
+        }
     }
 }
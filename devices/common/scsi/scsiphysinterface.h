@@ -38,6 +38,9 @@ using more_data_cb_t = std::function<bool(int* data_size, uint8_t** data_ptr)>;
 // Prototype for action callbacks.
 using action_callback = std::function<void()>;
 
+// Prototype for callbacks reading data straight into the initiator's buffer.
+using direct_read_cb_t = std::function<int(uint8_t* dst_ptr, int count)>;
+
 /** Interface for the physical layer of a SCSI/ATAPI device. */
 class ScsiPhysInterface {
 public:
@@ -59,6 +62,11 @@ public:
     virtual void    set_write_more_data_cb(more_data_cb_t cb) = 0;
     virtual void    set_post_xfer_action(action_callback cb)  = 0;
 
+    // Zero-copy DATA_IN support: if the buffer set with set_buffer() is
+    // nullptr, data is obtained from the direct read callback instead.
+    virtual bool    supports_direct_read() { return false; }
+    virtual void    set_direct_read_cb(direct_read_cb_t cb) {}
+
 protected:
     int phy_id = PHY_ID_UNKNOWN;
 };
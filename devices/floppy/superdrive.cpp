@@ -24,6 +24,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/floppy/superdrive.h>
 #include <loguru.hpp>
 
+#include <algorithm>
 #include <cinttypes>
 
 namespace loguru {
@@ -90,6 +91,8 @@ void MacSuperDrive::reset_params()
     this->cur_track     = 0; // current head position
     this->is_ready      = 0; // drive not ready
 
+    this->track_cache.clear();
+
     // come up in the MFM mode by default
     this->switch_drive_mode(RecMethod::MFM);
 }
@@ -240,6 +243,8 @@ int MacSuperDrive::insert_disk(std::string& img_path, int write_flag = 0)
         // swallow all raw disk data at once!
         this->img_conv->get_raw_disk_data(this->disk_data.get());
 
+        this->build_track_cache();
+
         // disk is write-enabled by default
         this->wr_protect = write_flag;
 
@@ -309,6 +314,53 @@ void MacSuperDrive::switch_drive_mode(int mode)
 
         this->drive_mode = RecMethod::MFM;
     }
+
+    // sector layout depends on the drive mode
+    if (this->has_disk)
+        this->build_track_cache();
+}
+
+/* Lay out sector headers, data pointers and revolution time of all tracks
+   once so that disk accesses don't need to recompute them. */
+void MacSuperDrive::build_track_cache()
+{
+    if (!this->disk_data)
+        return;
+
+    // MFM sector numbering is 1-based
+    int first_sect = (this->rec_method == RecMethod::MFM) ? 1 : 0;
+    int data_size  = this->img_conv->get_data_size();
+
+    this->track_cache.assign(this->num_tracks * this->num_sides, TrackCache{});
+
+    for (int trk = 0; trk < this->num_tracks; trk++) {
+        int num_sects = this->sectors_per_track[trk];
+
+        for (int side = 0; side < this->num_sides; side++) {
+            TrackCache& tc = this->track_cache[trk * this->num_sides + side];
+
+            tc.track_delay = uint64_t((60.0f / this->rpm_per_track[trk]) * NS_PER_SEC);
+
+            for (int sect = 0; sect < num_sects; sect++) {
+                int offset = (this->track2lblk[trk] + side * num_sects + sect) * 512;
+
+                tc.headers.push_back({trk, side, sect + first_sect, this->format_byte});
+                tc.sector_data.push_back(offset + 512 <= data_size ?
+                                         this->disk_data.get() + offset : nullptr);
+            }
+        }
+    }
+}
+
+TrackCache& MacSuperDrive::cur_track_cache()
+{
+    if (this->track_cache.empty()) {
+        this->empty_track.track_delay = uint64_t(this->get_current_track_delay() * NS_PER_SEC);
+        return this->empty_track;
+    }
+
+    int side = std::min(this->cur_head, this->num_sides - 1);
+    return this->track_cache[this->cur_track * this->num_sides + side];
 }
 
 double MacSuperDrive::get_current_track_delay()
@@ -332,7 +384,7 @@ uint64_t MacSuperDrive::sync_to_disk()
 {
     uint64_t cur_time_ns, track_time_ns;
 
-    uint64_t track_delay = uint64_t(this->get_current_track_delay() * NS_PER_SEC);
+    uint64_t track_delay = this->cur_track_cache().track_delay;
 
     // look how much ns have been elapsed since the last motor enabling
     cur_time_ns = TimerManager::get_instance()->current_time_ns() - this->motor_on_time;
@@ -425,24 +477,42 @@ SectorHdr MacSuperDrive::current_sector_header()
 {
     this->cur_sector = this->next_sector;
 
-    // MFM sector numbering is 1-based so we need to bump sector number
-    uint8_t sector_num = this->cur_sector + ((this->rec_method == RecMethod::MFM) ? 1 : 0);
+    TrackCache& tc = this->cur_track_cache();
 
-    return SectorHdr {
-        this->cur_track,
-        this->cur_head,
-        sector_num,
-        this->format_byte
-    };
+    if (this->cur_sector >= (int)tc.headers.size()) {
+        // MFM sector numbering is 1-based so we need to bump sector number
+        return SectorHdr {
+            this->cur_track,
+            this->cur_head,
+            this->cur_sector + ((this->rec_method == RecMethod::MFM) ? 1 : 0),
+            this->format_byte
+        };
+    }
+
+    SectorHdr hdr = tc.headers[this->cur_sector];
+
+    // report the selected head even on single-sided disks
+    hdr.side = this->cur_head;
+
+    return hdr;
 }
 
 char* MacSuperDrive::get_sector_data_ptr(int sector_num)
 {
     LOG_F(READWRITE, "%s: get_sector_data_ptr track:%d head:%d sector:%d",
         this->get_name().c_str(), this->cur_track, this->cur_head, sector_num);
-    return this->disk_data.get() +
-        ((this->track2lblk[this->cur_track] +
-         (this->cur_head * this->sectors_per_track[this->cur_track]) +
-          sector_num - 1) * 512
-    );
+
+    TrackCache& tc = this->cur_track_cache();
+
+    // MFM sector numbering is 1-based
+    int sect = sector_num - ((this->rec_method == RecMethod::MFM) ? 1 : 0);
+
+    if (sect < 0 || sect >= (int)tc.sector_data.size() || !tc.sector_data[sect]) {
+        LOG_F(ERROR, "%s: invalid sector %d on track %d", this->get_name().c_str(),
+              sector_num, this->cur_track);
+        static char blank_sector[512] = {};
+        return blank_sector;
+    }
+
+    return tc.sector_data[sect];
 }
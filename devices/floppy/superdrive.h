@@ -31,6 +31,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <cinttypes>
 #include <memory>
 #include <string>
+#include <vector>
 
 // convert number of bytes to disk time = nbytes * bits_per_byte * 2 us
 #define     MFM_BYTES_TO_DISK_TIME(bytes) USECS_TO_NSECS((bytes) * 8 * 2)
@@ -94,6 +95,13 @@ typedef struct SectorHdr {
     int     format;
 } SectorHdr;
 
+/** Pre-built layout of one side of a track in rotational order. */
+typedef struct TrackCache {
+    uint64_t                track_delay;    // duration of one revolution in ns
+    std::vector<SectorHdr>  headers;        // address mark contents
+    std::vector<char*>      sector_data;    // sector data in the disk image
+} TrackCache;
+
 std::string get_command_name(uint8_t addr);
 std::string get_status_name(uint8_t addr);
 
@@ -121,6 +129,8 @@ protected:
     void reset_params();
     void set_disk_phys_params();
     void switch_drive_mode(int mode);
+    void build_track_cache();
+    TrackCache& cur_track_cache();
 
 private:
     uint8_t     has_disk;
@@ -158,6 +168,10 @@ private:
     std::unique_ptr<FloppyImgConverter>  img_conv;
 
     std::unique_ptr<char[]> disk_data;
+
+    // sector layout of every track side, built when a disk is inserted
+    std::vector<TrackCache> track_cache;
+    TrackCache              empty_track; // used while no disk is inserted
 };
 
 } // namespace MacSuperdrive
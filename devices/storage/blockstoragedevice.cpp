@@ -130,6 +130,19 @@ int BlockStorageDevice::read_more() {
     return read_size;
 }
 
+/* Start a read that bypasses the data cache. The data is then obtained
+   with read_direct() straight into the destination buffer. */
+int BlockStorageDevice::read_begin_direct(int nblocks) {
+    this->remain_size = 0;
+    return nblocks * this->block_size;
+}
+
+int BlockStorageDevice::read_direct(uint8_t* dst_ptr, int len) {
+    uint64_t got = this->img_file.read(dst_ptr, this->cur_fpos, len);
+    this->cur_fpos += got;
+    return (int)got;
+}
+
 int BlockStorageDevice::write_begin(int nblocks, uint32_t max_len) {
     if (!this->is_writeable)
         ABORT_F("write attempt to read-only block storage device");
@@ -34,7 +34,7 @@ class BlockStorageDevice {
 public:
     BlockStorageDevice(const uint32_t cache_blocks, const uint32_t block_size=512,
                        const uint64_t max_blocks=UINT64_MAX);
-    ~BlockStorageDevice();
+    virtual ~BlockStorageDevice();
 
     int set_host_file(std::string file_path);
     int set_block_size(const int blk_size);
@@ -43,9 +43,12 @@ public:
     int data_left() { return this->remain_size; }
     int read_begin(int nblocks, uint32_t max_len = UINT32_MAX);
     int read_more();
+    int read_begin_direct(int nblocks);
+    int read_direct(uint8_t* dst_ptr, int len);
     int write_begin(int nblocks, uint32_t max_len = UINT32_MAX);
     int write_more();
     void write_cache();
+    void flush() { this->img_file.flush(); }
 
     uint32_t get_remaining_size() {
         return this->remain_size;
@@ -55,6 +58,11 @@ public:
         return (uint8_t *)this->data_cache.get();
     }
 
+    // raw images need block data extraction so they must go through the cache
+    virtual bool can_read_direct() {
+        return this->raw_blk_size == this->block_size;
+    }
+
     bool medium_writable() {
         return this->is_writeable;
     }
@@ -68,7 +76,7 @@ public:
     }
 
 protected:
-    void fill_cache(const int nblocks);
+    virtual void fill_cache(const int nblocks);
 
     ImgFile     img_file;
     uint64_t    size_bytes    = 0;   // image file size in bytes
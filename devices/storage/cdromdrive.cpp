@@ -24,24 +24,54 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/storage/cdromdrive.h>
 #include <loguru.hpp>
 
+#include <algorithm>
+#include <cctype>
 #include <cinttypes>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <string>
 
 CdromDrive::CdromDrive() : BlockStorageDevice(31, CDR_STD_DATA_SIZE, 0xfffffffe) {
     this->is_writeable = false;
+    this->raw_buf = std::unique_ptr<uint8_t[]>(
+        new uint8_t[this->cache_blocks * CDR_RAW_SECT_SIZE]);
+}
+
+static bool is_cue_sheet(const std::string& filename) {
+    if (filename.size() < 4)
+        return false;
+
+    std::string ext = filename.substr(filename.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".cue";
 }
 
 void CdromDrive::insert_image(std::string filename) {
+    this->use_track_map = false;
+    this->extra_files.clear();
+    this->cooked_cache.clear();
+
+    if (is_cue_sheet(filename)) {
+        if (!this->load_cue_sheet(filename))
+            ABORT_F("Could not load CUE sheet, %s", filename.c_str());
+        return;
+    }
+
     if (this->set_host_file(filename) < 0)
         ABORT_F("Could not open CD-ROM image file, %s", filename.c_str());
 
-    this->detect_raw_image();
-
     // create single track descriptor
     this->tracks[0]  = {1, /*.trk_num*/ 0x14, /*.adr_ctrl*/ 0 /*.start_lba*/};
     this->num_tracks = 1;
 
+    if (this->detect_raw_image()) {
+        this->track_map[0] = {0, 0, this->raw_blk_size, this->data_offset, 0};
+        this->use_track_map = true;
+    }
+
     // create Lead-out descriptor containing all data
     this->tracks[1] = {LEAD_OUT_TRK_NUM, /*.trk_num*/ 0x14, /*.adr_ctrl*/
         static_cast<uint32_t>(this->size_blocks + 1) /*.start_lba*/};
@@ -60,16 +90,366 @@ bool CdromDrive::detect_raw_image() {
     if (block_hdr[0] != 0 || block_hdr[11] != 0)
         return false;
 
-    // for now, we only support Mode 1 images
-    if (block_hdr[15] == 1) {
-        this->set_block_size(2352);
+    switch (block_hdr[15]) {
+    case 1: // Mode 1: user data follows the header
+        this->set_block_size(CDR_RAW_SECT_SIZE);
         this->data_offset = 16;
         return true;
+    case 2: // Mode 2 Form 1: user data follows the header and the subheader
+        this->set_block_size(CDR_RAW_SECT_SIZE);
+        this->data_offset = 24;
+        return true;
     }
 
     return false;
 }
 
+static bool parse_msf(const std::string& str, uint32_t& frames) {
+    int min, sec, frm;
+
+    if (std::sscanf(str.c_str(), "%d:%d:%d", &min, &sec, &frm) != 3 ||
+        min < 0 || sec < 0 || sec > 59 || frm < 0 || frm > 74)
+        return false;
+
+    frames = (min * 60 + sec) * 75 + frm;
+    return true;
+}
+
+/* Parse a CUE sheet and build the TOC and the track map from it.
+   Tracks may reside in one or several BINARY files. Sectors covered by
+   PREGAP commands aren't stored in the files and read back as zeroes. */
+bool CdromDrive::load_cue_sheet(const std::string& cue_path) {
+    struct CueTrack {
+        int         file_idx;
+        uint32_t    sect_size;
+        uint32_t    data_offset;
+        uint8_t     adr_ctrl;
+        int64_t     index0 = -1;
+        int64_t     index1 = -1;
+        uint32_t    pregap = 0;
+    };
+
+    static const struct {
+        const char* name;
+        uint32_t    sect_size;
+        uint32_t    data_offset;
+        uint8_t     adr_ctrl;
+    } track_modes[] = {
+        {"MODE1/2048", 2048,              0, 0x14},
+        {"MODE1/2352", CDR_RAW_SECT_SIZE, 16, 0x14},
+        {"MODE2/2336", 2336,              8, 0x14},
+        {"MODE2/2352", CDR_RAW_SECT_SIZE, 24, 0x14},
+        {"AUDIO",      CDR_RAW_SECT_SIZE, 0, 0x10},
+    };
+
+    std::ifstream cue(cue_path);
+    if (!cue) {
+        LOG_F(ERROR, "CdromDrive: could not open %s", cue_path.c_str());
+        return false;
+    }
+
+    // file names are relative to the directory containing the CUE sheet
+    std::string base_dir = cue_path.substr(0, cue_path.find_last_of("/\\") + 1);
+
+    std::vector<std::string> files;
+    std::vector<CueTrack>    cue_tracks;
+    std::string              line;
+    int                      line_num = 0;
+
+    while (std::getline(cue, line)) {
+        line_num++;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::istringstream ls(line);
+        std::string keyword;
+        ls >> keyword;
+        std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::toupper);
+
+        if (keyword == "FILE") {
+            std::string name, type;
+            size_t q1 = line.find('"');
+            size_t q2 = line.rfind('"');
+            if (q1 != std::string::npos && q2 > q1) {
+                name = line.substr(q1 + 1, q2 - q1 - 1);
+                std::istringstream(line.substr(q2 + 1)) >> type;
+            } else {
+                ls >> name >> type;
+            }
+            std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+            if (name.empty() || (type != "BINARY" && type != "MOTOROLA")) {
+                LOG_F(ERROR, "CdromDrive: line %d, unsupported file %s %s",
+                      line_num, name.c_str(), type.c_str());
+                return false;
+            }
+            if (name[0] != '/' && !(name.size() > 1 && name[1] == ':'))
+                name = base_dir + name;
+            files.push_back(name);
+        } else if (keyword == "TRACK") {
+            int trk_num = 0;
+            std::string mode;
+            ls >> trk_num >> mode;
+            std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+
+            if (files.empty() || trk_num != (int)cue_tracks.size() + 1 ||
+                trk_num >= CDROM_MAX_TRACKS) {
+                LOG_F(ERROR, "CdromDrive: line %d, unexpected TRACK %d", line_num,
+                      trk_num);
+                return false;
+            }
+
+            CueTrack trk = {};
+            trk.file_idx = (int)files.size() - 1;
+            trk.sect_size = 0;
+            trk.index0 = trk.index1 = -1;
+            for (auto& tm : track_modes) {
+                if (mode == tm.name) {
+                    trk.sect_size   = tm.sect_size;
+                    trk.data_offset = tm.data_offset;
+                    trk.adr_ctrl    = tm.adr_ctrl;
+                }
+            }
+            if (!trk.sect_size) {
+                LOG_F(ERROR, "CdromDrive: line %d, unsupported track mode %s",
+                      line_num, mode.c_str());
+                return false;
+            }
+            cue_tracks.push_back(trk);
+        } else if (keyword == "INDEX" || keyword == "PREGAP") {
+            int idx_num = 0;
+            std::string msf;
+            uint32_t frames;
+
+            if (keyword == "INDEX")
+                ls >> idx_num;
+            ls >> msf;
+
+            if (cue_tracks.empty() || !parse_msf(msf, frames)) {
+                LOG_F(ERROR, "CdromDrive: line %d, invalid %s", line_num,
+                      keyword.c_str());
+                return false;
+            }
+
+            if (keyword == "PREGAP")
+                cue_tracks.back().pregap = frames;
+            else if (idx_num == 0)
+                cue_tracks.back().index0 = frames;
+            else if (idx_num == 1)
+                cue_tracks.back().index1 = frames;
+        }
+        // everything else (REM, TITLE, POSTGAP etc.) doesn't affect the layout
+    }
+
+    if (cue_tracks.empty()) {
+        LOG_F(ERROR, "CdromDrive: no tracks in %s", cue_path.c_str());
+        return false;
+    }
+
+    if (this->set_host_file(files[0]) < 0) {
+        LOG_F(ERROR, "CdromDrive: could not open %s", files[0].c_str());
+        return false;
+    }
+
+    this->set_block_size(cue_tracks[0].sect_size);
+
+    std::vector<uint64_t> file_sizes = {this->size_bytes};
+
+    for (size_t i = 1; i < files.size(); i++) {
+        std::unique_ptr<ImgFile> f(new ImgFile());
+        if (!f->open(files[i])) {
+            LOG_F(ERROR, "CdromDrive: could not open %s", files[i].c_str());
+            return false;
+        }
+        file_sizes.push_back(f->size());
+        this->extra_files.push_back(std::move(f));
+    }
+
+    // Track positions in the disk address space: each file continues
+    // where the previous one ended; PREGAP adds sectors not in the file.
+    uint64_t file_base = 0;
+    uint64_t gap_total = 0;
+
+    for (size_t i = 0; i < cue_tracks.size(); i++) {
+        CueTrack& trk = cue_tracks[i];
+        uint64_t  file_pos;
+
+        if (trk.index1 < 0) {
+            LOG_F(ERROR, "CdromDrive: track %d has no INDEX 01", (int)i + 1);
+            return false;
+        }
+
+        if (!i || trk.file_idx != cue_tracks[i - 1].file_idx) {
+            if (i) {
+                CueTrack&    prev = cue_tracks[i - 1];
+                TrackLayout& pl   = this->track_map[i - 1];
+                uint64_t     prev_size = file_sizes[prev.file_idx];
+                file_base = this->tracks[i - 1].start_lba +
+                    (prev_size > pl.file_pos ? (prev_size - pl.file_pos) / pl.sect_size : 0);
+                gap_total = 0;
+            }
+            file_pos = trk.index1 * trk.sect_size;
+        } else {
+            // sectors before INDEX 00 belong to the previous track
+            CueTrack& prev  = cue_tracks[i - 1];
+            int64_t   split = trk.index0 >= 0 ? trk.index0 : trk.index1;
+            if (split < prev.index1 || trk.index1 < split) {
+                LOG_F(ERROR, "CdromDrive: track %d indices out of order", (int)i + 1);
+                return false;
+            }
+            file_pos = this->track_map[i - 1].file_pos +
+                (split - prev.index1) * prev.sect_size +
+                (trk.index1 - split) * trk.sect_size;
+        }
+
+        gap_total += trk.pregap;
+
+        this->tracks[i] = {static_cast<uint8_t>(i + 1), trk.adr_ctrl,
+            static_cast<uint32_t>(file_base + gap_total + trk.index1)};
+        this->track_map[i] = {trk.file_idx, file_pos, trk.sect_size, trk.data_offset,
+                              trk.pregap};
+
+        LOG_F(INFO, "CdromDrive: track %d, LBA %d, %d bytes/sector", (int)i + 1,
+              this->tracks[i].start_lba, trk.sect_size);
+    }
+
+    this->num_tracks = (int)cue_tracks.size();
+
+    TrackLayout& last = this->track_map[this->num_tracks - 1];
+    uint64_t last_size = file_sizes[last.file_idx];
+    this->size_blocks = this->tracks[this->num_tracks - 1].start_lba +
+        (last_size > last.file_pos ? (last_size - last.file_pos) / last.sect_size : 0);
+
+    if (this->size_blocks > this->max_blocks) {
+        LOG_F(ERROR, "CdromDrive: image too big");
+        return false;
+    }
+
+    // create Lead-out descriptor
+    this->tracks[this->num_tracks] = {LEAD_OUT_TRK_NUM, /*.trk_num*/
+        this->tracks[this->num_tracks - 1].adr_ctrl, /*.adr_ctrl*/
+        static_cast<uint32_t>(this->size_blocks + 1) /*.start_lba*/};
+
+    this->use_track_map = true;
+
+    return true;
+}
+
+// PREGAP sectors belong to the track they precede.
+int CdromDrive::find_track(uint32_t lba) {
+    for (int trk = this->num_tracks - 1; trk > 0; trk--)
+        if (lba + this->track_map[trk].pregap >= this->tracks[trk].start_lba)
+            return trk;
+    return 0;
+}
+
+/* Read count sectors of the given track starting with lba.
+   Sectors outside of the image file(s) are returned as zeroes. */
+void CdromDrive::read_raw_sectors(int trk, uint32_t lba, int count, uint8_t* dst) {
+    const TrackLayout& tl = this->track_map[trk];
+    uint32_t start_lba = this->tracks[trk].start_lba;
+
+    if (lba < start_lba && lba + tl.pregap >= start_lba) {
+        int gap = (int)std::min<uint32_t>(count, start_lba - lba);
+        std::memset(dst, 0, (size_t)gap * tl.sect_size);
+        dst   += (size_t)gap * tl.sect_size;
+        lba   += gap;
+        count -= gap;
+    }
+
+    ImgFile& file = tl.file_idx ? *this->extra_files[tl.file_idx - 1] : this->img_file;
+    uint64_t file_size = tl.file_idx ? file.size() : this->size_bytes;
+
+    int64_t  pos = (int64_t)tl.file_pos + ((int64_t)lba - start_lba) * tl.sect_size;
+    uint64_t len = (uint64_t)count * tl.sect_size;
+
+    if (pos < 0) {
+        uint64_t skip = std::min(len, (uint64_t)-pos);
+        std::memset(dst, 0, skip);
+        dst += skip;
+        len -= skip;
+        pos  = 0;
+    }
+
+    uint64_t got = 0;
+    if (len && (uint64_t)pos < file_size)
+        got = file.read(dst, pos, std::min(len, file_size - pos));
+
+    if (got < len)
+        std::memset(dst + got, 0, len - got);
+}
+
+void CdromDrive::fill_cache(const int nblocks) {
+    if (!this->use_track_map) {
+        BlockStorageDevice::fill_cache(nblocks);
+        return;
+    }
+
+    uint32_t lba = static_cast<uint32_t>(this->cur_fpos / this->raw_blk_size);
+    uint8_t* out = (uint8_t *)this->data_cache.get();
+
+    for (int blk = 0; blk < nblocks;) {
+        const uint8_t* data = this->cooked_cache.lookup(lba + blk);
+        if (data) {
+            std::memcpy(out + blk * this->block_size, data, this->block_size);
+            blk++;
+            continue;
+        }
+
+        // fetch the following uncached sectors of the same track at once
+        int trk = this->find_track(lba + blk);
+        int run = 1;
+        while (blk + run < nblocks && !this->cooked_cache.contains(lba + blk + run) &&
+               this->find_track(lba + blk + run) == trk)
+            run++;
+
+        this->read_raw_sectors(trk, lba + blk, run, this->raw_buf.get());
+
+        const TrackLayout& tl = this->track_map[trk];
+
+        for (int i = 0; i < run; i++, blk++) {
+            const uint8_t* src = this->raw_buf.get() + i * tl.sect_size + tl.data_offset;
+            std::memcpy(out + blk * this->block_size, src, this->block_size);
+            // cooked sectors of 2048-byte tracks are served by the image block cache
+            if (tl.sect_size != this->block_size)
+                this->cooked_cache.insert(lba + blk, src);
+        }
+    }
+
+    this->cur_fpos += (uint64_t)nblocks * this->raw_blk_size;
+}
+
+const uint8_t* CookedSectorCache::lookup(uint32_t lba) {
+    auto it = this->map.find(lba);
+    if (it == this->map.end())
+        return nullptr;
+
+    this->lru.splice(this->lru.begin(), this->lru, it->second);
+    return it->second->data;
+}
+
+void CookedSectorCache::insert(uint32_t lba, const uint8_t* data) {
+    if (this->map.count(lba))
+        return;
+
+    if (this->map.size() >= CDR_COOKED_CACHE_SECTORS) {
+        // recycle the least recently used sector
+        this->map.erase(this->lru.back().lba);
+        this->lru.splice(this->lru.begin(), this->lru, std::prev(this->lru.end()));
+    } else {
+        this->lru.emplace_front();
+    }
+
+    this->lru.front().lba = lba;
+    std::memcpy(this->lru.front().data, data, CDR_STD_DATA_SIZE);
+    this->map[lba] = this->lru.begin();
+}
+
+void CookedSectorCache::clear() {
+    this->map.clear();
+    this->lru.clear();
+}
+
 uint8_t CdromDrive::hex_to_bcd(const uint8_t val) {
     uint8_t hi = val / 10;
     uint8_t lo = val % 10;
@@ -28,6 +28,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <cinttypes>
 #include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 /** CD/DVD drive read/write capabilities. */
 enum CdDriveCapabilities : uint8_t {
@@ -70,9 +75,40 @@ typedef struct {
     uint32_t    start_lba;
 } TrackDescriptor;
 
+/* Location of track sectors in the image file(s) */
+typedef struct {
+    int         file_idx;    // 0 - main image file, N - extra_files[N-1]
+    uint64_t    file_pos;    // byte offset of the first track sector (INDEX 01)
+    uint32_t    sect_size;   // sector size in the image file
+    uint32_t    data_offset; // offset to user data within a sector
+    uint32_t    pregap;      // sectors in front of INDEX 01 that aren't in the file
+} TrackLayout;
+
 constexpr auto CDROM_MAX_TRACKS = 100;
 constexpr auto LEAD_OUT_TRK_NUM = 0xAA;
 constexpr auto CDR_STD_DATA_SIZE = 2048;
+constexpr auto CDR_RAW_SECT_SIZE = 2352;
+
+// number of converted 2048-byte sectors kept in memory (4 MB)
+constexpr auto CDR_COOKED_CACHE_SECTORS = 2048;
+
+/** LRU cache of user data extracted from raw CD-ROM sectors. */
+class CookedSectorCache {
+public:
+    const uint8_t* lookup(uint32_t lba);
+    bool contains(uint32_t lba) { return this->map.count(lba) != 0; }
+    void insert(uint32_t lba, const uint8_t* data);
+    void clear();
+
+private:
+    struct Sector {
+        uint32_t    lba;
+        uint8_t     data[CDR_STD_DATA_SIZE];
+    };
+
+    std::list<Sector>                                           lru; // most recent first
+    std::unordered_map<uint32_t, std::list<Sector>::iterator>   map;
+};
 
 class CdromDrive : public BlockStorageDevice {
 public:
@@ -83,14 +119,29 @@ public:
 
     void insert_image(std::string filename);
 
+    bool can_read_direct() override {
+        return !this->use_track_map && BlockStorageDevice::can_read_direct();
+    }
+
 protected:
     uint8_t hex_to_bcd(const uint8_t val);
     AddrMsf lba_to_msf(const int lba);
     bool    detect_raw_image();
+    bool    load_cue_sheet(const std::string& cue_path);
+    void    fill_cache(const int nblocks) override;
+    int     find_track(uint32_t lba);
+    void    read_raw_sectors(int trk, uint32_t lba, int count, uint8_t* dst);
 
     TrackDescriptor tracks[CDROM_MAX_TRACKS];
+    TrackLayout     track_map[CDROM_MAX_TRACKS];
     int             num_tracks;
 
+    // raw and CUE/BIN images are read sector by sector through the track map
+    bool                                    use_track_map = false;
+    std::vector<std::unique_ptr<ImgFile>>   extra_files; // multi-file CUE sheets
+    std::unique_ptr<uint8_t[]>              raw_buf;
+    CookedSectorCache                       cooked_cache;
+
     // drive capabilities
     uint8_t  read_cap     = CdDriveCapabilities::CDCAP_CDE_READ  |
                             CdDriveCapabilities::CDCAP_CDR_READ;
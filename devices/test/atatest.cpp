@@ -0,0 +1,104 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file IDE data port tests. */
+
+#include "devicetests.h"
+
+#include <devices/common/ata/atabasedevice.h>
+#include <devices/common/ata/atadefs.h>
+#include <devices/common/ata/idechannel.h>
+
+#include <cstring>
+#include <string>
+
+using namespace ata_interface;
+
+/** ATA device with a single 512-byte PIO block set up by the test. */
+class PioTestDevice : public AtaBaseDevice {
+public:
+    PioTestDevice() : AtaBaseDevice("PioTest", DEVICE_TYPE_ATA) {}
+
+    int perform_command() override { return 0; }
+
+    // disk bytes 0, 1, 2, ... ready to be read from the data port
+    void start_read() {
+        for (size_t i = 0; i < sizeof(this->data_buf); i++)
+            this->data_buf[i] = uint8_t(i);
+        this->start_xfer();
+    }
+
+    void start_write() {
+        std::memset(this->data_buf, 0, sizeof(this->data_buf));
+        this->post_xfer_action = []() {};
+        this->start_xfer();
+    }
+
+    const uint8_t* buf() const { return this->data_buf; }
+
+private:
+    void start_xfer() {
+        this->data_ptr     = (uint16_t*)this->data_buf;
+        this->cur_data_ptr = this->data_ptr;
+        this->prepare_xfer(sizeof(this->data_buf), sizeof(this->data_buf));
+        this->signal_data_ready();
+    }
+};
+
+static void test_data_port(IdeChannel& ch, bool dword_data, const std::string& bus) {
+    PioTestDevice dev;
+    ch.register_device(0, &dev);
+
+    dev.start_read();
+    check(ch.read(DATA, 2) == 0x0001, bus + ": 16-bit read returns the first word");
+    if (dword_data) {
+        check(ch.read(DATA, 4) == 0x02030405, bus + ": 32-bit read returns two words, first one high");
+        check(ch.read(DATA, 2) == 0x0607, bus + ": 32-bit read consumes two words");
+    } else {
+        check(ch.read(DATA, 4) == 0x0203, bus + ": 32-bit read returns a single word");
+        check(ch.read(DATA, 2) == 0x0405, bus + ": 32-bit read consumes a single word");
+    }
+
+    dev.start_write();
+    ch.write(DATA, 0x0001, 2);
+    ch.write(DATA, 0x02030405, 4);
+    ch.write(DATA, 0x0607, 2);
+    if (dword_data) {
+        const uint8_t expected[] = {0, 1, 2, 3, 4, 5, 6, 7};
+        check(!std::memcmp(dev.buf(), expected, sizeof(expected)),
+              bus + ": 32-bit write stores two words, upper one first");
+    } else {
+        const uint8_t expected[] = {0, 1, 4, 5, 6, 7, 0, 0};
+        check(!std::memcmp(dev.buf(), expected, sizeof(expected)),
+              bus + ": 32-bit write stores the lower word only");
+    }
+}
+
+void test_ata() {
+    // CMD646 on PCI passes 32-bit accesses through
+    IdeChannel pci_ch("CmdAta0", true);
+    test_data_port(pci_ch, true, "PCI");
+
+    // MacIO keeps moving one word per access
+    MacioIdeChannel macio_ch("IDE0");
+    test_data_port(macio_ch, false, "MacIO");
+}
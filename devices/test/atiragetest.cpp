@@ -0,0 +1,302 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file ATI Rage draw engine tests. */
+
+#include "devicetests.h"
+
+#include <core/endianswap.h>
+#include <devices/video/atimach64defs.h>
+#include <devices/video/atirage.h>
+#include <devices/video/display.h>
+#include <machines/machineproperties.h>
+
+#include <memory>
+#include <string>
+
+static std::unique_ptr<ATIRage> gpu;
+
+constexpr int PITCH = 64; // destination pitch in pixels
+
+// Aperture 0 bases are still zero, so it decodes any region start of 0.
+static void set_reg(uint32_t reg_num, uint32_t value) {
+    gpu->write(0, MM_REGS_0_OFF + reg_num * 4, BYTESWAP_32(value), 4);
+}
+
+static uint8_t vram_byte(uint32_t offset) {
+    return gpu->read(0, offset, 1);
+}
+
+static void set_vram_byte(uint32_t offset, uint8_t value) {
+    gpu->write(0, offset, value, 1);
+}
+
+// ARGB8888 pixels are stored big-endian
+static uint32_t get_pix32(int x, int y) {
+    uint32_t offs = (y * PITCH + x) * 4;
+    return (vram_byte(offs) << 24) | (vram_byte(offs + 1) << 16) |
+           (vram_byte(offs + 2) << 8) | vram_byte(offs + 3);
+}
+
+static void set_pix32(int x, int y, uint32_t pix) {
+    uint32_t offs = (y * PITCH + x) * 4;
+    for (int i = 0; i < 4; i++)
+        set_vram_byte(offs + i, pix >> (24 - i * 8));
+}
+
+// RGB565 pixels are stored little-endian
+static uint16_t get_pix16(int x, int y) {
+    uint32_t offs = (y * PITCH + x) * 2;
+    return vram_byte(offs) | (vram_byte(offs + 1) << 8);
+}
+
+static void clear_vram() {
+    for (uint32_t offs = 0; offs < PITCH * PITCH * 4; offs++)
+        set_vram_byte(offs, 0);
+}
+
+// Program a left-to-right, top-to-bottom operation covering the whole surface.
+static void setup_engine(uint8_t pix_fmt, uint32_t dp_src, uint32_t dp_mix) {
+    set_reg(ATI_DST_OFF_PITCH, (PITCH / 8) << ATI_DST_PITCH);
+    set_reg(ATI_SRC_OFF_PITCH, (PITCH / 8) << ATI_SRC_PITCH);
+    set_reg(ATI_DP_PIX_WIDTH, pix_fmt | (pix_fmt << 8) | (pix_fmt << 16));
+    set_reg(ATI_SC_LEFT_RIGHT, (PITCH - 1) << 16);
+    set_reg(ATI_SC_TOP_BOTTOM, (PITCH - 1) << 16);
+    set_reg(ATI_DP_WRITE_MSK, 0xFFFFFFFFU);
+    set_reg(ATI_CLR_CMP_CNTL, 0);
+    set_reg(ATI_SRC_CNTL, 0);
+    set_reg(ATI_HOST_CNTL, 0);
+    set_reg(ATI_DST_CNTL, (1 << ATI_DST_X_DIR) | (1 << ATI_DST_Y_DIR));
+    set_reg(ATI_DP_SRC, dp_src);
+    set_reg(ATI_DP_MIX, dp_mix);
+}
+
+static void draw_rect(int x, int y, int width, int height) {
+    set_reg(ATI_DST_Y_X, (x << 16) | y);
+    set_reg(ATI_DST_HEIGHT_WIDTH, (width << 16) | height);
+}
+
+static uint32_t dp_src(uint32_t mono_src, uint32_t frgd_src, uint32_t bkgd_src) {
+    return (mono_src << ATI_DP_MONO_SRC) | (frgd_src << ATI_DP_FRGD_SRC) |
+           (bkgd_src << ATI_DP_BKGD_SRC);
+}
+
+static uint32_t dp_mix(uint32_t frgd_mix, uint32_t bkgd_mix) {
+    return (frgd_mix << ATI_DP_FRGD_MIX) | (bkgd_mix << ATI_DP_BKGD_MIX);
+}
+
+// Check pixels of a rectangle against expect(x, y); the border must stay zero.
+template <typename Fn>
+static void check_rect32(const std::string& what, int x0, int y0, int width, int height,
+                         Fn expect) {
+    bool inside_ok  = true;
+    bool outside_ok = true;
+
+    for (int y = y0 - 1; y <= y0 + height; y++) {
+        for (int x = x0 - 1; x <= x0 + width; x++) {
+            if (x >= x0 && x < x0 + width && y >= y0 && y < y0 + height)
+                inside_ok &= get_pix32(x, y) == expect(x, y);
+            else
+                outside_ok &= get_pix32(x, y) == 0;
+        }
+    }
+
+    check(inside_ok, what + ": rectangle contents");
+    check(outside_ok, what + ": nothing drawn outside");
+}
+
+static void test_solid_fill() {
+    clear_vram();
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_FRGD_CLR, 0),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST));
+    set_reg(ATI_DP_FRGD_CLR, 0x11223344);
+    draw_rect(2, 1, 3, 2);
+
+    check_rect32("solid fill", 2, 1, 3, 2, [](int, int) { return 0x11223344U; });
+}
+
+static void test_masked_xor_fill() {
+    clear_vram();
+    for (int x = 4; x < 8; x++)
+        set_pix32(x, 6, 0xAABBCCDD);
+
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_FRGD_CLR, 0),
+                 dp_mix(0x05, ATI_DP_MIX_DST)); // dst ^ src
+    set_reg(ATI_DP_FRGD_CLR, 0x0F0F0F0F);
+    set_reg(ATI_DP_WRITE_MSK, 0x00FF00FF);
+    draw_rect(4, 6, 4, 1);
+
+    check_rect32("masked XOR fill", 4, 6, 4, 1, [](int, int) { return 0xAAB4CCD2U; });
+}
+
+static void test_blit() {
+    clear_vram();
+    for (int y = 10; y < 12; y++)
+        for (int x = 1; x < 5; x++)
+            set_pix32(x, y, 0xFF000000U | (y << 8) | x);
+
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_BLIT, 0),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST));
+    set_reg(ATI_SRC_Y_X, (1 << 16) | 10);
+    draw_rect(10, 20, 4, 2);
+
+    check_rect32("blit", 10, 20, 4, 2, [](int x, int y) {
+        return 0xFF000000U | ((y - 10) << 8) | (x - 9);
+    });
+
+    // right-to-left, bottom-to-top copy within the same rows
+    set_reg(ATI_DST_CNTL, 0);
+    set_reg(ATI_SRC_Y_X, (13 << 16) | 21);
+    draw_rect(14, 21, 4, 2);
+    check(get_pix32(10, 20) == 0xFF000A01 && get_pix32(11, 20) == 0xFF000A01 &&
+          get_pix32(14, 20) == 0xFF000A04 && get_pix32(14, 21) == 0xFF000B04,
+          "blit: right-to-left copy");
+}
+
+static void test_average_mix() {
+    clear_vram();
+    for (int x = 0; x < 3; x++)
+        set_pix32(x + 1, 30, 0x10203040);
+
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_FRGD_CLR, 0),
+                 dp_mix(ATI_DP_MIX_AVERAGE, ATI_DP_MIX_DST));
+    set_reg(ATI_DP_FRGD_CLR, 0x30405061);
+    draw_rect(1, 30, 3, 1);
+
+    // no carries from one component into the next one
+    check_rect32("average mix", 1, 30, 3, 1, [](int, int) { return 0x20304050U; });
+}
+
+static void test_color_compare() {
+    clear_vram();
+    for (int x = 0; x < 6; x++)
+        set_pix32(x + 1, 40, (x & 1) ? 0x12345678 : 0);
+
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_FRGD_CLR, 0),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST));
+    set_reg(ATI_DP_FRGD_CLR, 0xCAFEBABE);
+    set_reg(ATI_CLR_CMP_CLR, 0x12345678);
+    set_reg(ATI_CLR_CMP_MSK, 0xFFFFFFFF);
+    set_reg(ATI_CLR_CMP_CNTL, ATI_CLR_CMP_FCN_EQUAL); // keep matching destination pixels
+    draw_rect(1, 40, 6, 1);
+
+    check_rect32("color compare", 1, 40, 6, 1, [](int x, int) {
+        return ((x - 1) & 1) ? 0x12345678U : 0xCAFEBABEU;
+    });
+}
+
+static void test_pattern_expansion() {
+    clear_vram();
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_PATTERN, ATI_DP_COLOR_SRC_FRGD_CLR,
+                        ATI_DP_COLOR_SRC_BKGD_CLR),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_SRC));
+    set_reg(ATI_DP_FRGD_CLR, 0xFFFFFFFF);
+    set_reg(ATI_DP_BKGD_CLR, 0xFF000000);
+    set_reg(ATI_PAT_REG0, 0x8001F00F); // rows 0...3
+    set_reg(ATI_PAT_REG1, 0x00000000); // rows 4...7
+    draw_rect(8, 48, 8, 4);
+
+    static const uint8_t pat_rows[4] = {0x0F, 0xF0, 0x01, 0x80};
+
+    check_rect32("pattern expansion", 8, 48, 8, 4, [](int x, int y) {
+        return (pat_rows[y & 3] >> (7 - (x & 7))) & 1 ? 0xFFFFFFFFU : 0xFF000000U;
+    });
+}
+
+static void test_host_mono() {
+    clear_vram();
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_HOST, ATI_DP_COLOR_SRC_FRGD_CLR,
+                        ATI_DP_COLOR_SRC_BKGD_CLR),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST)); // transparent background
+    set_reg(ATI_DP_FRGD_CLR, 0x00ABCDEF);
+    draw_rect(20, 50, 8, 2);
+    set_reg(ATI_HOST_DATA0, 0x000081F0); // first byte is consumed first
+
+    check_rect32("host mono data", 20, 50, 8, 2, [](int x, int y) {
+        uint8_t bits = y == 50 ? 0xF0 : 0x81;
+        return (bits >> (7 - (x - 20))) & 1 ? 0x00ABCDEFU : 0;
+    });
+}
+
+static void test_host_color() {
+    // 32bpp, left to right: one pixel per write
+    clear_vram();
+    setup_engine(ATI_PIX_FMT_ARGB8888,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_HOST, 0),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST));
+    draw_rect(30, 2, 2, 1);
+    set_reg(ATI_HOST_DATA0, 0x11223344);
+    set_reg(ATI_HOST_DATA0 + 1, 0x55667788);
+    check(get_pix32(30, 2) == 0x11223344 && get_pix32(31, 2) == 0x55667788,
+          "host color data, 32bpp");
+
+    // 32bpp, right to left: pixel values don't change
+    set_reg(ATI_DST_CNTL, 1 << ATI_DST_Y_DIR);
+    draw_rect(40, 2, 2, 1);
+    set_reg(ATI_HOST_DATA0, 0x11223344);
+    set_reg(ATI_HOST_DATA0, 0x55667788);
+    check(get_pix32(40, 2) == 0x11223344 && get_pix32(39, 2) == 0x55667788,
+          "host color data, 32bpp, right to left");
+
+    // 16bpp, left to right: the low half of each write is drawn first
+    clear_vram();
+    setup_engine(ATI_PIX_FMT_RGB565,
+                 dp_src(ATI_DP_MONO_SRC_ALWAYS_1, ATI_DP_COLOR_SRC_HOST, 0),
+                 dp_mix(ATI_DP_MIX_SRC, ATI_DP_MIX_DST));
+    draw_rect(10, 3, 2, 1);
+    set_reg(ATI_HOST_DATA0, 0x1234ABCD);
+    check(get_pix16(10, 3) == 0xABCD && get_pix16(11, 3) == 0x1234,
+          "host color data, 16bpp");
+
+    // 16bpp, right to left: pixel order is reversed, byte order is kept
+    set_reg(ATI_DST_CNTL, 1 << ATI_DST_Y_DIR);
+    draw_rect(20, 3, 2, 1);
+    set_reg(ATI_HOST_DATA0, 0x1234ABCD);
+    check(get_pix16(20, 3) == 0x1234 && get_pix16(19, 3) == 0xABCD,
+          "host color data, 16bpp, right to left");
+}
+
+void test_atirage() {
+    gMachineSettings["gfxmem_size"] = std::unique_ptr<BasicProperty>(new IntProperty(2));
+    gMachineSettings["mon_id"]      = std::unique_ptr<BasicProperty>(new StrProperty(""));
+    g_display_backend = DisplayBackend::none;
+
+    gpu = std::unique_ptr<ATIRage>(new ATIRage(ATI_RAGE_GT_DEV_ID));
+
+    test_solid_fill();
+    test_masked_xor_fill();
+    test_blit();
+    test_average_mix();
+    test_color_compare();
+    test_pattern_expansion();
+    test_host_mono();
+    test_host_color();
+
+    gpu.reset();
+}
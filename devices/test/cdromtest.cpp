@@ -0,0 +1,262 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file CUE sheet and CD-ROM track map tests. */
+
+#include "devicetests.h"
+
+#include <devices/storage/cdromdrive.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/** Exposes the track map internals of CdromDrive. */
+class CueTestDrive : public CdromDrive {
+public:
+    using CdromDrive::load_cue_sheet;
+    using CdromDrive::find_track;
+    using CdromDrive::read_raw_sectors;
+
+    int      get_num_tracks() const { return this->num_tracks; }
+    uint32_t start_lba(int trk) const { return this->tracks[trk].start_lba; }
+    uint8_t  adr_ctrl(int trk) const { return this->tracks[trk].adr_ctrl; }
+
+    // cooked 2048-byte sectors as the SCSI/ATAPI READ commands get them
+    std::vector<uint8_t> read_user_data(uint32_t lba, int count) {
+        this->set_fpos(lba);
+        this->read_begin(count);
+        uint8_t* data = this->get_cache_ptr();
+        return std::vector<uint8_t>(data, data + count * CDR_STD_DATA_SIZE);
+    }
+};
+
+static fs::path test_dir() {
+    return fs::temp_directory_path() / "dppc_cue_test";
+}
+
+// byte j of sector s in file f, different for every sector
+static uint8_t sect_byte(int f, int s, int j) {
+    return uint8_t(s * 13 + j + f * 101);
+}
+
+static std::vector<uint8_t> make_sectors(int f, int count, int sect_size) {
+    std::vector<uint8_t> data(size_t(count) * sect_size);
+    for (int s = 0; s < count; s++)
+        for (int j = 0; j < sect_size; j++)
+            data[size_t(s) * sect_size + j] = sect_byte(f, s, j);
+    return data;
+}
+
+static void write_file(const fs::path& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+static void write_file(const fs::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream f(path, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// expected content of count sectors of a file starting at sector s
+static std::vector<uint8_t> file_sectors(int f, int s, int count, int sect_size) {
+    std::vector<uint8_t> data = make_sectors(f, s + count, sect_size);
+    return std::vector<uint8_t>(data.begin() + size_t(s) * sect_size, data.end());
+}
+
+static std::vector<uint8_t> user_data(int f, int s, int sect_size, int data_offset) {
+    std::vector<uint8_t> data(CDR_STD_DATA_SIZE);
+    for (int j = 0; j < CDR_STD_DATA_SIZE; j++)
+        data[j] = sect_byte(f, s, j + data_offset);
+    return data;
+}
+
+static bool is_zero(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        if (data[i])
+            return false;
+    return true;
+}
+
+static bool same(const std::vector<uint8_t>& data, size_t offset, const std::vector<uint8_t>& exp) {
+    return data.size() >= offset + exp.size() &&
+        !std::memcmp(&data[offset], exp.data(), exp.size());
+}
+
+/* One file holding a data track followed by two audio tracks. Track 2
+   has INDEX 00 and 01 in the file, track 3 a PREGAP that isn't. */
+static void test_single_file() {
+    fs::path dir = test_dir();
+    write_file(dir / "disc.bin", make_sectors(0, 100, CDR_RAW_SECT_SIZE));
+    write_file(dir / "disc.cue",
+        "REM single file image\r\n"
+        "FILE \"disc.bin\" BINARY\r\n"
+        "  TRACK 01 MODE1/2352\r\n"
+        "    INDEX 01 00:00:00\r\n"
+        "  TRACK 02 AUDIO\r\n"
+        "    INDEX 00 00:00:50\r\n"
+        "    INDEX 01 00:00:52\r\n"
+        "  TRACK 03 AUDIO\r\n"
+        "    PREGAP 00:00:10\r\n"
+        "    INDEX 01 00:01:00\r\n");
+
+    CueTestDrive cd;
+    check(cd.load_cue_sheet((dir / "disc.cue").string()), "single file: CUE sheet loads");
+    check(cd.get_num_tracks() == 3, "single file: three tracks");
+    check(cd.start_lba(0) == 0 && cd.start_lba(1) == 52 && cd.start_lba(2) == 85,
+          "single file: tracks start at INDEX 01 plus the PREGAP");
+    check(cd.adr_ctrl(0) == 0x14 && cd.adr_ctrl(1) == 0x10, "single file: data and audio tracks");
+    check(cd.get_size_in_blocks() == 110, "single file: size includes the PREGAP");
+    check(cd.start_lba(3) == 111, "single file: lead-out follows the last sector");
+
+    check(cd.find_track(0) == 0 && cd.find_track(51) == 0,
+          "single file: INDEX 00 sectors belong to the previous track");
+    check(cd.find_track(52) == 1 && cd.find_track(74) == 1, "single file: track 2 range");
+    check(cd.find_track(75) == 2 && cd.find_track(85) == 2 && cd.find_track(109) == 2,
+          "single file: PREGAP sectors belong to track 3");
+
+    std::vector<uint8_t> raw(12 * CDR_RAW_SECT_SIZE);
+
+    cd.read_raw_sectors(0, 50, 2, raw.data());
+    check(same(raw, 0, file_sectors(0, 50, 2, CDR_RAW_SECT_SIZE)),
+          "single file: INDEX 00 sectors read from the file");
+
+    cd.read_raw_sectors(1, 52, 1, raw.data());
+    check(same(raw, 0, file_sectors(0, 52, 1, CDR_RAW_SECT_SIZE)),
+          "single file: track 2 starts at INDEX 01");
+
+    cd.read_raw_sectors(2, 74 + 1, 12, raw.data());
+    check(is_zero(raw.data(), 10 * CDR_RAW_SECT_SIZE),
+          "single file: PREGAP sectors read as zeroes");
+    check(same(raw, 10 * CDR_RAW_SECT_SIZE, file_sectors(0, 75, 2, CDR_RAW_SECT_SIZE)),
+          "single file: track 3 data follows the PREGAP");
+
+    cd.read_raw_sectors(2, 109, 2, raw.data());
+    check(same(raw, 0, file_sectors(0, 99, 1, CDR_RAW_SECT_SIZE)) &&
+          is_zero(&raw[CDR_RAW_SECT_SIZE], CDR_RAW_SECT_SIZE),
+          "single file: sectors past the end read as zeroes");
+
+    // cooked reads crossing track boundaries and the PREGAP
+    std::vector<uint8_t> data = cd.read_user_data(50, 4);
+    check(same(data, 0, user_data(0, 50, CDR_RAW_SECT_SIZE, 16)) &&
+          same(data, CDR_STD_DATA_SIZE, user_data(0, 51, CDR_RAW_SECT_SIZE, 16)),
+          "single file: Mode 1 user data before the boundary");
+    check(same(data, 2 * CDR_STD_DATA_SIZE, user_data(0, 52, CDR_RAW_SECT_SIZE, 0)) &&
+          same(data, 3 * CDR_STD_DATA_SIZE, user_data(0, 53, CDR_RAW_SECT_SIZE, 0)),
+          "single file: audio sectors after the boundary");
+
+    data = cd.read_user_data(74, 12);
+    check(same(data, 0, user_data(0, 74, CDR_RAW_SECT_SIZE, 0)) &&
+          is_zero(&data[CDR_STD_DATA_SIZE], 10 * CDR_STD_DATA_SIZE) &&
+          same(data, 11 * CDR_STD_DATA_SIZE, user_data(0, 75, CDR_RAW_SECT_SIZE, 0)),
+          "single file: read across the PREGAP");
+}
+
+/* Three files with 2048- and 2352-byte sectors. */
+static void test_multi_file() {
+    fs::path dir = test_dir();
+    write_file(dir / "t1.iso", make_sectors(1, 40, CDR_STD_DATA_SIZE));
+    write_file(dir / "t2.bin", make_sectors(2, 20, CDR_RAW_SECT_SIZE));
+    write_file(dir / "t3.bin", make_sectors(3, 30, CDR_RAW_SECT_SIZE));
+    write_file(dir / "multi.cue",
+        "FILE \"t1.iso\" BINARY\n"
+        "  TRACK 01 MODE1/2048\n"
+        "    INDEX 01 00:00:00\n"
+        "FILE t2.bin BINARY\n"
+        "  TRACK 02 MODE2/2352\n"
+        "    INDEX 01 00:00:00\n"
+        "FILE \"t3.bin\" BINARY\n"
+        "  TRACK 03 AUDIO\n"
+        "    INDEX 00 00:00:00\n"
+        "    INDEX 01 00:00:05\n");
+
+    CueTestDrive cd;
+    check(cd.load_cue_sheet((dir / "multi.cue").string()), "multiple files: CUE sheet loads");
+    check(cd.get_num_tracks() == 3, "multiple files: three tracks");
+    check(cd.start_lba(0) == 0 && cd.start_lba(1) == 40 && cd.start_lba(2) == 65,
+          "multiple files: each file continues where the previous one ended");
+    check(cd.get_size_in_blocks() == 90, "multiple files: size covers all files");
+
+    check(cd.find_track(39) == 0 && cd.find_track(40) == 1 && cd.find_track(64) == 1 &&
+          cd.find_track(65) == 2, "multiple files: track lookup");
+
+    std::vector<uint8_t> raw(2 * CDR_RAW_SECT_SIZE);
+
+    cd.read_raw_sectors(0, 39, 2, raw.data());
+    check(same(raw, 0, file_sectors(1, 39, 1, CDR_STD_DATA_SIZE)) &&
+          is_zero(&raw[CDR_STD_DATA_SIZE], CDR_STD_DATA_SIZE),
+          "multiple files: 2048-byte sectors end with their file");
+
+    cd.read_raw_sectors(2, 65, 1, raw.data());
+    check(same(raw, 0, file_sectors(3, 5, 1, CDR_RAW_SECT_SIZE)),
+          "multiple files: INDEX 01 offset within the file");
+
+    // cooked read from a 2048-byte track into a Mode 2 track
+    std::vector<uint8_t> data = cd.read_user_data(38, 4);
+    check(same(data, 0, user_data(1, 38, CDR_STD_DATA_SIZE, 0)) &&
+          same(data, CDR_STD_DATA_SIZE, user_data(1, 39, CDR_STD_DATA_SIZE, 0)),
+          "multiple files: 2048-byte sectors before the boundary");
+    check(same(data, 2 * CDR_STD_DATA_SIZE, user_data(2, 0, CDR_RAW_SECT_SIZE, 24)) &&
+          same(data, 3 * CDR_STD_DATA_SIZE, user_data(2, 1, CDR_RAW_SECT_SIZE, 24)),
+          "multiple files: Mode 2 user data after the boundary");
+}
+
+static void test_bad_cue_sheets() {
+    fs::path dir = test_dir();
+    write_file(dir / "bad.bin", make_sectors(0, 4, CDR_RAW_SECT_SIZE));
+
+    auto rejects = [&](const std::string& cue, const std::string& what) {
+        write_file(dir / "bad.cue", cue);
+        CueTestDrive cd;
+        check(!cd.load_cue_sheet((dir / "bad.cue").string()), what);
+    };
+
+    rejects("TRACK 01 MODE1/2352\nINDEX 01 00:00:00\n", "CUE sheet: TRACK before FILE is rejected");
+    rejects("FILE \"bad.bin\" BINARY\nTRACK 02 MODE1/2352\nINDEX 01 00:00:00\n",
+            "CUE sheet: tracks out of order are rejected");
+    rejects("FILE \"bad.bin\" BINARY\nTRACK 01 MODE1/2352\nINDEX 00 00:00:00\n",
+            "CUE sheet: missing INDEX 01 is rejected");
+    rejects("FILE \"bad.bin\" BINARY\nTRACK 01 MODE1/2352\nINDEX 01 00:60:00\n",
+            "CUE sheet: invalid MSF is rejected");
+    rejects("FILE \"bad.bin\" BINARY\nTRACK 01 CDG\nINDEX 01 00:00:00\n",
+            "CUE sheet: unsupported track mode is rejected");
+    rejects("FILE \"bad.bin\" WAVE\nTRACK 01 AUDIO\nINDEX 01 00:00:00\n",
+            "CUE sheet: unsupported file type is rejected");
+    rejects("FILE \"bad.bin\" BINARY\nTRACK 01 AUDIO\nINDEX 01 00:00:02\n"
+            "TRACK 02 AUDIO\nINDEX 00 00:00:01\nINDEX 01 00:00:03\n",
+            "CUE sheet: INDEX 00 before the previous INDEX 01 is rejected");
+    rejects("FILE \"missing.bin\" BINARY\nTRACK 01 MODE1/2048\nINDEX 01 00:00:00\n",
+            "CUE sheet: missing image file is rejected");
+}
+
+void test_cdrom() {
+    fs::create_directories(test_dir());
+
+    test_single_file();
+    test_multi_file();
+    test_bad_cue_sheets();
+
+    fs::remove_all(test_dir());
+}
@@ -0,0 +1,273 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file Compressed image (DPPCCMP1) and LZ4 block codec tests. */
+
+#include "devicetests.h"
+
+#include <core/memaccess.h>
+#include <utils/cmpimg.h>
+#include <utils/imgfile.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+// worst case LZ4 expansion for incompressible input
+static size_t lz4_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+static bool round_trip(const Bytes& src, const std::string& what) {
+    Bytes packed(lz4_bound(src.size()));
+    size_t packed_len = lz4_encode_block(src.data(), src.size(), packed.data(), packed.size());
+    check(packed_len != 0, what + ": encoding fits into the worst case bound");
+    if (!packed_len)
+        return false;
+
+    // exact sizes so that overreads and overruns are caught by the sanitizers
+    packed.resize(packed_len);
+    Bytes out(src.size());
+    bool ok = lz4_decode_block(packed.data(), packed.size(), out.data(), out.size());
+    check(ok && out == src, what + ": round trip");
+    return ok && out == src;
+}
+
+static Bytes encode(const Bytes& src) {
+    Bytes packed(lz4_bound(src.size()));
+    packed.resize(lz4_encode_block(src.data(), src.size(), packed.data(), packed.size()));
+    return packed;
+}
+
+static bool decodes(const Bytes& packed, size_t dst_len) {
+    Bytes out(dst_len);
+    return lz4_decode_block(packed.data(), packed.size(), out.data(), out.size());
+}
+
+static void test_lz4_round_trip() {
+    std::mt19937 rng(1234);
+
+    round_trip(Bytes(), "empty block");
+    round_trip(Bytes{0x42}, "single byte");
+    round_trip(Bytes(13, 0x55), "shortest block with a match");
+    round_trip(Bytes(65536, 0), "zeroes");
+
+    Bytes random(65536);
+    for (auto& b : random)
+        b = uint8_t(rng());
+    round_trip(random, "incompressible data");
+
+    Bytes text;
+    const std::string line = "The quick brown fox jumps over the lazy dog. ";
+    while (text.size() < 40000)
+        text.insert(text.end(), line.begin(), line.end());
+    Bytes packed = encode(text);
+    check(packed.size() < text.size() / 10, "repeated text compresses");
+    round_trip(text, "repeated text");
+
+    // long literal runs and long matches exercise the length extension bytes
+    Bytes mixed;
+    for (int i = 0; i < 8; i++) {
+        size_t lit_len = 14 + i * 137;
+        for (size_t j = 0; j < lit_len; j++)
+            mixed.push_back(uint8_t(rng()));
+        mixed.insert(mixed.end(), 3 + i * 300, uint8_t(i));
+    }
+    round_trip(mixed, "mixed literals and matches");
+
+    // matches referencing data more than 64 KB back are out of reach
+    Bytes far(200000);
+    for (size_t i = 0; i < 70000; i++)
+        far[i] = uint8_t(rng());
+    std::memcpy(&far[130000], &far[0], 70000);
+    round_trip(far, "repeat beyond the match window");
+
+    Bytes small(100);
+    check(!lz4_encode_block(random.data(), random.size(), small.data(), small.size()),
+          "encoding fails if the output doesn't fit");
+}
+
+static void test_lz4_malformed() {
+    Bytes src(300);
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = uint8_t(i % 7 + (i / 50));
+    Bytes packed = encode(src);
+
+    check(decodes(packed, src.size()), "valid block decodes");
+    check(!decodes(packed, src.size() - 1), "output larger than the buffer is rejected");
+    check(!decodes(packed, src.size() + 1), "output smaller than the buffer is rejected");
+
+    bool prefix_ok = false;
+    for (size_t len = 0; len < packed.size(); len++)
+        prefix_ok |= decodes(Bytes(packed.begin(), packed.begin() + len), src.size());
+    check(!prefix_ok, "truncated blocks are rejected");
+
+    // literals: 2, match offset 0
+    check(!decodes(Bytes{0x20, 'a', 'b', 0x00, 0x00}, 6), "zero match offset is rejected");
+    // literals: 2, match offset 3 reaches in front of the output
+    check(!decodes(Bytes{0x20, 'a', 'b', 0x03, 0x00}, 6), "match before the output is rejected");
+    // literals: 15 + 200 with only 2 actually present
+    check(!decodes(Bytes{0xF0, 200, 'a', 'b'}, 215), "literal overrun of the input is rejected");
+    // literals: 4 into a 2 byte buffer
+    check(!decodes(Bytes{0x40, 'a', 'b', 'c', 'd'}, 2), "literal overrun of the output is rejected");
+    // literals: 1, match length 4 + 15 + 255 + 10 into a 16 byte buffer
+    check(!decodes(Bytes{0x1F, 'a', 0x01, 0x00, 255, 10}, 16), "match overrun is rejected");
+    // length extension running off the end of the input
+    check(!decodes(Bytes{0xF0, 255, 255}, 1000), "unterminated length is rejected");
+
+    // arbitrary garbage must never write outside of the output buffer
+    std::mt19937 rng(5678);
+    for (int i = 0; i < 2000; i++) {
+        Bytes junk(rng() % 64);
+        for (auto& b : junk)
+            b = uint8_t(rng());
+        decodes(junk, rng() % 256);
+    }
+}
+
+static std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("dppc_cmpimg_" + name)).string();
+}
+
+static void write_file(const std::string& path, const Bytes& data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+static Bytes make_header(uint32_t chunk_size, uint32_t num_chunks, uint64_t img_size) {
+    Bytes hdr(CMP_HDR_SIZE);
+    std::memcpy(hdr.data(), CMP_MAGIC, sizeof(CMP_MAGIC));
+    WRITE_DWORD_LE_U(&hdr[8], chunk_size);
+    WRITE_DWORD_LE_U(&hdr[12], num_chunks);
+    WRITE_QWORD_LE_U(&hdr[16], img_size);
+    return hdr;
+}
+
+static void test_image_format() {
+    const uint32_t chunk_size = 4096;
+    std::mt19937 rng(42);
+
+    // compressible, all zero, incompressible and a partial last chunk
+    Bytes raw(chunk_size * 3 + 1000);
+    for (size_t i = 0; i < chunk_size; i++)
+        raw[i] = uint8_t(i / 16);
+    for (size_t i = chunk_size * 2; i < raw.size(); i++)
+        raw[i] = uint8_t(rng());
+
+    std::string raw_path = temp_path("raw.img");
+    std::string cmp_path = temp_path("image.cmp");
+    write_file(raw_path, raw);
+
+    check(compress_image(raw_path, cmp_path, chunk_size), "image compresses");
+
+    std::ifstream f(cmp_path, std::ios::binary);
+    Bytes cmp((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    check(cmp.size() > CMP_HDR_SIZE + 5 * CMP_INDEX_ENTRY_SIZE &&
+          !std::memcmp(cmp.data(), CMP_MAGIC, sizeof(CMP_MAGIC)), "compressed image has a header");
+    if (cmp.size() <= CMP_HDR_SIZE + 5 * CMP_INDEX_ENTRY_SIZE)
+        return;
+
+    const uint8_t* index = &cmp[CMP_HDR_SIZE];
+    auto chunk_len = [&](int n) {
+        return READ_QWORD_LE_U(index + (n + 1) * 8) - READ_QWORD_LE_U(index + n * 8);
+    };
+    check(READ_DWORD_LE_U(&cmp[12]) == 4, "chunk count covers the partial chunk");
+    check(chunk_len(0) > 0 && chunk_len(0) < chunk_size, "compressible chunk is packed");
+    check(chunk_len(1) == 0, "zero chunk takes no space");
+    check(chunk_len(2) == chunk_size, "incompressible chunk is stored raw");
+    check(chunk_len(3) == 1000, "partial incompressible chunk is stored raw");
+    check(READ_QWORD_LE_U(index + 4 * 8) == cmp.size(), "index ends at the end of the file");
+
+    {
+        ImgFile img;
+        check(img.open(cmp_path), "compressed image opens");
+        check(img.size() == raw.size(), "compressed image reports the raw size");
+
+        Bytes out(raw.size());
+        check(img.read(out.data(), 0, out.size()) == raw.size() && out == raw,
+              "compressed image reads back");
+
+        // a read straddling chunk boundaries
+        Bytes part(chunk_size + 200);
+        check(img.read(part.data(), chunk_size - 100, part.size()) == part.size() &&
+              !std::memcmp(part.data(), &raw[chunk_size - 100], part.size()),
+              "read across chunks");
+    }
+
+    auto rejects = [&](const Bytes& data, const std::string& what) {
+        write_file(cmp_path, data);
+        ImgFile img;
+        check(!img.open(cmp_path), what);
+    };
+
+    // the chunk count is consistent with the image size but the index can't be in the file
+    rejects(make_header(1, 0xFFFFFFFEU, 0xFFFFFFFEULL), "huge chunk count is rejected");
+
+    Bytes bad = cmp;
+    bad.resize(CMP_HDR_SIZE + 3 * CMP_INDEX_ENTRY_SIZE);
+    rejects(bad, "truncated index is rejected");
+
+    bad = cmp;
+    WRITE_QWORD_LE_U(&bad[CMP_HDR_SIZE + 4 * 8], cmp.size() + 1);
+    rejects(bad, "index past the end of the file is rejected");
+
+    bad = cmp;
+    WRITE_QWORD_LE_U(&bad[CMP_HDR_SIZE + 2 * 8], READ_QWORD_LE_U(index + 3 * 8) + 1);
+    rejects(bad, "decreasing index is rejected");
+
+    bad = cmp;
+    WRITE_QWORD_LE_U(&bad[CMP_HDR_SIZE], 0);
+    rejects(bad, "index pointing into the header is rejected");
+
+    bad = cmp;
+    WRITE_DWORD_LE_U(&bad[8], CMP_MAX_CHUNK_SIZE + 1);
+    rejects(bad, "oversized chunks are rejected");
+
+    bad = cmp;
+    WRITE_QWORD_LE_U(&bad[16], raw.size() + chunk_size);
+    rejects(bad, "chunk count not matching the size is rejected");
+
+    // a corrupt chunk fails the read instead of returning garbage
+    bad = cmp;
+    bad[READ_QWORD_LE_U(index)] ^= 0xFF;
+    write_file(cmp_path, bad);
+    {
+        ImgFile img;
+        Bytes out(chunk_size);
+        check(img.open(cmp_path) && img.read(out.data(), 0, out.size()) != out.size(),
+              "corrupt chunk fails to read");
+    }
+
+    std::filesystem::remove(raw_path);
+    std::filesystem::remove(cmp_path);
+}
+
+void test_cmpimg() {
+    test_lz4_round_trip();
+    test_lz4_malformed();
+    test_image_format();
+}
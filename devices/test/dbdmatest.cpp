@@ -0,0 +1,211 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file DBDMA descriptor chain tests. */
+
+#include "devicetests.h"
+
+#include <core/memaccess.h>
+#include <cpu/ppc/ppcemu.h>
+#include <devices/common/dbdma.h>
+#include <devices/memctrl/memctrlbase.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/** DMA device that records the scatter-gather requests it gets. */
+class SgRecorder : public DmaDevice {
+public:
+    int xfer_from_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override {
+        int total = this->record(sg, count);
+        int pos   = 0;
+        for (int i = 0; i < count && pos < total; i++) {
+            int len = std::min(int(sg[i].len), total - pos);
+            for (int j = 0; j < len; j++)
+                sg[i].buf[j] = uint8_t(this->in_pos++);
+            pos += len;
+        }
+        return total;
+    }
+
+    int xfer_to_sg(DmaChannel *ch_obj, const DmaSgEntry *sg, int count) override {
+        int total = this->record(sg, count);
+        int pos   = 0;
+        for (int i = 0; i < count && pos < total; i++) {
+            int len = std::min(int(sg[i].len), total - pos);
+            this->out_data.insert(this->out_data.end(), sg[i].buf, sg[i].buf + len);
+            pos += len;
+        }
+        return total;
+    }
+
+    int  limit       = INT_MAX; // max number of bytes to accept per call
+    int  num_calls   = 0;
+    int  num_entries = 0; // number of entries in the last call
+    int  in_pos      = 0;
+    std::vector<uint8_t> out_data;
+
+private:
+    int record(const DmaSgEntry *sg, int count) {
+        int total = 0;
+        for (int i = 0; i < count; i++)
+            total += sg[i].len;
+        this->num_calls++;
+        this->num_entries = count;
+        return std::min(total, this->limit);
+    }
+};
+
+static uint8_t* ram;
+
+constexpr uint32_t CMD_LIST  = 0x1000;
+constexpr uint32_t DATA_AREA = 0x2000;
+
+static void put_cmd(int index, uint8_t cmd, uint16_t req_count, uint32_t address) {
+    DMACmd* p = (DMACmd*)&ram[CMD_LIST + index * 16];
+    WRITE_WORD_LE_A(&p->req_count, req_count);
+    p->cmd_bits = 0;
+    p->cmd_key  = cmd << 4;
+    WRITE_DWORD_LE_A(&p->address, address);
+    WRITE_DWORD_LE_A(&p->cmd_arg, 0);
+    WRITE_WORD_LE_A(&p->res_count, 0);
+    WRITE_WORD_LE_A(&p->xfer_stat, 0);
+}
+
+static uint16_t get_res_count(int index) {
+    return READ_WORD_LE_A(&((DMACmd*)&ram[CMD_LIST + index * 16])->res_count);
+}
+
+static uint16_t get_xfer_stat(int index) {
+    return READ_WORD_LE_A(&((DMACmd*)&ram[CMD_LIST + index * 16])->xfer_stat);
+}
+
+static const uint16_t chain_lens[] = {16, 32, 64, 8};
+
+// Build INPUT/OUTPUT_MORE x 3, INPUT/OUTPUT_LAST, STOP.
+static int build_chain(uint8_t more_cmd) {
+    uint32_t addr  = DATA_AREA;
+    int      total = 0;
+
+    for (int i = 0; i < 4; i++) {
+        put_cmd(i, i < 3 ? more_cmd : more_cmd + 1, chain_lens[i], addr);
+        addr  += 0x100;
+        total += chain_lens[i];
+    }
+    put_cmd(4, DBDMA_Cmd::STOP, 0, 0);
+
+    return total;
+}
+
+static void run_channel(DMAChannel& ch) {
+    ch.reg_write(DMAReg::CMD_PTR_LO, BYTESWAP_32(CMD_LIST), 4);
+    ch.reg_write(DMAReg::CH_CTRL, BYTESWAP_32((CH_STAT_RUN << 16) | CH_STAT_RUN), 4);
+}
+
+static bool is_channel_active(DMAChannel& ch) {
+    return BYTESWAP_32(ch.reg_read(DMAReg::CH_STAT, 4)) & CH_STAT_ACTIVE;
+}
+
+// An output chain must reach the device as a single scatter-gather request.
+static void test_output_chain() {
+    SgRecorder dev;
+    DMAChannel ch("DBDMA-test-out");
+    ch.connect(&dev);
+    dev.connect(&ch);
+
+    int total = build_chain(DBDMA_Cmd::OUTPUT_MORE);
+
+    std::vector<uint8_t> expected;
+    for (int i = 0; i < 4; i++) {
+        uint8_t* buf = &ram[DATA_AREA + i * 0x100];
+        for (int j = 0; j < chain_lens[i]; j++)
+            buf[j] = uint8_t(i * 0x40 + j);
+        expected.insert(expected.end(), buf, buf + chain_lens[i]);
+    }
+
+    run_channel(ch);
+
+    check(dev.num_calls == 1, "output chain: one device call");
+    check(dev.num_entries == 4, "output chain: all descriptors in one call");
+    check(int(dev.out_data.size()) == total && dev.out_data == expected,
+          "output chain: data in descriptor order");
+    for (int i = 0; i < 4; i++) {
+        check(get_res_count(i) == 0, "output chain: resCount of command " + std::to_string(i));
+        check(get_xfer_stat(i) & CH_STAT_ACTIVE,
+              "output chain: xferStatus of command " + std::to_string(i));
+    }
+    check(!is_channel_active(ch), "output chain: channel stopped");
+}
+
+// A device serving a chain partially must leave the remainder for a retry.
+static void test_partial_input_chain() {
+    SgRecorder dev;
+    DMAChannel ch("DBDMA-test-in");
+    ch.connect(&dev);
+    dev.connect(&ch);
+
+    build_chain(DBDMA_Cmd::INPUT_MORE);
+    std::memset(&ram[DATA_AREA], 0xFF, 0x400);
+
+    dev.limit = 40; // the first command and a part of the second one
+    run_channel(ch);
+
+    check(dev.num_calls == 1 && dev.num_entries == 4, "input chain: one device call");
+    check(get_res_count(0) == 0 && (get_xfer_stat(0) & CH_STAT_ACTIVE),
+          "input chain: first command retired");
+    check(get_xfer_stat(1) == 0, "input chain: second command still pending");
+    check(is_channel_active(ch), "input chain: channel waits for more data");
+
+    dev.limit = INT_MAX;
+    ch.xfer_retry();
+
+    check(dev.num_calls == 2 && dev.num_entries == 3,
+          "input chain: remainder moved in one more call");
+    check(!is_channel_active(ch), "input chain: channel stopped");
+
+    int  pos   = 0;
+    bool match = true;
+    for (int i = 0; i < 4; i++) {
+        uint8_t* buf = &ram[DATA_AREA + i * 0x100];
+        for (int j = 0; j < chain_lens[i]; j++)
+            match &= buf[j] == uint8_t(pos++);
+        match &= buf[chain_lens[i]] == 0xFF; // nothing written past the buffer
+        check(get_res_count(i) == 0, "input chain: resCount of command " + std::to_string(i));
+    }
+    check(match, "input chain: data scattered in descriptor order");
+}
+
+void test_dbdma() {
+    MemCtrlBase mem_ctrl;
+
+    mem_ctrl.add_ram_region(0, 0x10000);
+    mem_ctrl_instance = &mem_ctrl;
+    ram = mem_ctrl.find_range(0)->mem_ptr;
+
+    test_output_chain();
+    test_partial_input_chain();
+
+    mem_ctrl_instance = nullptr;
+}
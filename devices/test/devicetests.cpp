@@ -0,0 +1,75 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file Device emulation tests. */
+
+#include "devicetests.h"
+
+#include <iostream>
+#include <loguru.hpp>
+
+using namespace std;
+
+int ntested; // number of performed checks
+int nfailed; // number of failed checks
+
+void check(bool cond, const string& what) {
+    ntested++;
+    if (!cond) {
+        cout << "FAILED: " << what << endl;
+        nfailed++;
+    }
+}
+
+int main(int argc, char** argv) {
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    loguru::init(argc, argv);
+
+    cout << "Running DingusPPC device tests..." << endl << endl;
+
+    ntested = 0;
+    nfailed = 0;
+
+    cout << "Testing DBDMA descriptor chains..." << endl;
+    test_dbdma();
+
+    cout << "Testing framebuffer row converters..." << endl;
+    test_fbconvert();
+
+    cout << "Testing ATI Rage draw engine..." << endl;
+    test_atirage();
+
+    cout << "Testing compressed disk images..." << endl;
+    test_cmpimg();
+
+    cout << "Testing IDE data port..." << endl;
+    test_ata();
+
+    cout << "Testing CD-ROM track maps..." << endl;
+    test_cdrom();
+
+    cout << "... completed." << endl;
+    cout << "--> Performed checks: " << dec << ntested << endl;
+    cout << "--> Failed: " << dec << nfailed << endl << endl;
+
+    return nfailed ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file Shared helpers for the device emulation tests. */
+
+#ifndef DEVICE_TESTS_H
+#define DEVICE_TESTS_H
+
+#include <string>
+
+extern int ntested; // number of performed checks
+extern int nfailed; // number of failed checks
+
+// Record the outcome of a single check, reporting it if it failed.
+void check(bool cond, const std::string& what);
+
+// Individual test suites
+void test_dbdma();
+void test_fbconvert();
+void test_atirage();
+void test_cmpimg();
+void test_ata();
+void test_cdrom();
+
+#endif // DEVICE_TESTS_H
@@ -0,0 +1,109 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file Framebuffer row converter tests. */
+
+#include "devicetests.h"
+
+#include <devices/video/fbconvert.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace FbConvert;
+
+constexpr uint32_t DST_GUARD = 0xDEADBEEF;
+
+// widths around the vector sizes of all converters plus a few row sizes
+static const int test_widths[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 13, 15, 16, 17, 23, 31, 32, 33, 47, 63, 64, 65,
+    127, 129, 640, 1023, 1024
+};
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t next_rnd() {
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+// run both converters on the same misaligned source, compare rows and guards
+template <typename Fn, typename... Args>
+static void compare_converters(const std::string& fmt_name, int bytes_per_pixel, Fn fast_fn,
+                               Fn ref_fn, Args... args) {
+    for (int width : test_widths) {
+        for (int src_off = 0; src_off < 4; src_off++) {
+            // the row ends exactly at the end of the allocation so that
+            // address sanitizer builds catch reads past the last pixel
+            std::vector<uint8_t> src(src_off + width * bytes_per_pixel);
+            for (auto& b : src)
+                b = uint8_t(next_rnd());
+
+            std::vector<uint32_t> fast_dst(width + 1 + 1, DST_GUARD);
+            std::vector<uint32_t> ref_dst(width + 1 + 1, DST_GUARD);
+
+            fast_fn(src.data() + src_off, &fast_dst[1], width, args...);
+            ref_fn(src.data() + src_off, &ref_dst[1], width, args...);
+
+            std::string what = fmt_name + ", width " + std::to_string(width) +
+                               ", source offset " + std::to_string(src_off);
+            check(fast_dst == ref_dst, what + ": output matches");
+            check(fast_dst[0] == DST_GUARD && fast_dst[width + 1] == DST_GUARD,
+                  what + ": nothing written outside the row");
+        }
+    }
+}
+
+static void compare_tier(const RowConverters& fast, const RowConverters& ref) {
+    std::cout << "Comparing " << fast.name << " against " << ref.name
+              << " converters" << std::endl;
+
+    uint32_t palette[256];
+    for (auto& entry : palette)
+        entry = next_rnd() | 0xFF000000U;
+
+    const std::string tier = std::string(fast.name) + " ";
+
+    compare_converters(tier + "indexed 8bpp", 1, fast.indexed_8bpp, ref.indexed_8bpp,
+                       (const uint32_t*)palette);
+    compare_converters(tier + "RGB555 BE", 2, fast.rgb555_be, ref.rgb555_be);
+    compare_converters(tier + "RGB555 LE", 2, fast.rgb555_le, ref.rgb555_le);
+    compare_converters(tier + "RGB565 BE", 2, fast.rgb565_be, ref.rgb565_be);
+    compare_converters(tier + "RGB565 LE", 2, fast.rgb565_le, ref.rgb565_le);
+    compare_converters(tier + "RGB888", 3, fast.rgb888, ref.rgb888);
+    compare_converters(tier + "ARGB8888 BE", 4, fast.argb8888_be, ref.argb8888_be);
+    compare_converters(tier + "ARGB8888 LE", 4, fast.argb8888_le, ref.argb8888_le);
+}
+
+void test_fbconvert() {
+    const RowConverters& ref = get_scalar_row_converters();
+    std::vector<RowConverters> tiers = get_supported_row_converters();
+
+    // every tier the CPU supports, not just the one picked for the display
+    for (const RowConverters& fast : tiers)
+        compare_tier(fast, ref);
+
+    check(!std::strcmp(get_row_converters().name, tiers.empty() ? ref.name : tiers.back().name),
+          "the best supported converters are in use");
+}
@@ -33,6 +33,7 @@ enum {
 
 /* Pixel format values used by the CRTC and draw engine pixel-width fields. */
 enum {
+    ATI_PIX_FMT_MONO      = 0, // draw engine only
     ATI_PIX_FMT_4BPP      = 1,
     ATI_PIX_FMT_8BPP      = 2,
     ATI_PIX_FMT_RGB555    = 3,
@@ -48,7 +49,18 @@ enum {
     ATI_DP_COLOR_SRC_HOST     = 2,
     ATI_DP_COLOR_SRC_BLIT     = 3,
     ATI_DP_MONO_SRC_ALWAYS_1  = 0,
+    ATI_DP_MONO_SRC_PATTERN   = 1,
+    ATI_DP_MONO_SRC_HOST      = 2,
+    ATI_DP_MONO_SRC_BLIT      = 3,
+    ATI_DP_MIX_DST            = 3,
     ATI_DP_MIX_SRC            = 7,
+    ATI_DP_MIX_AVERAGE        = 0x17, // (dst + src) / 2, per color component
+    ATI_CLR_CMP_FCN_FALSE     = 0, // always draw
+    ATI_CLR_CMP_FCN_TRUE      = 1, // never draw
+    ATI_CLR_CMP_FCN_NOT_EQUAL = 4, // draw if compared color == CLR_CMP_CLR
+    ATI_CLR_CMP_FCN_EQUAL     = 5, // draw if compared color != CLR_CMP_CLR
+    ATI_CLR_CMP_SRC_DST       = 0,
+    ATI_CLR_CMP_SRC_2D        = 1,
     ATI_SRC_TRAJ_UNBOUNDED    = 0,
     ATI_SRC_TRAJ_PATTERN      = 1,
     ATI_SRC_TRAJ_ROTATED      = 3,
@@ -533,6 +545,7 @@ enum {
     ATI_HOST_DATA0            = 0x080, // 0x0200
     ATI_HOST_DATA15           = 0x08F, // 0x023C
     ATI_HOST_CNTL             = 0x090, // 0x0240
+        ATI_HOST_CNTL_BYTE_ALIGN = 0,
     ATI_BM_HOSTDATA           = 0x091, // 0x0244
     ATI_BM_ADDR               = 0x092, // 0x0248
     ATI_BM_DATA               = 0x092, // 0x0248
@@ -30,6 +30,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/video/atimach64gx.h>
 #include <devices/video/displayid.h>
 #include <devices/video/rgb514defs.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <loguru.hpp>
 
 #include <string>
@@ -189,19 +190,34 @@ AtiMach64Gx::AtiMach64Gx()
     this->draw_fb_is_dynamic = true;
 }
 
-void AtiMach64Gx::change_one_bar(uint32_t &aperture, uint32_t aperture_size,
-                                 uint32_t aperture_new, int bar_num)
+void AtiMach64Gx::change_main_aperture(uint32_t aperture_new)
 {
-    if (aperture != aperture_new) {
-        if (aperture)
-            this->host_instance->pci_unregister_mmio_region(aperture, aperture_size, this);
+    if (this->aperture_base[0]) {
+        this->host_instance->pci_unregister_ram_region(this->vram_rgn);
+        this->vram_rgn = nullptr;
+        this->host_instance->pci_unregister_mmio_region(
+            this->aperture_base[0] + this->aper0_mmio_offs,
+            this->aperture_size[0] - this->aper0_mmio_offs, this);
+    }
+
+    this->aperture_base[0] = aperture_new;
 
-        aperture = aperture_new;
-        if (aperture)
-            this->host_instance->pci_register_mmio_region(aperture, aperture_size, this);
+    // the page containing the memory-mapped registers must stay MMIO
+    this->aper0_mmio_offs = std::min<uint32_t>(this->vram_size, this->mm_regs_offset) &
+                            PPC_PAGE_MASK;
 
-        LOG_F(INFO, "%s: aperture[%d] set to 0x%08X", this->name.c_str(), bar_num, aperture);
+    if (aperture_new) {
+        this->vram_rgn = this->host_instance->pci_register_ram_region(
+            aperture_new, this->aper0_mmio_offs, this->vram_ptr.get());
+        this->host_instance->pci_register_mmio_region(
+            aperture_new + this->aper0_mmio_offs,
+            this->aperture_size[0] - this->aper0_mmio_offs, this);
     }
+
+    // framebuffer writes through host memory can't be tracked individually
+    this->fb_shadow_compare = this->vram_rgn != nullptr;
+
+    mmu_phys_map_changed();
 }
 
 void AtiMach64Gx::notify_bar_change(int bar_num)
@@ -209,8 +225,13 @@ void AtiMach64Gx::notify_bar_change(int bar_num)
     if (bar_num) // only BAR0 is supported
         return;
 
-    change_one_bar(this->aperture_base[bar_num], this->aperture_size[bar_num],
-                   this->bars[bar_num] & ~15, bar_num);
+    uint32_t aperture_new = this->bars[bar_num] & ~15;
+    if (aperture_new != this->aperture_base[0]) {
+        change_main_aperture(aperture_new);
+        LOG_F(INFO, "%s: aperture[%d] set to 0x%08X", this->name.c_str(), bar_num,
+              aperture_new);
+    }
+
     // copy aperture address to CONFIG_CNTL:CFG_MEM_AP_LOC
     insert_bits<uint32_t>(this->config_cntl[0], this->aperture_base[0] >> 22,
                           ATI_CFG_MEM_AP_LOC, ATI_CFG_MEM_AP_LOC_size);
@@ -334,6 +355,7 @@ bool AtiMach64Gx::pci_io_write(uint32_t offset, uint32_t value, uint32_t size)
             LOG_F(ERROR, "%s: size + offset > 4!", this->name.c_str());
         write_mem(((uint8_t *)&this->config_cntl) + (offset & 3), value, size);
         if (offset == ATI_CONFIG_CNTL << 2) {
+            uint32_t old_regs_offset = this->mm_regs_offset;
             switch (extract_bits<uint32_t>(this->config_cntl[0], ATI_CFG_MEM_AP_SIZE, ATI_CFG_MEM_AP_SIZE_size)) {
             case 0:
                 LOG_F(WARNING, "%s: CONFIG_CNTL linear aperture disabled!", this->name.c_str());
@@ -349,6 +371,9 @@ bool AtiMach64Gx::pci_io_write(uint32_t offset, uint32_t value, uint32_t size)
             default:
                 LOG_F(ERROR, "%s: CONFIG_CNTL invalid aperture size", this->name.c_str());
             }
+            // the directly mapped VRAM window must not cover the registers
+            if (this->mm_regs_offset != old_regs_offset && this->aperture_base[0])
+                change_main_aperture(this->aperture_base[0]);
         }
 
         LOG_F(INFO, "%s: write %s %04x.%c = %0*x = %08x", this->name.c_str(),
@@ -643,6 +668,11 @@ void AtiMach64Gx::write_reg(uint32_t reg_offset, uint32_t value, uint32_t size)
 
 uint32_t AtiMach64Gx::read(uint32_t rgn_start, uint32_t offset, int size)
 {
+    if (this->aperture_base[0] && rgn_start == this->aperture_base[0] + this->aper0_mmio_offs) {
+        rgn_start  = this->aperture_base[0];
+        offset    += this->aper0_mmio_offs;
+    }
+
     if (rgn_start == this->aperture_base[0]) {
         if (offset < this->vram_size) {
             return read_mem(&this->vram_ptr[offset], size);
@@ -668,9 +698,14 @@ uint32_t AtiMach64Gx::read(uint32_t rgn_start, uint32_t offset, int size)
 
 void AtiMach64Gx::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size)
 {
+    if (this->aperture_base[0] && rgn_start == this->aperture_base[0] + this->aper0_mmio_offs) {
+        rgn_start  = this->aperture_base[0];
+        offset    += this->aper0_mmio_offs;
+    }
+
     if (rgn_start == this->aperture_base[0]) {
         if (offset < this->vram_size) {
-            draw_fb = true;
+            this->mark_fb_dirty(&this->vram_ptr[offset], size);
             return write_mem(&this->vram_ptr[offset], value, size);
         }
         if (offset >= this->mm_regs_offset && offset < this->mm_regs_offset + 0x400) {
@@ -75,7 +75,7 @@ protected:
     void get_cursor_position(int& x, int& y);
 
 private:
-    void change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new, int bar_num);
+    void change_main_aperture(uint32_t aperture_new);
     void update_interrupt();
 
     uint32_t    regs[256] = {}; // internal registers
@@ -89,6 +89,11 @@ private:
     const uint32_t aperture_flag[1] = { 0 };
     uint32_t aperture_base[1] = { 0 };
 
+    // VRAM below aper0_mmio_offs is mapped as host memory,
+    // the rest of the main aperture goes through read/write
+    AddressMapEntry* vram_rgn = nullptr;
+    uint32_t    aper0_mmio_offs = 0;
+
     uint32_t    config_cntl[2] = { 2, 0 };
     uint32_t    mm_regs_offset = MM_REGS_0_OFF;
 
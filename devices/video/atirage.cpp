@@ -27,9 +27,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/deviceregistry.h>
 #include <devices/video/atirage.h>
 #include <devices/video/displayid.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <loguru.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <map>
+#include <vector>
 
 /* Mach64 post dividers. */
 static const int mach64_post_div[8] = {
@@ -59,6 +63,172 @@ static bool mach64_clip_axis(int coord, int increment, uint32_t length,
     return true;
 }
 
+static int mach64_bytes_per_pixel(uint8_t pix_fmt) {
+    switch (pix_fmt) {
+    case ATI_PIX_FMT_8BPP:
+        return 1;
+    case ATI_PIX_FMT_RGB555:
+    case ATI_PIX_FMT_RGB565:
+        return 2;
+    case ATI_PIX_FMT_RGB888:
+        return 3;
+    case ATI_PIX_FMT_ARGB8888:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+/* Pixels are kept in VRAM in the byte order the CRTC converters expect. */
+static uint32_t mach64_read_pixel(const uint8_t* ptr, uint8_t pix_fmt) {
+    switch (pix_fmt) {
+    case ATI_PIX_FMT_8BPP:
+        return ptr[0];
+    case ATI_PIX_FMT_RGB555:
+        return READ_WORD_BE_U(ptr);
+    case ATI_PIX_FMT_RGB565:
+        return READ_WORD_LE_U(ptr);
+    case ATI_PIX_FMT_RGB888:
+        return (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
+    case ATI_PIX_FMT_ARGB8888:
+        return READ_DWORD_BE_U(ptr);
+    default:
+        return 0;
+    }
+}
+
+static void mach64_write_pixel(uint8_t* ptr, uint8_t pix_fmt, uint32_t pix) {
+    switch (pix_fmt) {
+    case ATI_PIX_FMT_8BPP:
+        ptr[0] = uint8_t(pix);
+        break;
+    case ATI_PIX_FMT_RGB555:
+        WRITE_WORD_BE_U(ptr, pix);
+        break;
+    case ATI_PIX_FMT_RGB565:
+        WRITE_WORD_LE_U(ptr, pix);
+        break;
+    case ATI_PIX_FMT_RGB888:
+        ptr[0] = uint8_t(pix >> 16);
+        ptr[1] = uint8_t(pix >> 8);
+        ptr[2] = uint8_t(pix);
+        break;
+    case ATI_PIX_FMT_ARGB8888:
+        WRITE_DWORD_BE_U(ptr, pix);
+        break;
+    }
+}
+
+/* Mix a source pixel into a destination pixel according to DP_FRGD_MIX or
+   DP_BKGD_MIX. Reserved mix functions leave the destination unchanged. */
+static uint32_t mach64_mix(uint8_t mix, uint32_t dst, uint32_t src, uint8_t pix_fmt) {
+    switch (mix) {
+    case 0x00: return ~dst;
+    case 0x01: return 0;
+    case 0x02: return ~0U;
+    case 0x03: return dst;
+    case 0x04: return ~src;
+    case 0x05: return dst ^ src;
+    case 0x06: return ~dst ^ src;
+    case 0x07: return src;
+    case 0x08: return ~dst | ~src;
+    case 0x09: return dst | ~src;
+    case 0x0A: return ~dst | src;
+    case 0x0B: return dst | src;
+    case 0x0C: return dst & src;
+    case 0x0D: return ~dst & src;
+    case 0x0E: return dst & ~src;
+    case 0x0F: return ~dst & ~src;
+    case ATI_DP_MIX_AVERAGE: {
+        // clear the LSB of each color component so that halving
+        // the sum doesn't carry into the neighbouring component
+        uint32_t comp_lsbs;
+        switch (pix_fmt) {
+        case ATI_PIX_FMT_RGB555:
+            comp_lsbs = 0x8421; // bit 15 isn't part of any component
+            break;
+        case ATI_PIX_FMT_RGB565:
+            comp_lsbs = 0x0821;
+            break;
+        default:
+            comp_lsbs = 0x01010101;
+            break;
+        }
+        return (dst & src) + (((dst ^ src) & ~comp_lsbs) >> 1);
+    }
+    default:
+        return dst;
+    }
+}
+
+/* Apply a bitwise mix function (0x00...0x0F) to a row of bytes. Bitwise mixes
+   don't care about pixel boundaries so rows of any pixel depth can be processed
+   as plain byte arrays, which the compiler turns into SIMD code. */
+template <typename MixFn>
+static void mach64_mix_row(uint8_t* dst, const uint8_t* src, const uint8_t* mask,
+                           size_t len, MixFn mix_fn) {
+    if (mask) {
+        for (size_t i = 0; i < len; i++)
+            dst[i] = (dst[i] & ~mask[i]) | (mix_fn(dst[i], src[i]) & mask[i]);
+    } else {
+        for (size_t i = 0; i < len; i++)
+            dst[i] = mix_fn(dst[i], src[i]);
+    }
+}
+
+static void mach64_rop_row(uint8_t* dst, const uint8_t* src, const uint8_t* mask,
+                           size_t len, uint8_t mix) {
+    if (mix == ATI_DP_MIX_SRC && !mask) {
+        std::memmove(dst, src, len);
+        return;
+    }
+
+    switch (mix) {
+    case 0x00: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t  ) { return uint8_t(~d); }); break;
+    case 0x01: mach64_mix_row(dst, src, mask, len, [](uint8_t  , uint8_t  ) { return uint8_t(0); }); break;
+    case 0x02: mach64_mix_row(dst, src, mask, len, [](uint8_t  , uint8_t  ) { return uint8_t(0xFF); }); break;
+    case 0x03: break;
+    case 0x04: mach64_mix_row(dst, src, mask, len, [](uint8_t  , uint8_t s) { return uint8_t(~s); }); break;
+    case 0x05: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(d ^ s); }); break;
+    case 0x06: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(~d ^ s); }); break;
+    case 0x07: mach64_mix_row(dst, src, mask, len, [](uint8_t  , uint8_t s) { return s; }); break;
+    case 0x08: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(~d | ~s); }); break;
+    case 0x09: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(d | ~s); }); break;
+    case 0x0A: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(~d | s); }); break;
+    case 0x0B: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(d | s); }); break;
+    case 0x0C: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(d & s); }); break;
+    case 0x0D: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(~d & s); }); break;
+    case 0x0E: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(d & ~s); }); break;
+    case 0x0F: mach64_mix_row(dst, src, mask, len, [](uint8_t d, uint8_t s) { return uint8_t(~d & ~s); }); break;
+    }
+}
+
+/* Returns true if the color comparator inhibits writing a pixel. */
+static bool mach64_cmp_inhibits(uint8_t cmp_fcn, uint32_t color, uint32_t cmp_clr,
+                                uint32_t cmp_msk) {
+    switch (cmp_fcn) {
+    case ATI_CLR_CMP_FCN_TRUE:
+        return true;
+    case ATI_CLR_CMP_FCN_NOT_EQUAL:
+        return (color & cmp_msk) != (cmp_clr & cmp_msk);
+    case ATI_CLR_CMP_FCN_EQUAL:
+        return (color & cmp_msk) == (cmp_clr & cmp_msk);
+    default:
+        return false;
+    }
+}
+
+/* Fill a row buffer with num_pixels copies of a pixel. */
+static void mach64_fill_row_buf(std::vector<uint8_t>& buf, uint8_t pix_fmt, int bpp,
+                                uint32_t pix, uint32_t num_pixels) {
+    buf.resize(size_t(num_pixels) * bpp);
+    mach64_write_pixel(buf.data(), pix_fmt, pix);
+
+    // keep doubling the filled part until the whole row is covered
+    for (size_t filled = bpp; filled < buf.size(); filled *= 2)
+        std::memcpy(&buf[filled], buf.data(), std::min(filled, buf.size() - filled));
+}
+
 /* Human readable Mach64 HW register names for easier debugging. */
 static const std::map<uint16_t, std::string> mach64_reg_names = {
     #define one_reg_name(x) {ATI_ ## x, #x}
@@ -120,6 +290,9 @@ ATIRage::ATIRage(uint16_t dev_id)
     this->vram_size = GET_INT_PROP("gfxmem_size") << 20; // convert MBs to bytes
     this->framebuffer_size = std::min(this->vram_size, ((uint32_t)8 << 20) - 0x800);
 
+    // the page containing the memory-mapped registers must stay MMIO
+    this->aper0_mmio_offs = this->framebuffer_size & PPC_PAGE_MASK;
+
     // allocate video RAM
     this->vram_ptr = std::unique_ptr<uint8_t[]> (new uint8_t[this->vram_size]);
 
@@ -187,13 +360,50 @@ void ATIRage::change_one_bar(uint32_t &aperture, uint32_t aperture_size,
     }
 }
 
+void ATIRage::change_main_aperture(uint32_t aperture_new) {
+    if (this->aperture_base[0] == aperture_new)
+        return;
+
+    uint32_t mmio_size = BE_FB_OFFSET - this->aper0_mmio_offs;
+    uint32_t be_size   = std::min(this->aperture_size[0] - 4096,
+                                  BE_FB_OFFSET + this->vram_size) - BE_FB_OFFSET;
+
+    if (this->aperture_base[0]) {
+        this->host_instance->pci_unregister_ram_region(this->vram_le_rgn);
+        this->host_instance->pci_unregister_mmio_region(
+            this->aperture_base[0] + this->aper0_mmio_offs, mmio_size, this);
+        this->host_instance->pci_unregister_ram_region(this->vram_be_rgn);
+        this->vram_le_rgn = nullptr;
+        this->vram_be_rgn = nullptr;
+    }
+
+    this->aperture_base[0] = aperture_new;
+
+    if (aperture_new) {
+        // VRAM is kept in guest byte order so both framebuffer windows are
+        // plain views of it and can be accessed by the CPU without going
+        // through read/write.
+        this->vram_le_rgn = this->host_instance->pci_register_ram_region(
+            aperture_new, this->aper0_mmio_offs, this->vram_ptr.get());
+        this->host_instance->pci_register_mmio_region(
+            aperture_new + this->aper0_mmio_offs, mmio_size, this);
+        this->vram_be_rgn = this->host_instance->pci_register_ram_region(
+            aperture_new + BE_FB_OFFSET, be_size, this->vram_ptr.get());
+    }
+
+    // framebuffer writes through host memory can't be tracked individually
+    this->fb_shadow_compare = this->vram_le_rgn || this->vram_be_rgn;
+
+    mmu_phys_map_changed();
+
+    LOG_F(INFO, "%s: aperture[0] set to 0x%08X", this->name.c_str(), aperture_new);
+}
+
 void ATIRage::notify_bar_change(int bar_num)
 {
     switch (bar_num) {
     case 0:
-        change_one_bar(this->aperture_base[bar_num],
-                       std::min(this->aperture_size[bar_num] - 4096, BE_FB_OFFSET + this->vram_size),
-                       this->bars[bar_num] & ~15, bar_num);
+        change_main_aperture(this->bars[bar_num] & ~15);
         break;
     case 2:
         change_one_bar(this->aperture_base[bar_num],
@@ -692,6 +902,11 @@ bool ATIRage::pci_io_write(uint32_t offset, uint32_t value, uint32_t size) {
 
 uint32_t ATIRage::read(uint32_t rgn_start, uint32_t offset, int size)
 {
+    if (this->aperture_base[0] && rgn_start == this->aperture_base[0] + this->aper0_mmio_offs) {
+        rgn_start  = this->aperture_base[0];
+        offset    += this->aper0_mmio_offs;
+    }
+
     if (rgn_start == this->aperture_base[0] && offset < this->aperture_size[0]) {
         if (offset < this->framebuffer_size) { // little-endian VRAM region
             return read_mem(&this->vram_ptr[offset], size);
@@ -743,13 +958,18 @@ uint32_t ATIRage::read(uint32_t rgn_start, uint32_t offset, int size)
 
 void ATIRage::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size)
 {
+    if (this->aperture_base[0] && rgn_start == this->aperture_base[0] + this->aper0_mmio_offs) {
+        rgn_start  = this->aperture_base[0];
+        offset    += this->aper0_mmio_offs;
+    }
+
     if (rgn_start == this->aperture_base[0] && offset < this->aperture_size[0]) {
         if (offset < this->framebuffer_size) { // little-endian VRAM region
-            draw_fb = true;
+            this->mark_fb_dirty(&this->vram_ptr[offset], size);
             return write_mem(&this->vram_ptr[offset], value, size);
         }
         if (offset >= BE_FB_OFFSET) { // big-endian VRAM region
-            draw_fb = true;
+            this->mark_fb_dirty(&this->vram_ptr[offset & (BE_FB_OFFSET - 1)], size);
             return write_mem(&this->vram_ptr[offset & (BE_FB_OFFSET - 1)], value, size);
         }
         //if (!bit_set(this->regs[ATI_BUS_CNTL], ATI_BUS_APER_REG_DIS)) {
@@ -1115,10 +1335,6 @@ void ATIRage::begin_drawing(uint32_t initiator, uint32_t value) {
 }
 
 void ATIRage::draw_rect(uint32_t width, uint32_t height) {
-    uint8_t frgd_src = extract_bits<uint32_t>(
-        this->regs[ATI_DP_SRC], ATI_DP_FRGD_SRC, ATI_DP_FRGD_SRC_size);
-    uint8_t mono_src = extract_bits<uint32_t>(
-        this->regs[ATI_DP_SRC], ATI_DP_MONO_SRC, ATI_DP_MONO_SRC_size);
     uint32_t src_cntl = this->regs[ATI_SRC_CNTL];
 
     this->host_data_active = false;
@@ -1130,25 +1346,21 @@ void ATIRage::draw_rect(uint32_t width, uint32_t height) {
         return;
     }
 
-    if ((frgd_src == ATI_DP_COLOR_SRC_BKGD_CLR || frgd_src == ATI_DP_COLOR_SRC_FRGD_CLR) &&
-        mono_src == ATI_DP_MONO_SRC_ALWAYS_1) {
-        uint32_t color = frgd_src == ATI_DP_COLOR_SRC_BKGD_CLR ? this->regs[ATI_DP_BKGD_CLR]
-                                                               : this->regs[ATI_DP_FRGD_CLR];
-        this->fill_rect(width, height, color);
-        this->finish_rect(width, height);
-    } else if (frgd_src == ATI_DP_COLOR_SRC_HOST &&
-               mono_src == ATI_DP_MONO_SRC_ALWAYS_1) {
+    if (!this->setup_draw_op(width, height))
+        return;
+
+    const auto& op = this->draw_op;
+
+    if (op.mono_src == ATI_DP_MONO_SRC_HOST || op.frgd_src == ATI_DP_COLOR_SRC_HOST ||
+        (op.mono_src != ATI_DP_MONO_SRC_ALWAYS_1 && op.bkgd_src == ATI_DP_COLOR_SRC_HOST)) {
         this->start_host_rect(width, height);
-    } else if (frgd_src == ATI_DP_COLOR_SRC_BLIT &&
-               mono_src == ATI_DP_MONO_SRC_ALWAYS_1) {
-        this->blit_rect(width, height);
-        this->finish_rect(width, height);
-    } else {
-        LOG_F(WARNING, "%s: unimplemented rectangle draw op, DP_SRC=0x%08X, DP_MIX=0x%08X, "
-              "DP_PIX_WIDTH=0x%08X, SRC_CNTL=0x%08X", this->name.c_str(),
-              this->regs[ATI_DP_SRC], this->regs[ATI_DP_MIX], this->regs[ATI_DP_PIX_WIDTH],
-              this->regs[ATI_SRC_CNTL]);
+        return;
     }
+
+    if (!this->fill_rect() && !this->blit_rect())
+        this->draw_pixels();
+
+    this->finish_rect(width, height);
 }
 
 void ATIRage::finish_rect(uint32_t width, uint32_t height) {
@@ -1167,342 +1379,455 @@ void ATIRage::finish_rect(uint32_t width, uint32_t height) {
     }
 }
 
-void ATIRage::fill_rect(uint32_t dst_width, uint32_t dst_height, uint32_t color) {
-    uint8_t frgd_mix = extract_bits<uint32_t>(this->regs[ATI_DP_MIX], ATI_DP_FRGD_MIX,
-                                              ATI_DP_FRGD_MIX_size);
-
-    if (frgd_mix != ATI_DP_MIX_SRC) {
-        LOG_F(WARNING, "%s: unimplemented rectangle fill op, DP_FRGD_MIX=0x%X",
-              this->name.c_str(), frgd_mix);
-        return;
+/* Latch the draw engine registers for the rectangle about to be drawn.
+   Returns false if the requested operation isn't supported. */
+bool ATIRage::setup_draw_op(uint32_t width, uint32_t height) {
+    auto& op = this->draw_op;
+
+    uint32_t pix_width = this->regs[ATI_DP_PIX_WIDTH];
+
+    op.frgd_src = extract_bits<uint32_t>(this->regs[ATI_DP_SRC], ATI_DP_FRGD_SRC,
+                                         ATI_DP_FRGD_SRC_size);
+    op.bkgd_src = extract_bits<uint32_t>(this->regs[ATI_DP_SRC], ATI_DP_BKGD_SRC,
+                                         ATI_DP_BKGD_SRC_size);
+    op.mono_src = extract_bits<uint32_t>(this->regs[ATI_DP_SRC], ATI_DP_MONO_SRC,
+                                         ATI_DP_MONO_SRC_size);
+    op.frgd_mix = extract_bits<uint32_t>(this->regs[ATI_DP_MIX], ATI_DP_FRGD_MIX,
+                                         ATI_DP_FRGD_MIX_size);
+    op.bkgd_mix = extract_bits<uint32_t>(this->regs[ATI_DP_MIX], ATI_DP_BKGD_MIX,
+                                         ATI_DP_BKGD_MIX_size);
+    op.dst_fmt  = extract_bits<uint32_t>(pix_width, ATI_DP_DST_PIX_WIDTH,
+                                         ATI_DP_DST_PIX_WIDTH_size);
+    op.src_fmt  = extract_bits<uint32_t>(pix_width, ATI_DP_SRC_PIX_WIDTH,
+                                         ATI_DP_SRC_PIX_WIDTH_size);
+    op.host_fmt = extract_bits<uint32_t>(pix_width, ATI_DP_HOST_PIX_WIDTH,
+                                         ATI_DP_HOST_PIX_WIDTH_size);
+    op.dst_bpp   = mach64_bytes_per_pixel(op.dst_fmt);
+    op.host_bpp  = mach64_bytes_per_pixel(op.host_fmt);
+    op.lsb_first = bit_set(pix_width, ATI_DP_BYTE_PIX_ORDER);
+
+    op.frgd_clr   = this->regs[ATI_DP_FRGD_CLR];
+    op.bkgd_clr   = this->regs[ATI_DP_BKGD_CLR];
+    op.write_mask = this->regs[ATI_DP_WRITE_MSK];
+    op.cmp_fcn    = extract_bits<uint32_t>(this->regs[ATI_CLR_CMP_CNTL], ATI_CLR_CMP_FCN,
+                                           ATI_CLR_CMP_FCN_size);
+    op.cmp_src    = extract_bits<uint32_t>(this->regs[ATI_CLR_CMP_CNTL], ATI_CLR_CMP_SRC,
+                                           ATI_CLR_CMP_SRC_size);
+    op.cmp_clr    = this->regs[ATI_CLR_CMP_CLR];
+    op.cmp_msk    = this->regs[ATI_CLR_CMP_MSK];
+    op.src_cntl   = this->regs[ATI_SRC_CNTL];
+    op.host_byte_align = bit_set(this->regs[ATI_HOST_CNTL], ATI_HOST_CNTL_BYTE_ALIGN);
+
+    // the background source is only used when the monochrome source can be 0
+    bool uses_bkgd  = op.mono_src != ATI_DP_MONO_SRC_ALWAYS_1;
+    bool color_host = op.frgd_src == ATI_DP_COLOR_SRC_HOST ||
+                      (uses_bkgd && op.bkgd_src == ATI_DP_COLOR_SRC_HOST);
+    bool color_blit = op.frgd_src == ATI_DP_COLOR_SRC_BLIT ||
+                      (uses_bkgd && op.bkgd_src == ATI_DP_COLOR_SRC_BLIT);
+    op.uses_blit    = color_blit || op.mono_src == ATI_DP_MONO_SRC_BLIT;
+
+    bool supported = op.dst_bpp && op.frgd_src <= ATI_DP_COLOR_SRC_BLIT &&
+        (!uses_bkgd || op.bkgd_src <= ATI_DP_COLOR_SRC_BLIT) &&
+        !(color_host && op.mono_src == ATI_DP_MONO_SRC_HOST) &&
+        !(color_blit && op.mono_src == ATI_DP_MONO_SRC_BLIT) &&
+        (!color_host || op.host_fmt == op.dst_fmt) &&
+        (!color_blit || op.src_fmt == op.dst_fmt) &&
+        (!op.uses_blit || op.src_cntl == ATI_SRC_TRAJ_UNBOUNDED ||
+         op.src_cntl == ATI_SRC_TRAJ_PATTERN || op.src_cntl == ATI_SRC_TRAJ_ROTATED);
+
+    if (!supported) {
+        LOG_F(WARNING, "%s: unsupported draw engine operation, DP_SRC=0x%08X, DP_MIX=0x%08X, "
+              "DP_PIX_WIDTH=0x%08X, SRC_CNTL=0x%08X", this->name.c_str(),
+              this->regs[ATI_DP_SRC], this->regs[ATI_DP_MIX], this->regs[ATI_DP_PIX_WIDTH],
+              this->regs[ATI_SRC_CNTL]);
+        return false;
     }
 
-    if (this->regs[ATI_CLR_CMP_CNTL]) {
-        LOG_F(WARNING, "%s: color comparator not implemented yet, CLR_CMP_CNTL=0x%X", this->name.c_str(),
-              this->regs[ATI_CLR_CMP_CNTL]);
-        return;
+    auto mix_reserved = [](uint8_t mix) { return mix > 0x0F && mix != ATI_DP_MIX_AVERAGE; };
+    if (mix_reserved(op.frgd_mix) || (uses_bkgd && mix_reserved(op.bkgd_mix))) {
+        LOG_F(WARNING, "%s: reserved mix function, DP_MIX=0x%08X", this->name.c_str(),
+              this->regs[ATI_DP_MIX]);
     }
 
-    // check pixel formats
-    uint8_t src_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_SRC_PIX_WIDTH,
-                                                 ATI_DP_SRC_PIX_WIDTH_size);
-    uint8_t dst_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_DST_PIX_WIDTH,
-                                                 ATI_DP_DST_PIX_WIDTH_size);
+    if (op.cmp_fcn != ATI_CLR_CMP_FCN_FALSE && op.cmp_src > ATI_CLR_CMP_SRC_2D) {
+        LOG_F(WARNING, "%s: texel color compare not supported, CLR_CMP_CNTL=0x%08X",
+              this->name.c_str(), this->regs[ATI_CLR_CMP_CNTL]);
+        op.cmp_src = ATI_CLR_CMP_SRC_DST;
+    }
 
-    if (dst_pix_fmt != src_pix_fmt) {
-        LOG_F(WARNING, "%s: unsupported pixel format conversion, DP_SRC_PIX_WIDTH=0x%X, DP_DST_PIX_WIDTH=0x%X",
-              this->name.c_str(), src_pix_fmt, dst_pix_fmt);
-        return;
+    // grab destination trajectory params
+    op.dst_offs  = extract_bits<uint32_t>(this->regs[ATI_DST_OFF_PITCH], ATI_DST_OFFSET,
+                                          ATI_DST_OFFSET_size) * 8;
+    op.dst_pitch = extract_bits<uint32_t>(this->regs[ATI_DST_OFF_PITCH], ATI_DST_PITCH,
+                                          ATI_DST_PITCH_size) * 8 * op.dst_bpp;
+    op.dst_x     = mach64_extract_signed(this->regs[ATI_DST_X], ATI_DST_X_pos, ATI_DST_X_size);
+    op.dst_y     = mach64_extract_signed(this->regs[ATI_DST_Y], ATI_DST_Y_pos, ATI_DST_Y_size);
+    op.x_inc     = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_X_DIR) ? 1 : -1;
+    op.y_inc     = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_Y_DIR) ? 1 : -1;
+
+    op.sc_left   = mach64_extract_signed(this->regs[ATI_SC_LEFT], ATI_SC_LEFT_pos,
+                                         ATI_SC_LEFT_size);
+    op.sc_right  = mach64_extract_signed(this->regs[ATI_SC_RIGHT], ATI_SC_RIGHT_pos,
+                                         ATI_SC_RIGHT_size);
+    op.sc_top    = mach64_extract_signed(this->regs[ATI_SC_TOP], ATI_SC_TOP_pos,
+                                         ATI_SC_TOP_size);
+    op.sc_bottom = mach64_extract_signed(this->regs[ATI_SC_BOTTOM], ATI_SC_BOTTOM_pos,
+                                         ATI_SC_BOTTOM_size);
+
+    if (op.uses_blit) {
+        op.src_offs    = extract_bits<uint32_t>(this->regs[ATI_SRC_OFF_PITCH], ATI_SRC_OFFSET,
+                                                ATI_SRC_OFFSET_size) * 8;
+        op.src_pitch   = extract_bits<uint32_t>(this->regs[ATI_SRC_OFF_PITCH], ATI_SRC_PITCH,
+                                                ATI_SRC_PITCH_size) * 8;
+        op.src_x       = mach64_extract_signed(this->regs[ATI_SRC_X], ATI_SRC_X_pos,
+                                               ATI_SRC_X_size);
+        op.src_y       = mach64_extract_signed(this->regs[ATI_SRC_Y], ATI_SRC_Y_pos,
+                                               ATI_SRC_Y_size);
+        op.src_x_start = mach64_extract_signed(this->regs[ATI_SRC_X_START], ATI_SRC_X_START_pos,
+                                               ATI_SRC_X_START_size);
+        op.src_y_start = mach64_extract_signed(this->regs[ATI_SRC_Y_START], ATI_SRC_Y_START_pos,
+                                               ATI_SRC_Y_START_size);
+        op.src_width1  = extract_bits<uint32_t>(this->regs[ATI_SRC_WIDTH1], ATI_SRC_WIDTH1_pos,
+                                                ATI_SRC_WIDTH1_size);
+        op.src_height1 = extract_bits<uint32_t>(this->regs[ATI_SRC_HEIGHT1], ATI_SRC_HEIGHT1_pos,
+                                                ATI_SRC_HEIGHT1_size);
+        op.src_width2  = extract_bits<uint32_t>(this->regs[ATI_SRC_WIDTH2], ATI_SRC_WIDTH2_pos,
+                                                ATI_SRC_WIDTH2_size);
+        op.src_height2 = extract_bits<uint32_t>(this->regs[ATI_SRC_HEIGHT2], ATI_SRC_HEIGHT2_pos,
+                                                ATI_SRC_HEIGHT2_size);
+
+        if ((op.src_cntl == ATI_SRC_TRAJ_PATTERN && (!op.src_width1 || !op.src_height1)) ||
+            (op.src_cntl == ATI_SRC_TRAJ_ROTATED &&
+             (!op.src_width1 || !op.src_height1 || !op.src_width2 || !op.src_height2))) {
+            LOG_F(WARNING, "%s: invalid rectangle blit source trajectory, SRC_CNTL=0x%08X, "
+                  "SRC_HEIGHT1_WIDTH1=0x%08X, SRC_HEIGHT2_WIDTH2=0x%08X", this->name.c_str(),
+                  op.src_cntl, this->regs[ATI_SRC_HEIGHT1_WIDTH1],
+                  this->regs[ATI_SRC_HEIGHT2_WIDTH2]);
+            return false;
+        }
     }
 
-    int bytes_per_pixel;
-    switch (dst_pix_fmt) {
-        case ATI_PIX_FMT_8BPP:
-        bytes_per_pixel = 1;
-        break;
-    case ATI_PIX_FMT_RGB555:
-    case ATI_PIX_FMT_RGB565:
-        bytes_per_pixel = 2;
-        break;
-    case ATI_PIX_FMT_RGB888:
-        bytes_per_pixel = 3;
-        break;
-    case ATI_PIX_FMT_ARGB8888:
-        bytes_per_pixel = 4;
-        break;
-    default:
-        LOG_F(WARNING, "%s: unsupported rectangle fill pixel format, DP_DST_PIX_WIDTH=0x%X",
-              this->name.c_str(), dst_pix_fmt);
-        return;
+    // determine the part of the rectangle inside the scissors
+    int x_skip, y_skip;
+    if (mach64_clip_axis(op.dst_x, op.x_inc, width, op.sc_left, op.sc_right, x_skip,
+                         op.num_cols) &&
+        mach64_clip_axis(op.dst_y, op.y_inc, height, op.sc_top, op.sc_bottom, y_skip,
+                         op.num_rows)) {
+        op.first_col = x_skip;
+        op.first_row = y_skip;
+    } else {
+        op.num_cols = op.num_rows = 0;
     }
 
-    // grab trajectory params
-    int dst_offs   = extract_bits<uint32_t>(this->regs[ATI_DST_OFF_PITCH], ATI_DST_OFFSET, ATI_DST_OFFSET_size);
-    int dst_pitch  = extract_bits<uint32_t>(this->regs[ATI_DST_OFF_PITCH], ATI_DST_PITCH, ATI_DST_PITCH_size);
-    int dst_x      = mach64_extract_signed(this->regs[ATI_DST_X], ATI_DST_X_pos, ATI_DST_X_size);
-    int dst_y      = mach64_extract_signed(this->regs[ATI_DST_Y], ATI_DST_Y_pos, ATI_DST_Y_size);
+    return true;
+}
+
+/* Fast path for solid fills using a bitwise mix function. */
+bool ATIRage::fill_rect() {
+    const auto& op = this->draw_op;
 
-    dst_offs  *= 8;
-    dst_pitch *= 8 * bytes_per_pixel;
+    if (op.mono_src != ATI_DP_MONO_SRC_ALWAYS_1 || op.frgd_src > ATI_DP_COLOR_SRC_FRGD_CLR ||
+        op.frgd_mix > 0x0F || op.cmp_fcn != ATI_CLR_CMP_FCN_FALSE)
+        return false;
 
-    int x_inc = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_X_DIR) ? 1 : -1;
-    int y_inc = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_Y_DIR) ? 1 : -1;
+    if (!op.num_cols || !op.num_rows)
+        return true;
 
-    int sc_left = mach64_extract_signed(this->regs[ATI_SC_LEFT], ATI_SC_LEFT_pos, ATI_SC_LEFT_size);
-    int sc_right = mach64_extract_signed(
-        this->regs[ATI_SC_RIGHT], ATI_SC_RIGHT_pos, ATI_SC_RIGHT_size);
-    int sc_top    = mach64_extract_signed(this->regs[ATI_SC_TOP], ATI_SC_TOP_pos, ATI_SC_TOP_size);
-    int sc_bottom = mach64_extract_signed(
-        this->regs[ATI_SC_BOTTOM], ATI_SC_BOTTOM_pos, ATI_SC_BOTTOM_size);
+    uint32_t color = op.frgd_src == ATI_DP_COLOR_SRC_BKGD_CLR ? op.bkgd_clr : op.frgd_clr;
+    size_t   len   = size_t(op.num_cols) * op.dst_bpp;
 
-    int x_skip, y_skip;
-    if (!mach64_clip_axis(dst_x, x_inc, dst_width, sc_left, sc_right, x_skip, dst_width) ||
-        !mach64_clip_axis(dst_y, y_inc, dst_height, sc_top, sc_bottom, y_skip, dst_height)) {
-        return;
+    mach64_fill_row_buf(this->rop_src_row, op.dst_fmt, op.dst_bpp, color, op.num_cols);
+    const uint8_t* mask = this->prepare_mask_row();
+
+    for (uint32_t row = op.first_row; row < op.first_row + op.num_rows; row++) {
+        uint8_t* dst = this->get_dst_span(row, len);
+        if (dst)
+            mach64_rop_row(dst, this->rop_src_row.data(), mask, len, op.frgd_mix);
     }
-    dst_x += x_skip * x_inc;
-    dst_y += y_skip * y_inc;
 
-    uint32_t pix = color & this->regs[ATI_DP_WRITE_MSK];
+    this->mark_rows_dirty(op.first_row, op.first_row + op.num_rows - 1);
+    return true;
+}
 
-    switch (dst_pix_fmt) {
-    case ATI_PIX_FMT_8BPP:
-        for (uint32_t y = 0; y < dst_height; y++) {
-            uint8_t* row = &this->vram_ptr[dst_offs + (dst_y + int(y) * y_inc) * dst_pitch];
-            for (int x = dst_x, width = dst_width; width-- > 0; x += x_inc) {
-                row[x] = uint8_t(pix);
-            }
-        }
-        break;
-    case ATI_PIX_FMT_RGB555:
-        pix = BYTESWAP_16(pix);
-        for (uint32_t y = 0; y < dst_height; y++) {
-            uint16_t* row = (uint16_t*)&this->vram_ptr[dst_offs + (dst_y + int(y) * y_inc) * dst_pitch];
-            for (int x = dst_x, width = dst_width; width-- > 0; x += x_inc) {
-                row[x] = pix;
-            }
-        }
-        break;
-    case ATI_PIX_FMT_RGB565:
-        pix &= 0xFFFF;
-        for (uint32_t y = 0; y < dst_height; y++) {
-            uint16_t* row = (uint16_t*)&this->vram_ptr[dst_offs + (dst_y + int(y) * y_inc) * dst_pitch];
-            for (int x = dst_x, width = dst_width; width-- > 0; x += x_inc) {
-                row[x] = pix;
-            }
-        }
-        break;
-    case ATI_PIX_FMT_RGB888:
-        for (uint32_t y = 0; y < dst_height; y++) {
-            uint8_t* row = &this->vram_ptr[dst_offs + (dst_y + int(y) * y_inc) * dst_pitch];
-            for (int x = dst_x, width = dst_width; width-- > 0; x += x_inc) {
-                uint8_t* dst_ptr = row + x * 3;
-                dst_ptr[0] = uint8_t(pix >> 16);
-                dst_ptr[1] = uint8_t(pix >> 8);
-                dst_ptr[2] = uint8_t(pix);
-            }
-        }
-        break;
-    case ATI_PIX_FMT_ARGB8888:
-        pix = BYTESWAP_32(pix);
-        for (uint32_t y = 0; y < dst_height; y++) {
-            uint32_t* row = (uint32_t*)&this->vram_ptr[dst_offs + (dst_y + int(y) * y_inc) * dst_pitch];
-            for (int x = dst_x, width = dst_width; width-- > 0; x += x_inc) {
-                row[x] = pix;
-            }
+/* Fast path for screen-to-screen copies using a bitwise mix function. */
+bool ATIRage::blit_rect() {
+    const auto& op = this->draw_op;
+
+    if (op.mono_src != ATI_DP_MONO_SRC_ALWAYS_1 || op.frgd_src != ATI_DP_COLOR_SRC_BLIT ||
+        op.src_cntl != ATI_SRC_TRAJ_UNBOUNDED || op.frgd_mix > 0x0F ||
+        op.cmp_fcn != ATI_CLR_CMP_FCN_FALSE)
+        return false;
+
+    if (!op.num_cols || !op.num_rows)
+        return true;
+
+    size_t len = size_t(op.num_cols) * op.dst_bpp;
+    const uint8_t* mask = this->prepare_mask_row();
+
+    this->rop_src_row.resize(len);
+
+    int sx = op.src_x + int(op.first_col) * op.x_inc;
+    if (op.x_inc < 0)
+        sx -= op.num_cols - 1;
+
+    for (uint32_t row = op.first_row; row < op.first_row + op.num_rows; row++) {
+        uint8_t* dst = this->get_dst_span(row, len);
+        if (!dst)
+            continue;
+
+        int sy = op.src_y + int(row) * op.y_inc;
+        int64_t src_offs = int64_t(op.src_offs) + int64_t(sy) * op.src_pitch * op.dst_bpp +
+                           int64_t(sx) * op.dst_bpp;
+        if (src_offs < 0 || src_offs + int64_t(len) > this->vram_size)
+            continue;
+
+        const uint8_t* src = &this->vram_ptr[src_offs];
+
+        // mixing reads the destination so the source must be kept intact
+        if ((op.frgd_mix != ATI_DP_MIX_SRC || mask) && src < dst + len && dst < src + len) {
+            std::memcpy(this->rop_src_row.data(), src, len);
+            src = this->rop_src_row.data();
         }
-        break;
+
+        mach64_rop_row(dst, src, mask, len, op.frgd_mix);
     }
 
-    this->draw_fb = true;
+    this->mark_rows_dirty(op.first_row, op.first_row + op.num_rows - 1);
+    return true;
 }
 
-void ATIRage::start_host_rect(uint32_t dst_width, uint32_t dst_height) {
-    uint8_t frgd_mix = extract_bits<uint32_t>(this->regs[ATI_DP_MIX], ATI_DP_FRGD_MIX,
-                                              ATI_DP_FRGD_MIX_size);
-    uint8_t host_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_HOST_PIX_WIDTH,
-                                                  ATI_DP_HOST_PIX_WIDTH_size);
-    uint8_t dst_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_DST_PIX_WIDTH,
-                                                 ATI_DP_DST_PIX_WIDTH_size);
-
-    if (frgd_mix != ATI_DP_MIX_SRC || host_pix_fmt != ATI_PIX_FMT_8BPP ||
-        dst_pix_fmt != ATI_PIX_FMT_8BPP || this->regs[ATI_CLR_CMP_CNTL]) {
-        LOG_F(WARNING, "%s: unsupported color host rectangle, DP_MIX=0x%08X, "
-              "DP_PIX_WIDTH=0x%08X, CLR_CMP_CNTL=0x%08X", this->name.c_str(),
-              this->regs[ATI_DP_MIX], this->regs[ATI_DP_PIX_WIDTH],
-              this->regs[ATI_CLR_CMP_CNTL]);
-        return;
-    }
+/* Returns the write mask pattern for a fast path row or nullptr if
+   all pixel bits are writable. */
+const uint8_t* ATIRage::prepare_mask_row() {
+    const auto& op = this->draw_op;
 
-    this->host_dst_width   = dst_width;
-    this->host_dst_height  = dst_height;
-    this->host_dst_col     = 0;
-    this->host_dst_row     = 0;
-    this->host_data_active = true;
+    uint32_t pixel_bits = op.dst_bpp == 4 ? 0xFFFFFFFFU : ((1U << (op.dst_bpp * 8)) - 1);
+    if ((op.write_mask & pixel_bits) == pixel_bits)
+        return nullptr;
+
+    mach64_fill_row_buf(this->rop_mask_row, op.dst_fmt, op.dst_bpp, op.write_mask,
+                        op.num_cols);
+    return this->rop_mask_row.data();
 }
 
-void ATIRage::write_host_data(uint32_t value, uint32_t size) {
-    if (!this->host_data_active) {
-        return;
-    }
+/* Returns the leftmost byte of the clipped part of a rectangle row or nullptr
+   if the row doesn't fit into VRAM. */
+uint8_t* ATIRage::get_dst_span(uint32_t row, size_t len) {
+    const auto& op = this->draw_op;
 
-    int dst_offs = extract_bits<uint32_t>(
-                       this->regs[ATI_DST_OFF_PITCH], ATI_DST_OFFSET, ATI_DST_OFFSET_size) *
-        8;
-    int dst_pitch =
-        extract_bits<uint32_t>(this->regs[ATI_DST_OFF_PITCH], ATI_DST_PITCH, ATI_DST_PITCH_size) * 8;
-    int dst_x   = mach64_extract_signed(this->regs[ATI_DST_X], ATI_DST_X_pos, ATI_DST_X_size);
-    int dst_y   = mach64_extract_signed(this->regs[ATI_DST_Y], ATI_DST_Y_pos, ATI_DST_Y_size);
-    int sc_left = mach64_extract_signed(this->regs[ATI_SC_LEFT], ATI_SC_LEFT_pos, ATI_SC_LEFT_size);
-    int sc_right = mach64_extract_signed(
-        this->regs[ATI_SC_RIGHT], ATI_SC_RIGHT_pos, ATI_SC_RIGHT_size);
-    int sc_top    = mach64_extract_signed(this->regs[ATI_SC_TOP], ATI_SC_TOP_pos, ATI_SC_TOP_size);
-    int sc_bottom = mach64_extract_signed(
-        this->regs[ATI_SC_BOTTOM], ATI_SC_BOTTOM_pos, ATI_SC_BOTTOM_size);
-    int x_inc          = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_X_DIR) ? 1 : -1;
-    int y_inc          = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_Y_DIR) ? 1 : -1;
-    uint8_t write_mask = this->regs[ATI_DP_WRITE_MSK];
+    int x = op.dst_x + int(op.first_col) * op.x_inc;
+    if (op.x_inc < 0)
+        x -= op.num_cols - 1;
+    int y = op.dst_y + int(row) * op.y_inc;
 
-    for (uint32_t byte = 0; byte < size && this->host_data_active; byte++) {
-        int shift     = x_inc > 0 ? int(byte) * 8 : int(size - byte - 1) * 8;
-        uint8_t pixel = value >> shift;
-        int x         = dst_x + int(this->host_dst_col) * x_inc;
-        int y         = dst_y + int(this->host_dst_row) * y_inc;
-
-        if (x >= sc_left && x <= sc_right && y >= sc_top && y <= sc_bottom) {
-            uint8_t* dst  = &this->vram_ptr[dst_offs + y * dst_pitch + x];
-            *dst          = (*dst & ~write_mask) | (pixel & write_mask);
-            this->draw_fb = true;
-        }
+    int64_t offs = int64_t(op.dst_offs) + int64_t(y) * op.dst_pitch + int64_t(x) * op.dst_bpp;
+    if (offs < 0 || offs + int64_t(len) > this->vram_size)
+        return nullptr;
 
-        if (++this->host_dst_col >= this->host_dst_width) {
-            this->host_dst_col = 0;
-            if (++this->host_dst_row >= this->host_dst_height) {
-                this->host_data_active = false;
-                this->finish_rect(this->host_dst_width, this->host_dst_height);
-            }
+    return &this->vram_ptr[offs];
+}
+
+/* Generic path that runs every pixel through the whole data path. */
+void ATIRage::draw_pixels() {
+    const auto& op = this->draw_op;
+
+    if (!op.num_cols || !op.num_rows)
+        return;
+
+    for (uint32_t row = op.first_row; row < op.first_row + op.num_rows; row++) {
+        for (uint32_t col = op.first_col; col < op.first_col + op.num_cols; col++) {
+            this->draw_pixel(col, row, this->get_mono_bit(col, row), 0);
         }
     }
+
+    this->mark_rows_dirty(op.first_row, op.first_row + op.num_rows - 1);
 }
 
-void ATIRage::blit_rect(uint32_t dst_width, uint32_t dst_height) {
-    uint8_t frgd_mix = extract_bits<uint32_t>(this->regs[ATI_DP_MIX], ATI_DP_FRGD_MIX,
-                                              ATI_DP_FRGD_MIX_size);
-    uint8_t src_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_SRC_PIX_WIDTH,
-                                                 ATI_DP_SRC_PIX_WIDTH_size);
-    uint8_t dst_pix_fmt = extract_bits<uint32_t>(this->regs[ATI_DP_PIX_WIDTH], ATI_DP_DST_PIX_WIDTH,
-                                                 ATI_DP_DST_PIX_WIDTH_size);
+/* Draw one pixel of the current rectangle. The monochrome bit selects between
+   the foreground and background source and mix function. */
+void ATIRage::draw_pixel(uint32_t col, uint32_t row, bool mono, uint32_t host_clr) {
+    const auto& op = this->draw_op;
 
-    int bytes_per_pixel;
-    switch (dst_pix_fmt) {
-    case ATI_PIX_FMT_8BPP:
-        bytes_per_pixel = 1;
+    int x = op.dst_x + int(col) * op.x_inc;
+    int y = op.dst_y + int(row) * op.y_inc;
+
+    if (x < op.sc_left || x > op.sc_right || y < op.sc_top || y > op.sc_bottom)
+        return;
+
+    int64_t dst_offs = int64_t(op.dst_offs) + int64_t(y) * op.dst_pitch +
+                       int64_t(x) * op.dst_bpp;
+    if (dst_offs < 0 || dst_offs + op.dst_bpp > this->vram_size)
+        return;
+
+    uint32_t src = 0;
+
+    switch (mono ? op.frgd_src : op.bkgd_src) {
+    case ATI_DP_COLOR_SRC_BKGD_CLR:
+        src = op.bkgd_clr;
         break;
-    case ATI_PIX_FMT_RGB555:
-    case ATI_PIX_FMT_RGB565:
-        bytes_per_pixel = 2;
+    case ATI_DP_COLOR_SRC_FRGD_CLR:
+        src = op.frgd_clr;
         break;
-    case ATI_PIX_FMT_ARGB8888:
-        bytes_per_pixel = 4;
+    case ATI_DP_COLOR_SRC_HOST:
+        src = host_clr;
         break;
-    default:
-        bytes_per_pixel = 0;
+    case ATI_DP_COLOR_SRC_BLIT: {
+        int sx, sy;
+        this->get_blit_src_pos(col, row, sx, sy);
+        int64_t src_offs = int64_t(op.src_offs) + int64_t(sy) * op.src_pitch * op.dst_bpp +
+                           int64_t(sx) * op.dst_bpp;
+        if (src_offs >= 0 && src_offs + op.dst_bpp <= this->vram_size)
+            src = mach64_read_pixel(&this->vram_ptr[src_offs], op.src_fmt);
         break;
     }
+    }
 
-    uint32_t pixel_mask = bytes_per_pixel == 4 ? 0xFFFFFFFFU :
-                          ((1U << (bytes_per_pixel * 8)) - 1);
-
-    uint32_t src_cntl             = this->regs[ATI_SRC_CNTL];
-    bool supported_src_trajectory = src_cntl == ATI_SRC_TRAJ_UNBOUNDED ||
-        src_cntl == ATI_SRC_TRAJ_PATTERN || src_cntl == ATI_SRC_TRAJ_ROTATED;
+    uint8_t* dst_ptr = &this->vram_ptr[dst_offs];
+    uint32_t dst     = mach64_read_pixel(dst_ptr, op.dst_fmt);
 
-    if (frgd_mix != ATI_DP_MIX_SRC || !supported_src_trajectory || this->regs[ATI_CLR_CMP_CNTL] ||
-        src_pix_fmt != dst_pix_fmt || !bytes_per_pixel ||
-        (this->regs[ATI_DP_WRITE_MSK] & pixel_mask) != pixel_mask) {
-        LOG_F(WARNING, "%s: unsupported rectangle blit, DP_SRC=0x%08X, DP_MIX=0x%08X, "
-              "DP_PIX_WIDTH=0x%08X, DP_WRITE_MSK=0x%08X, SRC_CNTL=0x%08X, "
-              "CLR_CMP_CNTL=0x%08X", this->name.c_str(), this->regs[ATI_DP_SRC],
-              this->regs[ATI_DP_MIX], this->regs[ATI_DP_PIX_WIDTH], this->regs[ATI_DP_WRITE_MSK],
-              this->regs[ATI_SRC_CNTL], this->regs[ATI_CLR_CMP_CNTL]);
+    if (op.cmp_fcn != ATI_CLR_CMP_FCN_FALSE &&
+        mach64_cmp_inhibits(op.cmp_fcn, op.cmp_src == ATI_CLR_CMP_SRC_2D ? src : dst,
+                            op.cmp_clr, op.cmp_msk))
         return;
+
+    uint32_t pix = mach64_mix(mono ? op.frgd_mix : op.bkgd_mix, dst, src, op.dst_fmt);
+
+    mach64_write_pixel(dst_ptr, op.dst_fmt, (dst & ~op.write_mask) | (pix & op.write_mask));
+}
+
+/* Monochrome data path for sources other than host data. */
+bool ATIRage::get_mono_bit(uint32_t col, uint32_t row) {
+    const auto& op = this->draw_op;
+
+    switch (op.mono_src) {
+    case ATI_DP_MONO_SRC_PATTERN: {
+        // 8x8 pattern, one byte per row, aligned to the destination
+        int x = op.dst_x + int(col) * op.x_inc;
+        int y = op.dst_y + int(row) * op.y_inc;
+        uint8_t bits = this->regs[(y & 4) ? ATI_PAT_REG1 : ATI_PAT_REG0] >> ((y & 3) * 8);
+        return op.lsb_first ? (bits >> (x & 7)) & 1 : (bits >> (7 - (x & 7))) & 1;
     }
+    case ATI_DP_MONO_SRC_BLIT: {
+        // one bit per pixel in VRAM, pitch is given in pixels
+        int sx, sy;
+        this->get_blit_src_pos(col, row, sx, sy);
+        int64_t bit_pos = int64_t(op.src_offs) * 8 + int64_t(sy) * op.src_pitch + sx;
+        if (bit_pos < 0 || (bit_pos >> 3) >= this->vram_size)
+            return false;
+        uint8_t bits = this->vram_ptr[bit_pos >> 3];
+        return op.lsb_first ? (bits >> (bit_pos & 7)) & 1 : (bits >> (7 - (bit_pos & 7))) & 1;
+    }
+    default:
+        return true;
+    }
+}
 
-    int src_offs = extract_bits<uint32_t>(
-                       this->regs[ATI_SRC_OFF_PITCH], ATI_SRC_OFFSET, ATI_SRC_OFFSET_size) *
-        8;
-    int src_pitch = extract_bits<uint32_t>(
-                        this->regs[ATI_SRC_OFF_PITCH], ATI_SRC_PITCH, ATI_SRC_PITCH_size) *
-        8 * bytes_per_pixel;
-    int src_x       = mach64_extract_signed(this->regs[ATI_SRC_X], ATI_SRC_X_pos, ATI_SRC_X_size);
-    int src_y       = mach64_extract_signed(this->regs[ATI_SRC_Y], ATI_SRC_Y_pos, ATI_SRC_Y_size);
-    int src_x_start = mach64_extract_signed(
-        this->regs[ATI_SRC_X_START], ATI_SRC_X_START_pos, ATI_SRC_X_START_size);
-    int src_y_start = mach64_extract_signed(
-        this->regs[ATI_SRC_Y_START], ATI_SRC_Y_START_pos, ATI_SRC_Y_START_size);
-    uint32_t src_width1 = extract_bits<uint32_t>(
-        this->regs[ATI_SRC_WIDTH1], ATI_SRC_WIDTH1_pos, ATI_SRC_WIDTH1_size);
-    uint32_t src_height1 = extract_bits<uint32_t>(
-        this->regs[ATI_SRC_HEIGHT1], ATI_SRC_HEIGHT1_pos, ATI_SRC_HEIGHT1_size);
-    uint32_t src_width2 = extract_bits<uint32_t>(
-        this->regs[ATI_SRC_WIDTH2], ATI_SRC_WIDTH2_pos, ATI_SRC_WIDTH2_size);
-    uint32_t src_height2 = extract_bits<uint32_t>(
-        this->regs[ATI_SRC_HEIGHT2], ATI_SRC_HEIGHT2_pos, ATI_SRC_HEIGHT2_size);
-
-    if ((src_cntl == ATI_SRC_TRAJ_PATTERN && (!src_width1 || !src_height1)) ||
-        (src_cntl == ATI_SRC_TRAJ_ROTATED &&
-         (!src_width1 || !src_height1 || !src_width2 || !src_height2))) {
-        LOG_F(WARNING, "%s: invalid rectangle blit source trajectory, SRC_CNTL=0x%08X, "
-              "SRC_HEIGHT1_WIDTH1=0x%08X, SRC_HEIGHT2_WIDTH2=0x%08X", this->name.c_str(),
-              src_cntl, this->regs[ATI_SRC_HEIGHT1_WIDTH1],
-              this->regs[ATI_SRC_HEIGHT2_WIDTH2]);
-        return;
+void ATIRage::get_blit_src_pos(uint32_t col, uint32_t row, int& sx, int& sy) {
+    const auto& op = this->draw_op;
+
+    if (op.src_cntl == ATI_SRC_TRAJ_PATTERN) {
+        sy = op.src_y + int(row % op.src_height1) * op.y_inc;
+    } else if (op.src_cntl == ATI_SRC_TRAJ_ROTATED && row >= op.src_height1) {
+        sy = op.src_y_start + int((row - op.src_height1) % op.src_height2) * op.y_inc;
+    } else {
+        sy = op.src_y + int(row) * op.y_inc;
     }
 
-    int dst_offs = extract_bits<uint32_t>(
-                       this->regs[ATI_DST_OFF_PITCH], ATI_DST_OFFSET, ATI_DST_OFFSET_size) *
-        8;
-    int dst_pitch = extract_bits<uint32_t>(
-                        this->regs[ATI_DST_OFF_PITCH], ATI_DST_PITCH, ATI_DST_PITCH_size) *
-        8 * bytes_per_pixel;
-    int dst_x = mach64_extract_signed(this->regs[ATI_DST_X], ATI_DST_X_pos, ATI_DST_X_size);
-    int dst_y = mach64_extract_signed(this->regs[ATI_DST_Y], ATI_DST_Y_pos, ATI_DST_Y_size);
+    if (op.src_cntl == ATI_SRC_TRAJ_PATTERN) {
+        sx = op.src_x + int(col % op.src_width1) * op.x_inc;
+    } else if (op.src_cntl == ATI_SRC_TRAJ_ROTATED && row > 0) {
+        sx = op.src_x_start + int(col % op.src_width2) * op.x_inc;
+    } else if (op.src_cntl == ATI_SRC_TRAJ_ROTATED && col >= op.src_width1) {
+        sx = op.src_x_start + int((col - op.src_width1) % op.src_width2) * op.x_inc;
+    } else {
+        sx = op.src_x + int(col) * op.x_inc;
+    }
+}
 
-    int x_inc = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_X_DIR) ? 1 : -1;
-    int y_inc = bit_set(this->regs[ATI_DST_CNTL], ATI_DST_Y_DIR) ? 1 : -1;
+void ATIRage::mark_rows_dirty(uint32_t first_row, uint32_t last_row) {
+    const auto& op = this->draw_op;
 
-    int sc_left = mach64_extract_signed(this->regs[ATI_SC_LEFT], ATI_SC_LEFT_pos, ATI_SC_LEFT_size);
-    int sc_right = mach64_extract_signed(
-        this->regs[ATI_SC_RIGHT], ATI_SC_RIGHT_pos, ATI_SC_RIGHT_size);
-    int sc_top    = mach64_extract_signed(this->regs[ATI_SC_TOP], ATI_SC_TOP_pos, ATI_SC_TOP_size);
-    int sc_bottom = mach64_extract_signed(
-        this->regs[ATI_SC_BOTTOM], ATI_SC_BOTTOM_pos, ATI_SC_BOTTOM_size);
+    int top    = op.dst_y + int(first_row) * op.y_inc;
+    int bottom = op.dst_y + int(last_row) * op.y_inc;
+    if (top > bottom)
+        std::swap(top, bottom);
 
-    int x_skip, y_skip;
-    if (!mach64_clip_axis(dst_x, x_inc, dst_width, sc_left, sc_right, x_skip, dst_width) ||
-        !mach64_clip_axis(dst_y, y_inc, dst_height, sc_top, sc_bottom, y_skip, dst_height)) {
+    int64_t start = int64_t(op.dst_offs) + int64_t(top) * op.dst_pitch;
+    int64_t end   = int64_t(op.dst_offs) + int64_t(bottom + 1) * op.dst_pitch;
+    start = std::clamp<int64_t>(start, 0, this->vram_size);
+    end   = std::clamp<int64_t>(end, 0, this->vram_size);
+
+    if (end > start)
+        this->mark_fb_dirty(&this->vram_ptr[start], uint32_t(end - start));
+}
+
+void ATIRage::start_host_rect(uint32_t dst_width, uint32_t dst_height) {
+    this->host_dst_width   = dst_width;
+    this->host_dst_height  = dst_height;
+    this->host_dst_col     = 0;
+    this->host_dst_row     = 0;
+    this->host_pix_acc     = 0;
+    this->host_pix_bytes   = 0;
+    this->host_data_active = true;
+}
+
+/* Draw the next pixel of a host data rectangle.
+   Returns true if it was the last pixel of a row. */
+bool ATIRage::put_host_pixel(bool mono, uint32_t host_clr) {
+    this->draw_pixel(this->host_dst_col, this->host_dst_row, mono, host_clr);
+
+    if (++this->host_dst_col < this->host_dst_width)
+        return false;
+
+    this->host_dst_col = 0;
+    if (++this->host_dst_row >= this->host_dst_height) {
+        this->host_data_active = false;
+        this->finish_rect(this->host_dst_width, this->host_dst_height);
+    }
+    return true;
+}
+
+void ATIRage::write_host_data(uint32_t value, uint32_t size) {
+    if (!this->host_data_active) {
         return;
     }
-    dst_x += x_skip * x_inc;
-    dst_y += y_skip * y_inc;
 
-    for (uint32_t y = 0; y < dst_height; y++) {
-        uint32_t src_row_index = y_skip + y;
-        int sy;
-        if (src_cntl == ATI_SRC_TRAJ_PATTERN) {
-            sy = src_y + int(src_row_index % src_height1) * y_inc;
-        } else if (src_cntl == ATI_SRC_TRAJ_ROTATED && src_row_index >= src_height1) {
-            sy = src_y_start + int((src_row_index - src_height1) % src_height2) * y_inc;
-        } else {
-            sy = src_y + int(src_row_index) * y_inc;
-        }
+    const auto& op = this->draw_op;
 
-        uint8_t* src_row = &this->vram_ptr[src_offs + sy * src_pitch];
-        int dy           = dst_y + int(y) * y_inc;
-        uint8_t* dst_row = &this->vram_ptr[dst_offs + dy * dst_pitch];
-        for (uint32_t x = 0; x < dst_width; x++) {
-            uint32_t src_col_index = x_skip + x;
-            int sx;
-            if (src_cntl == ATI_SRC_TRAJ_PATTERN) {
-                sx = src_x + int(src_col_index % src_width1) * x_inc;
-            } else if (src_cntl == ATI_SRC_TRAJ_ROTATED && src_row_index > 0) {
-                sx = src_x_start + int(src_col_index % src_width2) * x_inc;
-            } else if (src_cntl == ATI_SRC_TRAJ_ROTATED && src_col_index >= src_width1) {
-                sx = src_x_start + int((src_col_index - src_width1) % src_width2) * x_inc;
-            } else {
-                sx = src_x + int(src_col_index) * x_inc;
-            }
+    bool     mono_data = op.mono_src == ATI_DP_MONO_SRC_HOST;
+    uint32_t first_row = this->host_dst_row;
+
+    // Right-to-left rectangles take the pixels of each write in reverse order.
+    // The bytes of a color pixel keep their order regardless of the direction.
+    uint32_t pix_bytes = mono_data ? 1 : op.host_bpp;
+    bool     reverse   = op.x_inc < 0 && !(size % pix_bytes);
 
-            int dx             = dst_x + int(x) * x_inc;
-            uint8_t* src_pixel = &src_row[sx * bytes_per_pixel];
-            uint8_t* dst_pixel = &dst_row[dx * bytes_per_pixel];
-            for (int byte = 0; byte < bytes_per_pixel; byte++) {
-                dst_pixel[byte] = src_pixel[byte];
+    for (uint32_t byte = 0; byte < size && this->host_data_active; byte++) {
+        uint32_t src_byte = reverse ? size - pix_bytes - (byte / pix_bytes) * pix_bytes +
+                                      byte % pix_bytes : byte;
+        uint8_t  data     = value >> (src_byte * 8);
+
+        if (mono_data) {
+            // expand monochrome data, each row starts with a new byte if requested
+            for (int bit = 0; bit < 8 && this->host_data_active; bit++) {
+                bool mono = op.lsb_first ? (data >> bit) & 1 : (data >> (7 - bit)) & 1;
+                if (this->put_host_pixel(mono, 0) && op.host_byte_align)
+                    break;
+            }
+        } else {
+            this->host_pix_acc |= uint32_t(data) << (this->host_pix_bytes * 8);
+            if (++this->host_pix_bytes >= op.host_bpp) {
+                uint32_t host_clr    = this->host_pix_acc;
+                this->host_pix_acc   = 0;
+                this->host_pix_bytes = 0;
+                this->put_host_pixel(this->get_mono_bit(this->host_dst_col, this->host_dst_row),
+                                     host_clr);
             }
         }
     }
 
-    this->draw_fb = true;
+    uint32_t last_row = this->host_data_active ? this->host_dst_row : this->host_dst_height - 1;
+    this->mark_rows_dirty(first_row, last_row);
 }
 
 // ================================== Device config ====================================
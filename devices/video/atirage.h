@@ -29,6 +29,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <cinttypes>
 #include <memory>
+#include <vector>
 
 /* Mach64 PLL register indices. */
 enum {
@@ -89,14 +90,24 @@ protected:
 private:
     void change_one_bar(uint32_t &aperture, uint32_t aperture_size,
                         uint32_t aperture_new, int bar_num);
+    void change_main_aperture(uint32_t aperture_new);
     void update_interrupt();
 
     void begin_drawing(uint32_t initiator, uint32_t value);
     void draw_rect(uint32_t width, uint32_t height);
     void finish_rect(uint32_t width, uint32_t height);
-    void fill_rect(uint32_t dst_width, uint32_t dst_height, uint32_t color);
-    void blit_rect(uint32_t dst_width, uint32_t dst_height);
+    bool setup_draw_op(uint32_t width, uint32_t height);
+    bool fill_rect();
+    bool blit_rect();
+    const uint8_t* prepare_mask_row();
+    uint8_t* get_dst_span(uint32_t row, size_t len);
+    void draw_pixels();
+    void draw_pixel(uint32_t col, uint32_t row, bool mono, uint32_t host_clr);
+    bool get_mono_bit(uint32_t col, uint32_t row);
+    void get_blit_src_pos(uint32_t col, uint32_t row, int& sx, int& sy);
+    void mark_rows_dirty(uint32_t first_row, uint32_t last_row);
     void start_host_rect(uint32_t dst_width, uint32_t dst_height);
+    bool put_host_pixel(bool mono, uint32_t host_clr);
     void write_host_data(uint32_t value, uint32_t size);
 
     uint32_t    regs[512] = {}; // internal registers
@@ -105,11 +116,65 @@ private:
     uint8_t     cmd_fifo_size = 0;
     bool        pci_irq_line_state = false;
 
+    // parameters of the current draw engine operation, see setup_draw_op()
+    struct {
+        int         dst_offs;   // in bytes
+        int         dst_pitch;  // in bytes
+        int         dst_x;
+        int         dst_y;
+        int         x_inc;
+        int         y_inc;
+        uint8_t     dst_fmt;
+        int         dst_bpp;    // bytes per destination pixel
+        int         sc_left;
+        int         sc_right;
+        int         sc_top;
+        int         sc_bottom;
+        uint8_t     frgd_src;
+        uint8_t     bkgd_src;
+        uint8_t     mono_src;
+        uint8_t     frgd_mix;
+        uint8_t     bkgd_mix;
+        uint32_t    frgd_clr;
+        uint32_t    bkgd_clr;
+        uint32_t    write_mask;
+        uint8_t     cmp_fcn;
+        uint8_t     cmp_src;
+        uint32_t    cmp_clr;
+        uint32_t    cmp_msk;
+        bool        lsb_first;  // bit order of monochrome data
+        bool        uses_blit;  // color or monochrome data comes from VRAM
+        uint8_t     src_fmt;
+        uint32_t    src_cntl;
+        int         src_offs;   // in bytes
+        int         src_pitch;  // in pixels
+        int         src_x;
+        int         src_y;
+        int         src_x_start;
+        int         src_y_start;
+        uint32_t    src_width1;
+        uint32_t    src_height1;
+        uint32_t    src_width2;
+        uint32_t    src_height2;
+        uint8_t     host_fmt;
+        int         host_bpp;
+        bool        host_byte_align;
+        uint32_t    first_col;  // part of the rectangle inside the scissors
+        uint32_t    num_cols;
+        uint32_t    first_row;
+        uint32_t    num_rows;
+    } draw_op = {};
+
+    std::vector<uint8_t> rop_src_row;  // source row buffer for the fast paths
+    std::vector<uint8_t> rop_mask_row; // write mask row buffer for the fast paths
+
     bool        host_data_active = false;
     uint32_t    host_dst_width   = 0;
     uint32_t    host_dst_height  = 0;
     uint32_t    host_dst_col     = 0;
     uint32_t    host_dst_row     = 0;
+    uint32_t    host_pix_acc     = 0; // color host pixel being assembled
+    int         host_pix_bytes   = 0; // bytes already in host_pix_acc
 
     // Video RAM variables
     std::unique_ptr<uint8_t[]>  vram_ptr;
@@ -127,6 +192,12 @@ private:
     uint32_t aperture_size[3] = { 0x1000000, 0x100, 0x1000 };
     uint32_t aperture_flag[3] = { 0, 1, 0 };
 
+    // VRAM windows of the main aperture are mapped as host memory,
+    // only the part starting at aper0_mmio_offs goes through read/write
+    AddressMapEntry* vram_le_rgn = nullptr;
+    AddressMapEntry* vram_be_rgn = nullptr;
+    uint32_t    aper0_mmio_offs = 0;
+
     std::unique_ptr<DisplayID>  disp_id;
 
     // DAC interface state
@@ -27,8 +27,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/hostevents.h>
 #include <core/memaccess.h>
 
+#include <cinttypes>
 #include <functional>
 #include <memory>
+#include <string>
 
 /* HACK: the stuff below is a VERY BASIC platform abstraction hardcoded for SDL2
    for now: SDL2 framebuffer's endianness matches the host's CPU endianness. */
@@ -37,6 +39,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 class VideoCtrlBase;
 
+/** Host display backends selectable with --display. */
+enum class DisplayBackend {
+    sdl,        // host window
+    offscreen,  // host memory only, frames can be dumped to PPM files
+    none,       // guest frames are neither converted nor presented
+};
+
+extern DisplayBackend   g_display_backend;
+extern uint32_t         g_frame_dump_interval;  // dump every Nth frame, 0 - never
+extern std::string      g_frame_dump_prefix;    // path prefix of the dump files
+
 class Display {
 public:
     enum {
@@ -68,10 +81,16 @@ public:
     // Update the host framebuffer display. If the display adapter does its own
     // dirty tracking, fb_known_to_be_changed will be set to true, so that the
     // implementation can take that into account.
+    // When num_rows is non-zero, only the rows first_row...first_row+num_rows-1
+    // are refreshed and convert_fb_cb receives a pointer to first_row.
     void update(std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb,
                 std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb,
                 bool draw_hw_cursor, int cursor_x, int cursor_y,
-                bool fb_known_to_be_changed);
+                bool fb_known_to_be_changed, int first_row = 0, int num_rows = 0);
+
+    // Returns true if the next update must refresh the whole screen,
+    // e.g. because the host texture has been recreated.
+    bool needs_full_update();
 
     // Called in cases where the framebuffer contents have not changed, so a
     // normal update() call is not happening. Allows implementations that need
@@ -84,6 +103,13 @@ public:
     void update_window_title();
     void toggle_mouse_grab();
     void update_mouse_grab(bool will_be_grabbed);
+
+    // Returns false if guest frames don't need to be converted at all.
+    bool keeps_frames();
+
+    // Asks every offscreen display to dump its next frame.
+    // Safe to call from a signal handler.
+    static void request_frame_dump();
 private:
     class Impl; // Holds private fields
     std::unique_ptr<Impl> impl;
@@ -23,11 +23,23 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/video/videoctrl.h>
 #include <SDL.h>
 #include <loguru.hpp>
+#include <algorithm>
 #include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
 #include <string>
+#include <vector>
 
 bool g_auto_grab_mouse = false;
 
+DisplayBackend  g_display_backend     = DisplayBackend::sdl;
+uint32_t        g_frame_dump_interval = 0;
+std::string     g_frame_dump_prefix   = "dppc_frame";
+
+static volatile std::sig_atomic_t frame_dump_requests = 0;
+static int num_displays = 0;
+
 static const char * get_full_screen_mode_string(int scale_mode) {
 #define onemode(x) case Display::x: return #x ;
     switch(scale_mode) {
@@ -49,6 +61,7 @@ public:
     double          default_scale_x;
     double          default_scale_y;
     SDL_Texture*    disp_texture = 0;
+    bool            texture_stale = true; // disp_texture content is undefined
     SDL_Texture*    cursor_texture = 0;
     SDL_Rect        cursor_rect; // destination rectangle for cursor drawing
     bool            show_host_cursor = true; // desired SDL host pointer visibility
@@ -60,9 +73,28 @@ public:
     double          drawable_w;
     double          drawable_h;
     SDL_Rect        dest_rect;
+
+    // headless backends
+    DisplayBackend  backend;
+    bool            headless;
+    bool            offscreen_ready = false;
+    std::vector<uint32_t> host_fb; // ARGB8888 frame in host byte order
+    bool            host_fb_stale = true; // host_fb content is undefined
+    bool            blanked = false;
+    uint64_t        frame_num = 0;
+    int             dump_id = 0; // distinguishes dumps of multiple displays
+    int             dump_reqs_seen = 0;
+
+    void end_frame();
+    void dump_frame();
 };
 
 Display::Display(): impl(std::make_unique<Impl>()) {
+    impl->backend        = g_display_backend;
+    impl->headless       = impl->backend != DisplayBackend::sdl;
+    impl->dump_id        = num_displays++;
+    impl->dump_reqs_seen = frame_dump_requests;
+
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
 }
 
@@ -96,6 +128,16 @@ bool Display::configure(int width, int height) {
     impl->display_w = width;
     impl->display_h = height;
 
+    if (impl->headless) {
+        if (impl->backend == DisplayBackend::offscreen) {
+            impl->host_fb.assign(size_t(width) * height, 0xFF000000U);
+            impl->host_fb_stale = true;
+        }
+        is_initialization = !impl->offscreen_ready;
+        impl->offscreen_ready = true;
+        return is_initialization;
+    }
+
     if (!impl->display_wnd) { // create display window
         impl->display_wnd = SDL_CreateWindow(
             "",
@@ -150,7 +192,7 @@ bool Display::configure(int width, int height) {
 }
 
 void Display::update_window_size() {
-    if (this->full_screen_mode != not_full_screen)
+    if (impl->headless || this->full_screen_mode != not_full_screen)
         return;
 
     int w, h;
@@ -184,6 +226,9 @@ void Display::update_window_size() {
 }
 
 void Display::configure_dest() {
+    if (impl->headless)
+        return;
+
     bool should_set_full_screen = this->full_screen_mode > not_full_screen;
     if (this->is_set_full_screen != should_set_full_screen) {
         if (should_set_full_screen) {
@@ -268,6 +313,9 @@ void Display::configure_dest() {
 }
 
 void Display::configure_texture() {
+    if (impl->headless)
+        return;
+
     if (impl->disp_texture)
         SDL_DestroyTexture(impl->disp_texture);
 
@@ -280,9 +328,28 @@ void Display::configure_texture() {
 
     if (impl->disp_texture == NULL)
         ABORT_F("Display: SDL_CreateTexture failed with %s", SDL_GetError());
+
+    impl->texture_stale = true;
+}
+
+bool Display::needs_full_update() {
+    if (impl->headless)
+        return impl->host_fb_stale;
+    return impl->texture_stale;
+}
+
+bool Display::keeps_frames() {
+    return impl->backend != DisplayBackend::none;
+}
+
+void Display::request_frame_dump() {
+    frame_dump_requests = frame_dump_requests + 1;
 }
 
 void Display::handle_events(const WindowEvent& wnd_event) {
+    if (impl->headless)
+        return;
+
     switch (wnd_event.sub_type) {
 
     case SDL_WINDOWEVENT_SIZE_CHANGED:
@@ -408,6 +475,9 @@ if (g_auto_grab_mouse) {
 
 void Display::toggle_mouse_grab()
 {
+    if (impl->headless)
+        return;
+
     if (SDL_GetRelativeMouseMode()) {
         SDL_SetRelativeMouseMode(SDL_FALSE);
         impl->manual_grab = false;
@@ -420,6 +490,9 @@ void Display::toggle_mouse_grab()
 
 void Display::update_mouse_grab(bool will_be_grabbed)
 {
+    if (impl->headless)
+        return;
+
     bool is_grabbed = SDL_GetRelativeMouseMode();
     if (will_be_grabbed || is_grabbed) {
         // If the mouse is initially outside the window, move it to the middle,
@@ -442,6 +515,9 @@ void Display::update_mouse_grab(bool will_be_grabbed)
 
 void Display::update_window_title()
 {
+    if (impl->headless)
+        return;
+
     std::string old_window_title = SDL_GetWindowTitle(impl->display_wnd);
 
     int width, height;
@@ -461,6 +537,12 @@ void Display::update_window_title()
 }
 
 void Display::blank() {
+    if (impl->headless) {
+        impl->blanked = true;
+        impl->end_frame();
+        return;
+    }
+
     SDL_SetRenderDrawColor(impl->renderer, 0, 0, 0, 255);
     SDL_RenderClear(impl->renderer);
     SDL_RenderPresent(impl->renderer);
@@ -469,11 +551,36 @@ void Display::blank() {
 void Display::update(std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb,
                      std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb,
                      bool draw_hw_cursor, int cursor_x, int cursor_y,
-                     bool fb_known_to_be_changed) {
+                     bool fb_known_to_be_changed, int first_row, int num_rows) {
     uint8_t*    dst_buf = nullptr;
     int         dst_pitch;
 
-    SDL_LockTexture(impl->disp_texture, NULL, (void **)&dst_buf, &dst_pitch);
+    if (impl->headless) {
+        // convert into host memory, there is nothing to present
+        dst_buf   = reinterpret_cast<uint8_t*>(impl->host_fb.data());
+        dst_pitch = impl->display_w * 4;
+        if (num_rows && !impl->host_fb_stale)
+            dst_buf += first_row * dst_pitch;
+        else
+            impl->host_fb_stale = false;
+
+        convert_fb_cb(dst_buf, dst_pitch);
+        if (cursor_ovl_cb != nullptr)
+            cursor_ovl_cb(dst_buf, dst_pitch);
+
+        impl->blanked = false;
+        impl->end_frame();
+        return;
+    }
+
+    if (num_rows && !impl->texture_stale) {
+        // lock and upload the modified rows only
+        SDL_Rect upd_rect = {0, first_row, impl->display_w, num_rows};
+        SDL_LockTexture(impl->disp_texture, &upd_rect, (void **)&dst_buf, &dst_pitch);
+    } else {
+        SDL_LockTexture(impl->disp_texture, NULL, (void **)&dst_buf, &dst_pitch);
+        impl->texture_stale = false;
+    }
 
     // texture update callback to get ARGB data from guest framebuffer
     convert_fb_cb(dst_buf, dst_pitch);
@@ -539,6 +646,66 @@ if (g_auto_grab_mouse) {
 
 void Display::update_skipped() {
     // SDL implementation does not care about skipped updates.
+    if (impl->headless) {
+        impl->blanked = false;
+        impl->end_frame();
+    }
+}
+
+/* Count a refresh of an offscreen display and dump the resulting frame
+   if it has been requested or is due. */
+void Display::Impl::end_frame() {
+    if (this->backend != DisplayBackend::offscreen)
+        return;
+
+    this->frame_num++;
+
+    int  reqs      = frame_dump_requests;
+    bool requested = reqs != this->dump_reqs_seen;
+    this->dump_reqs_seen = reqs;
+
+    if (requested || (g_frame_dump_interval && !(this->frame_num % g_frame_dump_interval)))
+        this->dump_frame();
+}
+
+/* Write the current frame as a binary PPM file. The hardware cursor lives
+   in a separate overlay and is not part of the dump. */
+void Display::Impl::dump_frame() {
+    if (this->host_fb.empty())
+        return;
+
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), "_%d_%06llu.ppm", this->dump_id,
+                  static_cast<unsigned long long>(this->frame_num));
+    std::string path = g_frame_dump_prefix + suffix;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        LOG_F(ERROR, "Display: cannot create frame dump %s", path.c_str());
+        return;
+    }
+
+    out << "P6\n" << this->display_w << " " << this->display_h << "\n255\n";
+
+    std::vector<uint8_t> rgb_row(size_t(this->display_w) * 3, 0);
+    const uint32_t*      src_row = this->host_fb.data();
+
+    for (int y = 0; y < this->display_h; y++, src_row += this->display_w) {
+        if (!this->blanked) {
+            for (int x = 0; x < this->display_w; x++) {
+                rgb_row[x * 3 + 0] = (src_row[x] >> 16) & 0xFFU;
+                rgb_row[x * 3 + 1] = (src_row[x] >>  8) & 0xFFU;
+                rgb_row[x * 3 + 2] =  src_row[x]        & 0xFFU;
+            }
+        }
+        out.write(reinterpret_cast<const char*>(rgb_row.data()), rgb_row.size());
+    }
+
+    if (!out)
+        LOG_F(ERROR, "Display: cannot write frame dump %s", path.c_str());
+    else
+        LOG_F(INFO, "Display: frame %llu dumped to %s",
+              static_cast<unsigned long long>(this->frame_num), path.c_str());
 }
 
 void Display::setup_hw_cursor(std::function<void(uint8_t *dst_buf, int dst_pitch)> draw_hw_cursor,
@@ -546,6 +713,9 @@ void Display::setup_hw_cursor(std::function<void(uint8_t *dst_buf, int dst_pitch
     uint8_t*    dst_buf = nullptr;
     int         dst_pitch;
 
+    if (impl->headless)
+        return;
+
     if (impl->cursor_texture)
         SDL_DestroyTexture(impl->cursor_texture);
 
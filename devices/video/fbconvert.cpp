@@ -0,0 +1,473 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Framebuffer row converters with runtime CPU dispatch. */
+
+#include <core/memaccess.h>
+#include <devices/video/display.h>
+#include <devices/video/fbconvert.h>
+#include <loguru.hpp>
+
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+// Vector code stores host pixels directly so it's only enabled
+// on little-endian hosts where FB_WRITE is a plain store.
+#if defined(__x86_64__) || defined(_M_X64)
+#   define FBCONV_X86_64
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#       define FBCONV_TARGET(isa)
+#   else
+#       define FBCONV_TARGET(isa) __attribute__((target(isa)))
+#   endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__AARCH64EB__)
+#   define FBCONV_NEON
+#   include <arm_neon.h>
+#endif
+
+using namespace FbConvert;
+
+// ============================ Scalar converters ============================
+
+static void indexed_8bpp_scalar(const uint8_t* src, uint32_t* dst, int width,
+                                const uint32_t* palette) {
+    for (int x = 0; x < width; x++)
+        FB_WRITE(&dst[x], palette[src[x]]);
+}
+
+template <bool big_endian>
+static void rgb555_scalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 2) {
+        uint32_t c = big_endian ? READ_WORD_BE_A(src) : READ_WORD_LE_A(src);
+        uint32_t r = ((c << 9) & 0x00F80000) | ((c << 4) & 0x00070000);
+        uint32_t g = ((c << 6) & 0x0000F800) | ((c << 1) & 0x00000700);
+        uint32_t b = ((c << 3) & 0x000000F8) | ((c >> 2) & 0x00000007);
+        FB_WRITE(&dst[x], r | g | b);
+    }
+}
+
+template <bool big_endian>
+static void rgb565_scalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 2) {
+        uint32_t c = big_endian ? READ_WORD_BE_A(src) : READ_WORD_LE_A(src);
+        uint32_t r = ((c << 8) & 0x00F80000) | ((c << 3) & 0x00070000);
+        uint32_t g = ((c << 5) & 0x0000FC00) | ((c >> 1) & 0x00000300);
+        uint32_t b = ((c << 3) & 0x000000F8) | ((c >> 2) & 0x00000007);
+        FB_WRITE(&dst[x], r | g | b);
+    }
+}
+
+static void rgb888_scalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 3)
+        FB_WRITE(&dst[x], (src[0] << 16) | (src[1] << 8) | src[2]);
+}
+
+template <bool big_endian>
+static void argb8888_scalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 4)
+        FB_WRITE(&dst[x], big_endian ? READ_DWORD_BE_A(src) : READ_DWORD_LE_A(src));
+}
+
+static const RowConverters scalar_converters = {
+    "scalar",
+    indexed_8bpp_scalar,
+    rgb555_scalar<true>,
+    rgb555_scalar<false>,
+    rgb565_scalar<true>,
+    rgb565_scalar<false>,
+    rgb888_scalar,
+    argb8888_scalar<true>,
+    argb8888_scalar<false>,
+};
+
+#if defined(FBCONV_X86_64) || defined(FBCONV_NEON)
+static void argb8888_le_copy(const uint8_t* src, uint32_t* dst, int width) {
+    std::memcpy(dst, src, width * 4);
+}
+#endif
+
+#ifdef FBCONV_X86_64
+
+// ============================== SSE2 converters ============================
+// SSE2 is part of the x86-64 baseline so these need no runtime check.
+
+static inline __m128i expand555_sse2(__m128i c) {
+    __m128i r = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 9), _mm_set1_epi32(0x00F80000)),
+        _mm_and_si128(_mm_slli_epi32(c, 4), _mm_set1_epi32(0x00070000)));
+    __m128i g = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 6), _mm_set1_epi32(0x0000F800)),
+        _mm_and_si128(_mm_slli_epi32(c, 1), _mm_set1_epi32(0x00000700)));
+    __m128i b = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0x000000F8)),
+        _mm_and_si128(_mm_srli_epi32(c, 2), _mm_set1_epi32(0x00000007)));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+static inline __m128i expand565_sse2(__m128i c) {
+    __m128i r = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 8), _mm_set1_epi32(0x00F80000)),
+        _mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0x00070000)));
+    __m128i g = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 5), _mm_set1_epi32(0x0000FC00)),
+        _mm_and_si128(_mm_srli_epi32(c, 1), _mm_set1_epi32(0x00000300)));
+    __m128i b = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0x000000F8)),
+        _mm_and_si128(_mm_srli_epi32(c, 2), _mm_set1_epi32(0x00000007)));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+template <bool big_endian, bool is_565>
+static void rgb16_sse2(const uint8_t* src, uint32_t* dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 2));
+        if (big_endian)
+            px = _mm_or_si128(_mm_slli_epi16(px, 8), _mm_srli_epi16(px, 8));
+        __m128i lo = _mm_unpacklo_epi16(px, zero);
+        __m128i hi = _mm_unpackhi_epi16(px, zero);
+        _mm_storeu_si128((__m128i*)(dst + x),
+                         is_565 ? expand565_sse2(lo) : expand555_sse2(lo));
+        _mm_storeu_si128((__m128i*)(dst + x + 4),
+                         is_565 ? expand565_sse2(hi) : expand555_sse2(hi));
+    }
+
+    if (is_565)
+        rgb565_scalar<big_endian>(src + x * 2, dst + x, width - x);
+    else
+        rgb555_scalar<big_endian>(src + x * 2, dst + x, width - x);
+}
+
+static void argb8888_be_sse2(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        // swap bytes within each DWORD: first swap bytes in words, then words
+        px = _mm_or_si128(_mm_slli_epi16(px, 8), _mm_srli_epi16(px, 8));
+        px = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xB1), 0xB1);
+        _mm_storeu_si128((__m128i*)(dst + x), px);
+    }
+
+    argb8888_scalar<true>(src + x * 4, dst + x, width - x);
+}
+
+// ============================= SSSE3 converters ============================
+
+FBCONV_TARGET("ssse3")
+static void argb8888_be_ssse3(const uint8_t* src, uint32_t* dst, int width) {
+    const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8,
+                                        15, 14, 13, 12);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_shuffle_epi8(px, bswap));
+    }
+
+    argb8888_scalar<true>(src + x * 4, dst + x, width - x);
+}
+
+FBCONV_TARGET("ssse3")
+static void rgb888_ssse3(const uint8_t* src, uint32_t* dst, int width) {
+    // R,G,B triplets -> B,G,R,0 quadruplets
+    const __m128i expand = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1,
+                                         11, 10, 9, -1);
+    int x = 0;
+
+    // each step consumes 12 bytes but loads 16 so stay clear of the row end
+    for (; x + 6 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 3));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_shuffle_epi8(px, expand));
+    }
+
+    rgb888_scalar(src + x * 3, dst + x, width - x);
+}
+
+// ============================== AVX2 converters ============================
+
+FBCONV_TARGET("avx2")
+static inline __m256i expand555_avx2(__m256i c) {
+    __m256i r = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 9), _mm256_set1_epi32(0x00F80000)),
+        _mm256_and_si256(_mm256_slli_epi32(c, 4), _mm256_set1_epi32(0x00070000)));
+    __m256i g = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 6), _mm256_set1_epi32(0x0000F800)),
+        _mm256_and_si256(_mm256_slli_epi32(c, 1), _mm256_set1_epi32(0x00000700)));
+    __m256i b = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0x000000F8)),
+        _mm256_and_si256(_mm256_srli_epi32(c, 2), _mm256_set1_epi32(0x00000007)));
+    return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+FBCONV_TARGET("avx2")
+static inline __m256i expand565_avx2(__m256i c) {
+    __m256i r = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 8), _mm256_set1_epi32(0x00F80000)),
+        _mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0x00070000)));
+    __m256i g = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 5), _mm256_set1_epi32(0x0000FC00)),
+        _mm256_and_si256(_mm256_srli_epi32(c, 1), _mm256_set1_epi32(0x00000300)));
+    __m256i b = _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0x000000F8)),
+        _mm256_and_si256(_mm256_srli_epi32(c, 2), _mm256_set1_epi32(0x00000007)));
+    return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+template <bool big_endian, bool is_565>
+FBCONV_TARGET("avx2")
+static void rgb16_avx2(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 2));
+        if (big_endian)
+            px = _mm_or_si128(_mm_slli_epi16(px, 8), _mm_srli_epi16(px, 8));
+        __m256i c = _mm256_cvtepu16_epi32(px);
+        _mm256_storeu_si256((__m256i*)(dst + x),
+                            is_565 ? expand565_avx2(c) : expand555_avx2(c));
+    }
+
+    if (is_565)
+        rgb565_scalar<big_endian>(src + x * 2, dst + x, width - x);
+    else
+        rgb555_scalar<big_endian>(src + x * 2, dst + x, width - x);
+}
+
+FBCONV_TARGET("avx2")
+static void argb8888_be_avx2(const uint8_t* src, uint32_t* dst, int width) {
+    const __m256i bswap = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_shuffle_epi8(px, bswap));
+    }
+
+    argb8888_scalar<true>(src + x * 4, dst + x, width - x);
+}
+
+FBCONV_TARGET("avx2")
+static void indexed_8bpp_avx2(const uint8_t* src, uint32_t* dst, int width,
+                              const uint32_t* palette) {
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + x)));
+        __m256i px  = _mm256_i32gather_epi32((const int*)palette, idx, 4);
+        _mm256_storeu_si256((__m256i*)(dst + x), px);
+    }
+
+    indexed_8bpp_scalar(src + x, dst + x, width - x, palette);
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static bool cpu_has_ssse3() {
+    int regs[4];
+    __cpuid(regs, 1);
+    return regs[2] & (1 << 9);
+}
+
+static bool cpu_has_avx2() {
+    int regs[4];
+    __cpuid(regs, 1);
+    // AVX state must be enabled by the OS
+    if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(regs, 7, 0);
+    return regs[1] & (1 << 5);
+}
+#else
+static bool cpu_has_ssse3() {
+    return __builtin_cpu_supports("ssse3");
+}
+
+static bool cpu_has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif // FBCONV_X86_64
+
+#ifdef FBCONV_NEON
+
+// ============================== NEON converters ============================
+
+static inline uint32x4_t expand555_neon(uint32x4_t c) {
+    uint32x4_t r = vorrq_u32(vandq_u32(vshlq_n_u32(c, 9), vdupq_n_u32(0x00F80000)),
+                             vandq_u32(vshlq_n_u32(c, 4), vdupq_n_u32(0x00070000)));
+    uint32x4_t g = vorrq_u32(vandq_u32(vshlq_n_u32(c, 6), vdupq_n_u32(0x0000F800)),
+                             vandq_u32(vshlq_n_u32(c, 1), vdupq_n_u32(0x00000700)));
+    uint32x4_t b = vorrq_u32(vandq_u32(vshlq_n_u32(c, 3), vdupq_n_u32(0x000000F8)),
+                             vandq_u32(vshrq_n_u32(c, 2), vdupq_n_u32(0x00000007)));
+    return vorrq_u32(vorrq_u32(r, g), b);
+}
+
+static inline uint32x4_t expand565_neon(uint32x4_t c) {
+    uint32x4_t r = vorrq_u32(vandq_u32(vshlq_n_u32(c, 8), vdupq_n_u32(0x00F80000)),
+                             vandq_u32(vshlq_n_u32(c, 3), vdupq_n_u32(0x00070000)));
+    uint32x4_t g = vorrq_u32(vandq_u32(vshlq_n_u32(c, 5), vdupq_n_u32(0x0000FC00)),
+                             vandq_u32(vshrq_n_u32(c, 1), vdupq_n_u32(0x00000300)));
+    uint32x4_t b = vorrq_u32(vandq_u32(vshlq_n_u32(c, 3), vdupq_n_u32(0x000000F8)),
+                             vandq_u32(vshrq_n_u32(c, 2), vdupq_n_u32(0x00000007)));
+    return vorrq_u32(vorrq_u32(r, g), b);
+}
+
+template <bool big_endian, bool is_565>
+static void rgb16_neon(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x16_t bytes = vld1q_u8(src + x * 2);
+        if (big_endian)
+            bytes = vrev16q_u8(bytes);
+        uint16x8_t px = vreinterpretq_u16_u8(bytes);
+        uint32x4_t lo = vmovl_u16(vget_low_u16(px));
+        uint32x4_t hi = vmovl_u16(vget_high_u16(px));
+        vst1q_u32(dst + x,     is_565 ? expand565_neon(lo) : expand555_neon(lo));
+        vst1q_u32(dst + x + 4, is_565 ? expand565_neon(hi) : expand555_neon(hi));
+    }
+
+    if (is_565)
+        rgb565_scalar<big_endian>(src + x * 2, dst + x, width - x);
+    else
+        rgb555_scalar<big_endian>(src + x * 2, dst + x, width - x);
+}
+
+static void rgb888_neon(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x3_t rgb = vld3_u8(src + x * 3);
+        uint8x8x4_t bgra;
+        bgra.val[0] = rgb.val[2];
+        bgra.val[1] = rgb.val[1];
+        bgra.val[2] = rgb.val[0];
+        bgra.val[3] = vdup_n_u8(0);
+        vst4_u8((uint8_t*)(dst + x), bgra);
+    }
+
+    rgb888_scalar(src + x * 3, dst + x, width - x);
+}
+
+static void argb8888_be_neon(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4)
+        vst1q_u32(dst + x, vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src + x * 4))));
+
+    argb8888_scalar<true>(src + x * 4, dst + x, width - x);
+}
+
+#endif // FBCONV_NEON
+
+#if defined(FBCONV_X86_64)
+static RowConverters sse2_converters() {
+    RowConverters rc = scalar_converters;
+
+    rc.name        = "SSE2";
+    rc.rgb555_be   = rgb16_sse2<true,  false>;
+    rc.rgb555_le   = rgb16_sse2<false, false>;
+    rc.rgb565_be   = rgb16_sse2<true,  true>;
+    rc.rgb565_le   = rgb16_sse2<false, true>;
+    rc.argb8888_be = argb8888_be_sse2;
+    rc.argb8888_le = argb8888_le_copy;
+    return rc;
+}
+
+static RowConverters ssse3_converters() {
+    RowConverters rc = sse2_converters();
+
+    rc.name        = "SSSE3";
+    rc.rgb888      = rgb888_ssse3;
+    rc.argb8888_be = argb8888_be_ssse3;
+    return rc;
+}
+
+static RowConverters avx2_converters() {
+    RowConverters rc = ssse3_converters();
+
+    rc.name         = "AVX2";
+    rc.indexed_8bpp = indexed_8bpp_avx2;
+    rc.rgb555_be    = rgb16_avx2<true,  false>;
+    rc.rgb555_le    = rgb16_avx2<false, false>;
+    rc.rgb565_be    = rgb16_avx2<true,  true>;
+    rc.rgb565_le    = rgb16_avx2<false, true>;
+    rc.argb8888_be  = argb8888_be_avx2;
+    return rc;
+}
+#elif defined(FBCONV_NEON)
+static RowConverters neon_converters() {
+    RowConverters rc = scalar_converters;
+
+    rc.name        = "NEON";
+    rc.rgb555_be   = rgb16_neon<true,  false>;
+    rc.rgb555_le   = rgb16_neon<false, false>;
+    rc.rgb565_be   = rgb16_neon<true,  true>;
+    rc.rgb565_le   = rgb16_neon<false, true>;
+    rc.rgb888      = rgb888_neon;
+    rc.argb8888_be = argb8888_be_neon;
+    rc.argb8888_le = argb8888_le_copy;
+    return rc;
+}
+#endif
+
+std::vector<RowConverters> FbConvert::get_supported_row_converters() {
+    std::vector<RowConverters> tiers;
+
+#if defined(FBCONV_X86_64)
+    tiers.push_back(sse2_converters());
+    if (cpu_has_ssse3()) {
+        tiers.push_back(ssse3_converters());
+        if (cpu_has_avx2())
+            tiers.push_back(avx2_converters());
+    }
+#elif defined(FBCONV_NEON)
+    tiers.push_back(neon_converters());
+#endif
+
+    return tiers;
+}
+
+static RowConverters select_row_converters() {
+    std::vector<RowConverters> tiers = FbConvert::get_supported_row_converters();
+    RowConverters rc = tiers.empty() ? scalar_converters : tiers.back();
+
+    LOG_F(INFO, "Using %s framebuffer converters", rc.name);
+
+    return rc;
+}
+
+const RowConverters& FbConvert::get_row_converters() {
+    static const RowConverters converters = select_row_converters();
+    return converters;
+}
+
+const RowConverters& FbConvert::get_scalar_row_converters() {
+    return scalar_converters;
+}
@@ -0,0 +1,64 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Framebuffer row converters.
+
+    Each converter turns one row of guest pixels into host ARGB8888 pixels.
+    Vectorized variants are selected at runtime according to the host CPU
+    and produce exactly the same output as the scalar ones.
+ */
+
+#ifndef FB_CONVERT_H
+#define FB_CONVERT_H
+
+#include <cinttypes>
+#include <vector>
+
+namespace FbConvert {
+
+typedef void (*RowConvFn)(const uint8_t* src, uint32_t* dst, int width);
+typedef void (*IndexedRowConvFn)(const uint8_t* src, uint32_t* dst, int width,
+                                 const uint32_t* palette);
+
+struct RowConverters {
+    const char*         name;
+    IndexedRowConvFn    indexed_8bpp;
+    RowConvFn           rgb555_be;
+    RowConvFn           rgb555_le;
+    RowConvFn           rgb565_be;
+    RowConvFn           rgb565_le;
+    RowConvFn           rgb888;
+    RowConvFn           argb8888_be;
+    RowConvFn           argb8888_le;
+};
+
+// converters best suited for the host CPU
+const RowConverters& get_row_converters();
+
+// portable reference implementation
+const RowConverters& get_scalar_row_converters();
+
+// vectorized variants usable on the host CPU, the best one last
+std::vector<RowConverters> get_supported_row_converters();
+
+} // namespace FbConvert
+
+#endif // FB_CONVERT_H
@@ -24,10 +24,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/memaccess.h>
 #include <core/timermanager.h>
 #include <devices/common/hwinterrupt.h>
+#include <devices/video/fbconvert.h>
 #include <devices/video/videoctrl.h>
 #include <devices/memctrl/memctrlbase.h>
 
+#include <algorithm>
 #include <cinttypes>
+#include <cstring>
 
 VideoCtrlBase::VideoCtrlBase(int width, int height)
 {
@@ -65,6 +68,13 @@ void VideoCtrlBase::blank_display() {
 
 void VideoCtrlBase::update_screen()
 {
+    if (!this->display.keeps_frames()) {
+        // nothing is going to look at the frame, don't convert it
+        this->draw_fb = false;
+        this->dirty_top = this->dirty_bottom = 0;
+        return;
+    }
+
     if (this->blank_on) {
         this->display.blank();
         return;
@@ -76,16 +86,36 @@ void VideoCtrlBase::update_screen()
         this->get_cursor_position(cursor_x, cursor_y);
     }
 
-    if (this->draw_fb) {
+    if (this->fb_shadow_compare)
+        this->scan_fb_changes();
+
+    int first_row = 0, num_rows = 0;
+
+    // convert only the modified rows unless the whole frame needs redrawing
+    if (!this->draw_fb && this->dirty_bottom > this->dirty_top) {
+        if (this->cursor_ovl_cb != nullptr || this->display.needs_full_update()) {
+            this->draw_fb = true;
+        } else {
+            first_row = this->dirty_top;
+            num_rows  = std::min(this->dirty_bottom, this->active_height) - first_row;
+        }
+    }
+
+    this->dirty_top = this->dirty_bottom = 0;
+
+    if (this->draw_fb || num_rows > 0) {
         if (this->cursor_dirty) {
             this->setup_hw_cursor();
             this->cursor_dirty = false;
         }
+        this->upd_first_row = first_row;
+        this->upd_num_rows  = this->draw_fb ? 0 : num_rows;
         this->display.update(
             this->convert_fb_cb, this->cursor_ovl_cb,
             this->cursor_on, cursor_x, cursor_y,
-            this->draw_fb_is_dynamic);
-    } else if (this->draw_fb_is_dynamic) {
+            this->draw_fb_is_dynamic, this->upd_first_row, this->upd_num_rows);
+        this->upd_first_row = this->upd_num_rows = 0;
+    } else {
         this->display.update_skipped();
     }
 }
@@ -94,6 +124,68 @@ void VideoCtrlBase::set_draw_fb() {
     this->draw_fb = true;
 }
 
+/* Record that the guest has written size bytes at addr in video memory.
+   Only the affected framebuffer rows will be converted on the next update;
+   writes outside of the visible framebuffer don't trigger any update. */
+void VideoCtrlBase::mark_fb_dirty(const uint8_t* addr, uint32_t size)
+{
+    if (this->draw_fb)
+        return; // the whole frame will be redrawn anyway
+
+    if (this->fb_ptr == nullptr || this->fb_pitch <= 0) {
+        this->draw_fb = true;
+        return;
+    }
+
+    int64_t start  = addr - this->fb_ptr;
+    int64_t fb_end = int64_t(this->fb_pitch) * this->active_height;
+
+    if (start + size <= 0 || start >= fb_end)
+        return;
+
+    int first_row = start < 0 ? 0 : int(start / this->fb_pitch);
+    int last_row  = int(std::min(start + size, fb_end) - 1) / this->fb_pitch;
+
+    if (this->dirty_bottom > this->dirty_top) {
+        this->dirty_top    = std::min(this->dirty_top, first_row);
+        this->dirty_bottom = std::max(this->dirty_bottom, last_row + 1);
+    } else {
+        this->dirty_top    = first_row;
+        this->dirty_bottom = last_row + 1;
+    }
+}
+
+/* Find framebuffer rows that differ from the shadow copy and mark them dirty.
+   The shadow copy is refreshed whenever the whole frame is going to be
+   redrawn so it always matches what the display shows. */
+void VideoCtrlBase::scan_fb_changes()
+{
+    if (this->fb_ptr == nullptr || this->fb_pitch <= 0) {
+        this->draw_fb = true;
+        return;
+    }
+
+    size_t fb_size = size_t(this->fb_pitch) * this->active_height;
+
+    if (this->draw_fb || this->fb_shadow.size() != fb_size) {
+        this->fb_shadow.assign(this->fb_ptr, this->fb_ptr + fb_size);
+        this->draw_fb = true;
+        return;
+    }
+
+    const uint8_t* src_row    = this->fb_ptr;
+    uint8_t*       shadow_row = this->fb_shadow.data();
+
+    for (int row = 0; row < this->active_height; row++) {
+        if (std::memcmp(src_row, shadow_row, this->fb_pitch)) {
+            std::memcpy(shadow_row, src_row, this->fb_pitch);
+            this->mark_fb_dirty(src_row, this->fb_pitch);
+        }
+        src_row    += this->fb_pitch;
+        shadow_row += this->fb_pitch;
+    }
+}
+
 void VideoCtrlBase::set_cursor_dirty() {
     this->cursor_dirty = true;
 }
@@ -170,9 +262,12 @@ void VideoCtrlBase::convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     src_pitch = this->fb_pitch - ((this->active_width + 7) >> 3);
     dst_pitch = dst_pitch - 4 * this->active_width;
 
-    src_row = this->fb_ptr - 1;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
+
+    src_row = this->fb_ptr + first_row * this->fb_pitch - 1;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = num_rows; h > 0; h--) {
         uint8_t bit = 0x00;
         uint8_t c;
         for (int x = this->active_width; x > 0; x--) {
@@ -198,9 +293,12 @@ void VideoCtrlBase::convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     src_pitch = this->fb_pitch - (this->active_width >> 2);
     dst_pitch = dst_pitch - 4 * this->active_width;
 
-    src_row = this->fb_ptr;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
+
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = num_rows; h > 0; h--) {
         uint8_t c;
         for (int x = this->active_width >> 2; x > 0; x--) {
             c = *src_row;
@@ -227,9 +325,12 @@ void VideoCtrlBase::convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     src_pitch = this->fb_pitch - (this->active_width >> 1);
     dst_pitch = dst_pitch - 4 * this->active_width;
 
-    src_row = this->fb_ptr;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
+
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = num_rows; h > 0; h--) {
         uint8_t c;
         for (int x = this->active_width >> 1; x > 0; x--) {
             c = *src_row;
@@ -246,20 +347,17 @@ void VideoCtrlBase::convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch)
 
 void VideoCtrlBase::convert_frame_8bpp_indexed(uint8_t *dst_buf, int dst_pitch)
 {
+    const FbConvert::RowConverters& conv = FbConvert::get_row_converters();
     uint8_t *src_row, *dst_row;
-    int     src_pitch;
 
-    src_pitch = this->fb_pitch - this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
 
-    src_row = this->fb_ptr;
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            FB_WRITE(dst_row, this->palette[*src_row++]);
-            dst_row += 4;
-        }
-        src_row += src_pitch;
+    for (int h = num_rows; h > 0; h--) {
+        conv.indexed_8bpp(src_row, (uint32_t*)dst_row, this->active_width, this->palette);
+        src_row += this->fb_pitch;
         dst_row += dst_pitch;
     }
 }
@@ -301,9 +399,12 @@ void VideoCtrlBase::convert_frame_8bpp(uint8_t *dst_buf, int dst_pitch)
     src_pitch = this->fb_pitch - this->active_width;
     dst_pitch = dst_pitch - 4 * this->active_width;
 
-    src_row = this->fb_ptr;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
+
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = num_rows; h > 0; h--) {
         for (int x = this->active_width; x > 0; x--) {
             uint32_t c = *src_row++;
             uint32_t r = ((c << 16) & 0x00E00000) | ((c << 13) & 0x001C0000) | ((c << 10) & 0x00030000);
@@ -335,25 +436,18 @@ void VideoCtrlBase::convert_frame_15bpp(uint8_t *dst_buf, int dst_pitch, bool sw
     }
 #endif
 
+    const FbConvert::RowConverters& conv = FbConvert::get_row_converters();
+    FbConvert::RowConvFn conv_row = (endian == BE) ? conv.rgb555_be : conv.rgb555_le;
     uint8_t *src_row, *dst_row;
-    int     src_pitch;
 
-    src_pitch = this->fb_pitch - 2 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
 
-    src_row = this->fb_ptr;
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            uint32_t c = (endian == BE) ? READ_WORD_BE_A(src_row) : READ_WORD_LE_A(src_row);
-            uint32_t r = ((c << 9) & 0x00F80000) | ((c << 4) & 0x00070000);
-            uint32_t g = ((c << 6) & 0x0000F800) | ((c << 1) & 0x00000700);
-            uint32_t b = ((c << 3) & 0x000000F8) | ((c >> 2) & 0x00000007);
-            FB_WRITE(dst_row, r | g | b);
-            src_row += 2;
-            dst_row += 4;
-        }
-        src_row += src_pitch;
+    for (int h = num_rows; h > 0; h--) {
+        conv_row(src_row, (uint32_t*)dst_row, this->active_width);
+        src_row += this->fb_pitch;
         dst_row += dst_pitch;
     }
 }
@@ -371,25 +465,18 @@ void VideoCtrlBase::convert_frame_16bpp(uint8_t *dst_buf, int dst_pitch, bool sw
     }
 #endif
 
+    const FbConvert::RowConverters& conv = FbConvert::get_row_converters();
+    FbConvert::RowConvFn conv_row = (endian == BE) ? conv.rgb565_be : conv.rgb565_le;
     uint8_t *src_row, *dst_row;
-    int     src_pitch;
 
-    src_pitch = this->fb_pitch - 2 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
 
-    src_row = this->fb_ptr;
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            uint32_t c = (endian == BE) ? READ_WORD_BE_A(src_row) : READ_WORD_LE_A(src_row);
-            uint32_t r = ((c << 8) & 0x00F80000) | ((c << 3) & 0x00070000);
-            uint32_t g = ((c << 5) & 0x0000FC00) | ((c >> 1) & 0x00000300);
-            uint32_t b = ((c << 3) & 0x000000F8) | ((c >> 2) & 0x00000007);
-            FB_WRITE(dst_row, r | g | b);
-            src_row += 2;
-            dst_row += 4;
-        }
-        src_row += src_pitch;
+    for (int h = num_rows; h > 0; h--) {
+        conv_row(src_row, (uint32_t*)dst_row, this->active_width);
+        src_row += this->fb_pitch;
         dst_row += dst_pitch;
     }
 }
@@ -400,22 +487,17 @@ template void VideoCtrlBase::convert_frame_16bpp<VideoCtrlBase::LE>(uint8_t *dst
 // RGB888
 void VideoCtrlBase::convert_frame_24bpp(uint8_t *dst_buf, int dst_pitch)
 {
+    const FbConvert::RowConverters& conv = FbConvert::get_row_converters();
     uint8_t *src_row, *dst_row;
-    int     src_pitch;
 
-    src_pitch = this->fb_pitch - 3 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
 
-    src_row = this->fb_ptr;
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            uint32_t c = (src_row[0] << 16) | (src_row[1] << 8) | src_row[2];
-            FB_WRITE(dst_row, c);
-            src_row += 3;
-            dst_row += 4;
-        }
-        src_row += src_pitch;
+    for (int h = num_rows; h > 0; h--) {
+        conv.rgb888(src_row, (uint32_t*)dst_row, this->active_width);
+        src_row += this->fb_pitch;
         dst_row += dst_pitch;
     }
 }
@@ -431,23 +513,19 @@ void VideoCtrlBase::convert_frame_32bpp(uint8_t *dst_buf, int dst_pitch, bool sw
     }
 #endif
 
-    uint32_t *src_row, *dst_row;
-    int     src_pitch;
+    const FbConvert::RowConverters& conv = FbConvert::get_row_converters();
+    FbConvert::RowConvFn conv_row = (endian == BE) ? conv.argb8888_be : conv.argb8888_le;
+    uint8_t *src_row, *dst_row;
 
-    src_pitch = this->fb_pitch - 4 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    int first_row, num_rows;
+    this->get_update_rows(first_row, num_rows);
 
-    src_row = (uint32_t*)this->fb_ptr;
-    dst_row = (uint32_t*)dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            uint32_t c = (endian == BE) ? READ_DWORD_BE_A(src_row) : READ_DWORD_LE_A(src_row);
-            FB_WRITE(dst_row, c);
-            src_row++;
-            dst_row++;
-        }
-        src_row = (uint32_t*)((uint8_t*)src_row + src_pitch);
-        dst_row = (uint32_t*)((uint8_t*)dst_row + dst_pitch);
+    src_row = this->fb_ptr + first_row * this->fb_pitch;
+    dst_row = dst_buf;
+    for (int h = num_rows; h > 0; h--) {
+        conv_row(src_row, (uint32_t*)dst_row, this->active_width);
+        src_row += this->fb_pitch;
+        dst_row += dst_pitch;
     }
 }
 template void VideoCtrlBase::convert_frame_32bpp<VideoCtrlBase::BE>(uint8_t *dst_buf, int dst_pitch, bool swapper);
@@ -29,6 +29,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <cinttypes>
 #include <functional>
+#include <vector>
 
 class WindowEvent;
 
@@ -47,6 +48,8 @@ public:
     void blank_display();
     void update_screen(void);
     void set_draw_fb();
+    void mark_fb_dirty(const uint8_t* addr, uint32_t size);
+    void scan_fb_changes();
     void set_cursor_dirty();
 
     void start_refresh_task();
@@ -108,6 +111,31 @@ protected:
     bool        draw_fb = true;
     bool        draw_fb_is_dynamic = false;
 
+    // Framebuffer rows modified since the last update, see mark_fb_dirty().
+    // The range is empty when dirty_top == dirty_bottom.
+    int         dirty_top = 0;
+    int         dirty_bottom = 0;
+
+    // Implementations that map the framebuffer straight into the guest address
+    // space can't see guest writes. They set fb_shadow_compare instead so that
+    // each update compares the visible framebuffer against a shadow copy.
+    bool        fb_shadow_compare = false;
+    std::vector<uint8_t> fb_shadow;
+
+    // rows the frame converters process, all rows when upd_num_rows is zero
+    int         upd_first_row = 0;
+    int         upd_num_rows = 0;
+
+    void get_update_rows(int& first_row, int& num_rows) {
+        if (this->upd_num_rows) {
+            first_row = this->upd_first_row;
+            num_rows  = this->upd_num_rows;
+        } else {
+            first_row = 0;
+            num_rows  = this->active_height;
+        }
+    }
+
     uint32_t    palette[256] = {0}; // internal DAC palette in RGBA format
 
     // Framebuffer parameters
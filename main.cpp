@@ -29,8 +29,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <cpu/ppc/ppcmmu.h>
 #include <debugger/debugger.h>
 #include <devices/common/ofnvram.h>
+#include <devices/video/display.h>
 #include <machines/machinebase.h>
 #include <machines/machinefactory.h>
+#include <utils/cmpimg.h>
+#include <utils/imgfile.h>
 #include <utils/profiler.h>
 #include <main.h>
 
@@ -56,6 +59,12 @@ static void sigint_handler(int signum) {
     power_off(po_signal_interrupt);
 }
 
+#ifdef SIGUSR1
+static void sigusr1_handler(int signum) {
+    Display::request_frame_dump();
+}
+#endif
+
 static void sigabrt_handler(int signum) {
     LOG_F(INFO, "Shutting down...");
 
@@ -116,6 +125,7 @@ int main(int argc, char** argv) {
     bool deterministic_interactive = false;
     string deterministic_mode = "strict";
     string keyboard_string = "Eng_USA";
+    string display_string = "sdl";
 
     const std::map<std::string, int> kbd_map{
         {"Eng_USA", 0}, {"Eng_GBR", 1}, {"Fra_FRA", 10}, {"Deu_DEU", 20},
@@ -143,6 +153,18 @@ int main(int argc, char** argv) {
         "Select deterministic features (strict or interactive)")
         ->needs(deterministic_opt)
         ->check(CLI::IsMember({"strict", "interactive"}));
+    emu->add_flag("--adaptive-time", g_adaptive_time,
+        "Keep virtual time close to host time by calibrating instruction timing")
+        ->excludes(deterministic_opt);
+    auto overlay_discard_opt = emu->add_flag("--overlay-discard", g_overlay_discard,
+        "Keep disk image writes in a temporary overlay that is discarded on exit");
+    emu->add_option("--overlay-dir", g_overlay_dir,
+        "Open disk images read-only and store writes as overlays in this directory")
+        ->check(CLI::ExistingDirectory)
+        ->excludes(overlay_discard_opt);
+    emu->add_option("--block-cache-mb", g_block_cache_mb,
+        "Memory budget of the disk image block cache in MB, 0 disables it")
+        ->check(CLI::Range(0, 4096));
 
     bool              log_to_stderr = false;
     loguru::Verbosity log_verbosity = loguru::Verbosity_INFO;
@@ -160,10 +182,23 @@ int main(int argc, char** argv) {
         ->take_all();
 
     uint32_t profiling_interval_ms = 0;
-#ifdef CPU_PROFILING
     emu->add_option("--profiling-interval-ms", profiling_interval_ms,
-        "Specifies periodic interval (in ms) at which to output CPU profiling information");
-#endif
+        "Specifies periodic interval (in ms) at which to output profiling information");
+    emu->add_flag("--mmu-stats", mmu_stats_enabled,
+        "Collect MMU and SoftTLB statistics (profiles PPC:MMU and PPC:MMU:TLB)");
+
+    uint32_t tlb1_size = TLB1_DEF_SIZE;
+    uint32_t tlb2_sets = TLB2_DEF_SETS;
+    uint32_t tlb2_ways = TLB2_DEF_WAYS;
+    emu->add_option("--tlb-size", tlb1_size,
+        "Number of entries in each primary SoftTLB (power of two)")
+        ->check(CLI::Range(TLB_MIN_SIZE, TLB_MAX_SIZE))->capture_default_str();
+    emu->add_option("--tlb2-sets", tlb2_sets,
+        "Number of sets in each secondary SoftTLB (power of two)")
+        ->check(CLI::Range(TLB_MIN_SIZE, TLB_MAX_SIZE))->capture_default_str();
+    emu->add_option("--tlb2-ways", tlb2_ways,
+        "Associativity of the secondary SoftTLB (power of two)")
+        ->check(CLI::Range(1U, TLB2_MAX_WAYS))->capture_default_str();
 
     string       machine_str;
     CLI::Option* machine_opt = emu->add_option("-m,--machine",
@@ -173,6 +208,15 @@ int main(int argc, char** argv) {
         "The guest cursor causes mouse to be grabbed");
     emu->add_flag("--swap-command-option", g_swap_command_option,
         "Swap the Command and Option keys (physical Alt/AltGr becomes Command)");
+    emu->add_option("--display", display_string,
+        "Host display: sdl window, offscreen (host memory only) or none")
+        ->check(CLI::IsMember({"sdl", "offscreen", "none"}))->capture_default_str();
+    auto dump_frames_opt = emu->add_option("--dump-frames", g_frame_dump_interval,
+        "Dump every Nth frame of the offscreen display to a PPM file")
+        ->check(CLI::Number);
+    auto dump_prefix_opt = emu->add_option("--dump-prefix", g_frame_dump_prefix,
+        "Path prefix of offscreen frame dumps (SIGUSR1 dumps the next frame)")
+        ->capture_default_str();
 
     auto list_cmd = app.add_subcommand("list",
         "Display available machine configurations and exit");
@@ -182,6 +226,20 @@ int main(int argc, char** argv) {
     list_cmd->add_option("machines", sub_arg, "List supported machines");
     list_cmd->add_option("properties", sub_arg, "List available properties");
 
+    auto compress_cmd = app.add_subcommand("compress",
+        "Convert a raw disk image into a compressed read-only image and exit");
+
+    string compress_src, compress_dst;
+    uint32_t compress_chunk_kb = CMP_DEF_CHUNK_SIZE / 1024;
+
+    compress_cmd->add_option("input", compress_src, "Raw image to convert")
+        ->required()->check(CLI::ExistingFile);
+    compress_cmd->add_option("output", compress_dst, "Compressed image to create")
+        ->required();
+    compress_cmd->add_option("--chunk-kb", compress_chunk_kb,
+        "Size of the independently compressed chunks in KB")
+        ->check(CLI::Range(1u, CMP_MAX_CHUNK_SIZE / 1024))->capture_default_str();
+
     CLI11_PARSE(app, argc, argv);
 
     deterministic_interactive = deterministic_mode == "interactive";
@@ -197,6 +255,28 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    if (*compress_cmd) {
+        return compress_image(compress_src, compress_dst, compress_chunk_kb * 1024) ? 0 : 1;
+    }
+
+    const std::map<std::string, DisplayBackend> display_map{
+        {"sdl", DisplayBackend::sdl}, {"offscreen", DisplayBackend::offscreen},
+        {"none", DisplayBackend::none},
+    };
+
+    g_display_backend = display_map.at(display_string);
+
+    if ((dump_frames_opt->count() || dump_prefix_opt->count()) &&
+            g_display_backend != DisplayBackend::offscreen) {
+        cerr << "Frame dumps require --display=offscreen" << endl;
+        return 1;
+    }
+
+    if (!mmu_set_tlb_geometry(tlb1_size, tlb2_sets, tlb2_ways)) {
+        cerr << "Invalid SoftTLB geometry, sizes must be powers of two" << endl;
+        return 1;
+    }
+
     if (bootrom_opt->count() == 0) {
         // it was not specified on the command line, so validate the default file name.
         std::string msg = bootrom_opt->get_validator()->operator()(bootrom_path);
@@ -310,6 +390,11 @@ int main(int argc, char** argv) {
     // redirect SIGABRT to our own handler
     signal(SIGABRT, sigabrt_handler);
 
+#ifdef SIGUSR1
+    // dump the next frame of offscreen displays on demand
+    signal(SIGUSR1, sigusr1_handler);
+#endif
+
     keyboard_id = kbd_map.at(keyboard_string);
 
     while (true) {
@@ -351,10 +436,7 @@ void run_machine(std::string machine_str, char* rom_data,
     uint32_t execution_mode,
     const std::vector<std::string> &env_vars,
     bool deterministic_interactive,
-    uint32_t
-#ifdef CPU_PROFILING
-     profiling_interval_ms
-#endif
+    uint32_t profiling_interval_ms
 ) {
     if (MachineFactory::create_machine_for_id(machine_str, rom_data, rom_size) < 0) {
         return;
@@ -412,16 +494,20 @@ void run_machine(std::string machine_str, char* rom_data,
     // default Macintosh polling rate of 11 ms
     uint32_t event_timer = TimerManager::get_instance()->add_cyclic_timer(MSECS_TO_NSECS(11), [] {
         EventManager::get_instance()->poll_events();
-    });
+    }, MSECS_TO_NSECS(2));
 
-#ifdef CPU_PROFILING
     uint32_t profiling_timer;
     if (profiling_interval_ms > 0) {
         profiling_timer = TimerManager::get_instance()->add_cyclic_timer(MSECS_TO_NSECS(profiling_interval_ms), [] {
+#ifdef CPU_PROFILING
             gProfilerObj->print_profile("PPC_CPU");
+#endif
+            if (mmu_stats_enabled) {
+                gProfilerObj->print_profile("PPC:MMU");
+                gProfilerObj->print_profile("PPC:MMU:TLB");
+            }
         });
     }
-#endif
 
     switch (execution_mode) {
     case interpreter:
@@ -443,11 +529,9 @@ void run_machine(std::string machine_str, char* rom_data,
 
     LOG_F(INFO, "Cleaning up...");
     TimerManager::get_instance()->cancel_timer(event_timer);
-#ifdef CPU_PROFILING
     if (profiling_interval_ms > 0) {
         TimerManager::get_instance()->cancel_timer(profiling_timer);
     }
-#endif
     if (is_deterministic && !deterministic_interactive) {
         TimerManager::get_instance()->cancel_timer(deterministic_timer);
     }
@@ -22,6 +22,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 /** @file SDL-specific main functions. */
 
 #include <main.h>
+#include <devices/video/display.h>
 #include <loguru.hpp>
 #include <SDL.h>
 
@@ -30,6 +31,15 @@ extern "C" void remap_appkit_menu_shortcuts();
 #endif
 
 bool init() {
+    if (g_display_backend != DisplayBackend::sdl) {
+        // headless: no display server is needed, only the event queue
+        if (SDL_Init(SDL_INIT_EVENTS)) {
+            LOG_F(ERROR, "SDL_Init error: %s", SDL_GetError());
+            return false;
+        }
+        return true;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER)) {
         LOG_F(ERROR, "SDL_Init error: %s", SDL_GetError());
         return false;
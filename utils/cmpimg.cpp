@@ -0,0 +1,256 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Compressed disk image format (DPPCCMP1) and its LZ4 block codec. */
+
+#include <core/memaccess.h>
+#include <utils/cmpimg.h>
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+bool lz4_decode_block(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len) {
+    const uint8_t *ip   = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t       *op   = dst;
+    uint8_t       *oend = dst + dst_len;
+
+    auto read_length = [&](size_t &len) {
+        uint8_t b;
+        do {
+            if (ip >= iend)
+                return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !read_length(lit_len))
+            return false;
+        if (lit_len > size_t(iend - ip) || lit_len > size_t(oend - op))
+            return false;
+        std::memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+
+        // the last sequence consists of literals only
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t match_off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!match_off || match_off > size_t(op - dst))
+            return false;
+
+        size_t match_len = token & 0xF;
+        if (match_len == 15 && !read_length(match_len))
+            return false;
+        match_len += 4;
+        if (match_len > size_t(oend - op))
+            return false;
+
+        // byte-wise copy since the match may overlap the output
+        const uint8_t *match = op - match_off;
+        while (match_len--)
+            *op++ = *match++;
+    }
+
+    return op == oend;
+}
+
+// LZ4 block restrictions: the last match must start at least 12 bytes
+// before the end and the last 5 bytes are always literals
+constexpr size_t LZ4_MF_LIMIT   = 12;
+constexpr size_t LZ4_LAST_LITS  = 5;
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr int    LZ4_HASH_BITS  = 12;
+
+static bool lz4_put_length(uint8_t*& op, const uint8_t* oend, size_t len) {
+    for (; len >= 255; len -= 255) {
+        if (op >= oend)
+            return false;
+        *op++ = 255;
+    }
+    if (op >= oend)
+        return false;
+    *op++ = uint8_t(len);
+    return true;
+}
+
+// emit literals followed by a match, match_len == 0 ends the block
+static bool lz4_put_sequence(uint8_t*& op, const uint8_t* oend, const uint8_t* lit,
+                             size_t lit_len, size_t match_off, size_t match_len) {
+    if (op >= oend)
+        return false;
+    uint8_t* token = op++;
+
+    *token = uint8_t(std::min<size_t>(lit_len, 15) << 4);
+    if (lit_len >= 15 && !lz4_put_length(op, oend, lit_len - 15))
+        return false;
+    if (lit_len > size_t(oend - op))
+        return false;
+    std::memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (!match_len)
+        return true;
+
+    if (oend - op < 2)
+        return false;
+    *op++ = uint8_t(match_off);
+    *op++ = uint8_t(match_off >> 8);
+
+    match_len -= 4;
+    *token |= uint8_t(std::min<size_t>(match_len, 15));
+    return match_len < 15 || lz4_put_length(op, oend, match_len - 15);
+}
+
+size_t lz4_encode_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap) {
+    const uint8_t* ip     = src;
+    const uint8_t* anchor = src;
+    const uint8_t* iend   = src + src_len;
+    uint8_t*       op     = dst;
+    uint8_t*       oend   = dst + dst_cap;
+
+    // greedy matching against the last position seen for each hashed 4-byte sequence
+    std::vector<uint32_t> table(size_t(1) << LZ4_HASH_BITS, 0);
+
+    if (src_len > LZ4_MF_LIMIT) {
+        const uint8_t* mflimit    = iend - LZ4_MF_LIMIT;
+        const uint8_t* matchlimit = iend - LZ4_LAST_LITS;
+
+        while (ip <= mflimit) {
+            uint32_t seq  = READ_DWORD_LE_U(ip);
+            uint32_t hash = (seq * 2654435761U) >> (32 - LZ4_HASH_BITS);
+            const uint8_t* ref = src + table[hash];
+            table[hash] = uint32_t(ip - src);
+
+            if (ref >= ip || size_t(ip - ref) > LZ4_MAX_OFFSET || std::memcmp(ref, ip, 4)) {
+                ip++;
+                continue;
+            }
+
+            const uint8_t* mend = ip + 4;
+            for (const uint8_t* r = ref + 4; mend < matchlimit && *mend == *r; r++)
+                mend++;
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            if (!lz4_put_sequence(op, oend, anchor, ip - anchor, ip - ref, mend - ip))
+                return 0;
+
+            ip = anchor = mend;
+        }
+    }
+
+    if (!lz4_put_sequence(op, oend, anchor, iend - anchor, 0, 0))
+        return 0;
+
+    return op - dst;
+}
+
+bool compress_image(const std::string& src_path, const std::string& dst_path,
+                    uint32_t chunk_size) {
+    if (!chunk_size || chunk_size > CMP_MAX_CHUNK_SIZE) {
+        LOG_F(ERROR, "CompressedImg: invalid chunk size %u", chunk_size);
+        return false;
+    }
+
+    std::ifstream in(src_path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        LOG_F(ERROR, "CompressedImg: could not open %s", src_path.c_str());
+        return false;
+    }
+    uint64_t img_size = in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    uint64_t num_chunks = (img_size + chunk_size - 1) / chunk_size;
+    if (num_chunks >= UINT32_MAX) {
+        LOG_F(ERROR, "CompressedImg: %s needs a larger chunk size", src_path.c_str());
+        return false;
+    }
+
+    std::ofstream out(dst_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOG_F(ERROR, "CompressedImg: could not create %s", dst_path.c_str());
+        return false;
+    }
+
+    uint8_t hdr[CMP_HDR_SIZE];
+    std::memcpy(hdr, CMP_MAGIC, sizeof(CMP_MAGIC));
+    WRITE_DWORD_LE_U(&hdr[8], chunk_size);
+    WRITE_DWORD_LE_U(&hdr[12], uint32_t(num_chunks));
+    WRITE_QWORD_LE_U(&hdr[16], img_size);
+
+    // the index is filled in once all chunk sizes are known
+    std::vector<uint8_t> index((num_chunks + 1) * CMP_INDEX_ENTRY_SIZE);
+    out.write(reinterpret_cast<char*>(hdr), sizeof(hdr));
+    out.write(reinterpret_cast<char*>(index.data()), index.size());
+
+    std::vector<uint8_t> raw(chunk_size);
+    std::vector<uint8_t> packed(chunk_size);
+    uint64_t offset = CMP_HDR_SIZE + index.size();
+
+    for (uint64_t chunk = 0; chunk < num_chunks; chunk++) {
+        size_t len = std::min<uint64_t>(chunk_size, img_size - chunk * chunk_size);
+        if (!in.read(reinterpret_cast<char*>(raw.data()), len)) {
+            LOG_F(ERROR, "CompressedImg: read error in %s", src_path.c_str());
+            return false;
+        }
+
+        WRITE_QWORD_LE_U(&index[chunk * CMP_INDEX_ENTRY_SIZE], offset);
+
+        if (std::all_of(raw.begin(), raw.begin() + len, [](uint8_t b) { return !b; }))
+            continue;
+
+        // a block that doesn't shrink is stored raw
+        size_t packed_len = lz4_encode_block(raw.data(), len, packed.data(), len - 1);
+        if (packed_len)
+            out.write(reinterpret_cast<char*>(packed.data()), packed_len);
+        else
+            out.write(reinterpret_cast<char*>(raw.data()), len);
+        offset += packed_len ? packed_len : len;
+    }
+
+    WRITE_QWORD_LE_U(&index[num_chunks * CMP_INDEX_ENTRY_SIZE], offset);
+    out.seekp(CMP_HDR_SIZE, std::ios::beg);
+    out.write(reinterpret_cast<char*>(index.data()), index.size());
+
+    out.flush();
+    if (!out) {
+        LOG_F(ERROR, "CompressedImg: write error in %s", dst_path.c_str());
+        return false;
+    }
+    return true;
+}
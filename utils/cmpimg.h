@@ -0,0 +1,56 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Compressed disk image format (DPPCCMP1) and its LZ4 block codec. */
+
+#ifndef CMPIMG_H
+#define CMPIMG_H
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+/** File layout (all fields little-endian):
+    - header: magic "DPPCCMP1", chunk size (uint32), chunk count (uint32),
+      uncompressed image size (uint64)
+    - index: chunk count + 1 file offsets (uint64), chunk N occupies
+      [index[N], index[N + 1])
+    - chunk data: a chunk with no stored bytes reads as zeroes, a chunk whose
+      stored size equals its uncompressed size is kept raw, any other chunk is
+      a single LZ4 block.
+ */
+constexpr char     CMP_MAGIC[8]         = {'D', 'P', 'P', 'C', 'C', 'M', 'P', '1'};
+constexpr size_t   CMP_HDR_SIZE         = 24;
+constexpr size_t   CMP_INDEX_ENTRY_SIZE = 8;
+constexpr uint32_t CMP_MAX_CHUNK_SIZE   = 16 * 1024 * 1024;
+constexpr uint32_t CMP_DEF_CHUNK_SIZE   = 64 * 1024;
+
+/** Decode one LZ4 block into exactly dst_len bytes. Returns false on corrupt input. */
+bool lz4_decode_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_len);
+
+/** Encode src as one LZ4 block. Returns the encoded size or 0 if it doesn't fit into dst_cap. */
+size_t lz4_encode_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap);
+
+/** Convert the raw image at src_path into a compressed image at dst_path. */
+bool compress_image(const std::string& src_path, const std::string& dst_path,
+                    uint32_t chunk_size = CMP_DEF_CHUNK_SIZE);
+
+#endif // CMPIMG_H
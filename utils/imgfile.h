@@ -27,9 +27,24 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <cinttypes>
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
 
+// completion callback for asynchronous requests, receives the number of bytes read
+typedef std::function<void(uint64_t)> ImgIoCallback;
+
+// Copy-on-write overlays: when g_overlay_dir is set, disk images are opened
+// read-only and all writes go to a delta file <g_overlay_dir>/<image name>-<hash>.ovl,
+// where hash is derived from the canonical path of the image.
+// With g_overlay_discard, the delta is an anonymous temporary file that
+// vanishes on exit.
+extern std::string g_overlay_dir;
+extern bool        g_overlay_discard;
+
+// memory budget of the block cache shared by all disk images, 0 disables it
+extern uint32_t    g_block_cache_mb;
+
 class ImgFile {
 public:
     ImgFile();
@@ -42,6 +57,18 @@ public:
 
     uint64_t read(void* buf, uint64_t offset, uint64_t length) const;
     uint64_t write(const void* buf, uint64_t offset, uint64_t length);
+
+    // make all preceding writes durable on the host storage
+    void flush();
+
+    // Read on a host I/O worker thread so that the emulation thread doesn't
+    // stall on slow host storage. The callback is invoked on the emulation
+    // thread once the data has arrived. buf must remain valid until then.
+    void read_async(void* buf, uint64_t offset, uint64_t length, ImgIoCallback cb);
+
+    // Wait until the worker threads are done with all asynchronous requests.
+    // Their callbacks may still be queued on the emulation thread.
+    void wait_idle();
 private:
     class Impl; // Holds private fields
     std::unique_ptr<Impl> impl;
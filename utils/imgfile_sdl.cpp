@@ -19,18 +19,32 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <core/memaccess.h>
+#include <core/timermanager.h>
+#include <utils/cmpimg.h>
 #include <utils/imgfile.h>
 #include <loguru.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #if !defined(_WIN32) && \
     (defined(__APPLE__) || defined(__linux__) || defined(__unix__))
 #define DPPC_HAS_PRIVATE_MMAP 1
+#define DPPC_HAS_POSIX_IO     1
 #include <cerrno>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -40,6 +54,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 extern bool is_deterministic;
 
+std::string g_overlay_dir;
+bool        g_overlay_discard = false;
+uint32_t    g_block_cache_mb  = 32;
+
 class ImgFileBackend {
 public:
     virtual ~ImgFileBackend() = default;
@@ -49,25 +67,445 @@ public:
     virtual uint64_t size() const = 0;
     virtual uint64_t read(void *buf, uint64_t offset, uint64_t length) const = 0;
     virtual uint64_t write(const void *buf, uint64_t offset, uint64_t length) = 0;
+    virtual void flush() {}
+
+    // whether reads should go through the shared block cache
+    virtual bool is_cacheable() const { return true; }
+
+    // whether read() may run concurrently with other backend calls
+    virtual bool allows_concurrent_reads() const { return false; }
 };
 
 static std::unique_ptr<ImgFileBackend> make_imgfile_backend(const std::string &img_path);
 
+/** LRU cache of image data blocks shared by all open images. */
+class BlockCache {
+public:
+    static constexpr uint32_t BLK_SIZE = 32768;
+
+    static BlockCache& get_instance() {
+        static BlockCache cache;
+        return cache;
+    }
+
+    static bool enabled() {
+        return g_block_cache_mb != 0;
+    }
+
+    // copy part of a cached block to dst, returns false on a miss
+    bool lookup(uint64_t key, uint8_t *dst, uint32_t offset, uint32_t length) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        auto it = this->map.find(key);
+        if (it == this->map.end())
+            return false;
+        this->lru.splice(this->lru.begin(), this->lru, it->second);
+        std::memcpy(dst, it->second->data.data() + offset, length);
+        return true;
+    }
+
+    bool contains(uint64_t key) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        return this->map.count(key) != 0;
+    }
+
+    void insert(uint64_t key, const uint8_t *src) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        auto it = this->map.find(key);
+        if (it != this->map.end()) {
+            std::memcpy(it->second->data.data(), src, BLK_SIZE);
+            this->lru.splice(this->lru.begin(), this->lru, it->second);
+            return;
+        }
+
+        // recycle the least recently used buffer once the budget is reached
+        std::vector<uint8_t> data;
+        size_t max_blocks = std::max<size_t>(1, (size_t(g_block_cache_mb) << 20) / BLK_SIZE);
+        while (this->map.size() >= max_blocks) {
+            this->map.erase(this->lru.back().key);
+            data = std::move(this->lru.back().data);
+            this->lru.pop_back();
+        }
+
+        data.assign(src, src + BLK_SIZE);
+        this->lru.push_front({key, std::move(data)});
+        this->map[key] = this->lru.begin();
+    }
+
+    // write-through: refresh a cached block without allocating a new one
+    void update(uint64_t key, const uint8_t *src, uint32_t offset, uint32_t length) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        auto it = this->map.find(key);
+        if (it != this->map.end())
+            std::memcpy(it->second->data.data() + offset, src, length);
+    }
+
+private:
+    BlockCache() = default;
+
+    struct CacheEntry {
+        uint64_t                key;
+        std::vector<uint8_t>    data;
+    };
+
+    std::mutex                                                  mtx;
+    std::list<CacheEntry>                                       lru; // most recent first
+    std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> map;
+};
+
 class ImgFile::Impl {
 public:
     std::unique_ptr<ImgFileBackend> backend;
+
+    // serializes backend accesses from the emulation and I/O worker threads
+    std::mutex              mtx;
+    std::condition_variable idle_cv;
+    int                     pending = 0; // number of queued async requests
+
+    // block cache support, cache keys are (cache_id << 40) | block number
+    uint64_t                cache_id  = 0;
+    uint64_t                write_gen = 0; // bumped by every write
+    std::vector<uint8_t>    fill_buf;
+
+    // sequential stream detection for read-ahead
+    uint64_t                seq_next   = UINT64_MAX; // offset following the last read
+    uint32_t                seq_run    = 0;          // number of back-to-back reads
+    uint32_t                ra_window  = 0;          // read-ahead size in blocks
+    uint64_t                ra_end     = 0;          // first block not yet prefetched
+
+    // all methods below must be called with mtx held
+    uint64_t read(void *buf, uint64_t offset, uint64_t length);
+    void     write_through(const void *buf, uint64_t offset, uint64_t length);
+    void     prefetch(uint64_t first_blk, uint64_t num_blks);
+
+    // called by I/O workers without mtx held
+    void     prefetch_unlocked(uint64_t first_blk, uint64_t num_blks);
+
+private:
+    static constexpr uint32_t SEQ_THRESHOLD  = 2;  // reads in a row before read-ahead kicks in
+    static constexpr uint32_t RA_MIN_BLOCKS  = 4;
+    static constexpr uint32_t RA_MAX_BLOCKS  = 32;
+
+    uint64_t cache_key(uint64_t blk) const {
+        return (this->cache_id << 40) | blk;
+    }
+
+    uint64_t fill(uint64_t first_blk, uint64_t num_blks);
+    uint64_t read_blocks(uint8_t *buf, uint64_t first_blk, uint64_t num_blks);
+    void     cache_blocks(const uint8_t *buf, uint64_t first_blk, uint64_t num_blks,
+                          uint64_t got);
+    uint64_t next_missing_run(uint64_t &blk, uint64_t end_blk);
+    void     track_stream(uint64_t offset, uint64_t length);
+    void     schedule_prefetch(uint64_t first_blk, uint64_t num_blks);
 };
 
+/** Pool of host threads executing asynchronous image file requests. */
+class HostIoPool {
+public:
+    static HostIoPool& get_instance() {
+        static HostIoPool pool;
+        return pool;
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lk(this->mtx);
+            if (this->workers.empty()) {
+                for (int i = 0; i < HOST_IO_THREADS; i++)
+                    this->workers.emplace_back(&HostIoPool::worker_loop, this);
+            }
+            this->jobs.push_back(std::move(job));
+        }
+        this->cv.notify_one();
+    }
+
+    ~HostIoPool() {
+        {
+            std::lock_guard<std::mutex> lk(this->mtx);
+            this->stop = true;
+        }
+        this->cv.notify_all();
+        for (auto& w : this->workers)
+            w.join();
+    }
+
+private:
+    static constexpr int HOST_IO_THREADS = 2;
+
+    HostIoPool() = default;
+
+    void worker_loop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(this->mtx);
+                this->cv.wait(lk, [this] { return this->stop || !this->jobs.empty(); });
+                if (this->jobs.empty())
+                    return;
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex                          mtx;
+    std::condition_variable             cv;
+    std::deque<std::function<void()>>   jobs;
+    std::vector<std::thread>            workers;
+    bool                                stop = false;
+};
+
+/* Read image data through the shared block cache. Missing blocks
+   that are adjacent in the request are fetched with a single host read. */
+uint64_t ImgFile::Impl::read(void *buf, uint64_t offset, uint64_t length)
+{
+    if (!BlockCache::enabled() || !this->backend->is_cacheable())
+        return this->backend->read(buf, offset, length);
+
+    BlockCache& cache    = BlockCache::get_instance();
+    uint8_t*    dst      = static_cast<uint8_t *>(buf);
+    uint64_t    img_size = this->backend->size();
+    uint64_t    done     = 0;
+
+    length = std::min(length, offset < img_size ? img_size - offset : 0);
+    if (!length)
+        return 0;
+
+    uint64_t last_blk = (offset + length - 1) / BlockCache::BLK_SIZE;
+
+    while (done < length) {
+        uint64_t pos     = offset + done;
+        uint64_t blk     = pos / BlockCache::BLK_SIZE;
+        uint32_t blk_off = pos % BlockCache::BLK_SIZE;
+        uint32_t len     = std::min<uint64_t>(BlockCache::BLK_SIZE - blk_off, length - done);
+
+        if (cache.lookup(this->cache_key(blk), dst + done, blk_off, len)) {
+            done += len;
+            continue;
+        }
+
+        uint64_t end_blk = blk + 1;
+        while (end_blk <= last_blk && !cache.contains(this->cache_key(end_blk)))
+            end_blk++;
+
+        uint64_t run_end = std::min(end_blk * BlockCache::BLK_SIZE, offset + length);
+        uint64_t avail   = blk * BlockCache::BLK_SIZE + this->fill(blk, end_blk - blk);
+        if (avail <= pos)
+            break;
+
+        uint64_t n = std::min(run_end, avail) - pos;
+        std::memcpy(dst + done, &this->fill_buf[pos - blk * BlockCache::BLK_SIZE], n);
+        done += n;
+        if (avail < run_end)
+            break;
+    }
+
+    this->track_stream(offset, done);
+
+    return done;
+}
+
+// Read whole blocks from the backend into fill_buf and cache them.
+uint64_t ImgFile::Impl::fill(uint64_t first_blk, uint64_t num_blks)
+{
+    this->fill_buf.resize(num_blks * BlockCache::BLK_SIZE);
+
+    uint64_t got = this->read_blocks(this->fill_buf.data(), first_blk, num_blks);
+    this->cache_blocks(this->fill_buf.data(), first_blk, num_blks, got);
+    return got;
+}
+
+// Read whole blocks from the backend, zero-padding past the end of the image.
+uint64_t ImgFile::Impl::read_blocks(uint8_t *buf, uint64_t first_blk, uint64_t num_blks)
+{
+    uint64_t len = num_blks * BlockCache::BLK_SIZE;
+    uint64_t got = this->backend->read(buf, first_blk * BlockCache::BLK_SIZE, len);
+    std::memset(buf + got, 0, len - got);
+    return got;
+}
+
+void ImgFile::Impl::cache_blocks(const uint8_t *buf, uint64_t first_blk, uint64_t num_blks,
+                                 uint64_t got)
+{
+    uint64_t img_size  = this->backend->size();
+    uint64_t valid_end = first_blk * BlockCache::BLK_SIZE + got;
+
+    // the partial block at the end of the image is cached zero-padded
+    for (uint64_t i = 0; i < num_blks; i++) {
+        uint64_t blk_end = (first_blk + i + 1) * BlockCache::BLK_SIZE;
+        if (blk_end > valid_end && valid_end < img_size)
+            break;
+        if (blk_end - BlockCache::BLK_SIZE >= valid_end)
+            break;
+        BlockCache::get_instance().insert(this->cache_key(first_blk + i),
+                                          &buf[i * BlockCache::BLK_SIZE]);
+    }
+}
+
+// Advance blk to the next uncached block and return the number of
+// uncached blocks following it, 0 once end_blk is reached.
+uint64_t ImgFile::Impl::next_missing_run(uint64_t &blk, uint64_t end_blk)
+{
+    BlockCache& cache = BlockCache::get_instance();
+
+    while (blk < end_blk && cache.contains(this->cache_key(blk)))
+        blk++;
+
+    uint64_t run_end = blk;
+    while (run_end < end_blk && !cache.contains(this->cache_key(run_end)))
+        run_end++;
+
+    return run_end - blk;
+}
+
+void ImgFile::Impl::prefetch(uint64_t first_blk, uint64_t num_blks)
+{
+    uint64_t img_blks = (this->backend->size() + BlockCache::BLK_SIZE - 1) / BlockCache::BLK_SIZE;
+    uint64_t end_blk  = std::min(first_blk + num_blks, img_blks);
+
+    for (uint64_t blk = first_blk, n; (n = this->next_missing_run(blk, end_blk)); blk += n) {
+        if (this->fill(blk, n) < n * BlockCache::BLK_SIZE)
+            break;
+    }
+}
+
+/* Prefetch without holding mtx while the backend reads, so that the
+   emulation thread isn't stalled on the same image meanwhile. The backend
+   stays open because close() waits for pending requests. Data read while
+   a write was in progress may be stale and isn't cached. */
+void ImgFile::Impl::prefetch_unlocked(uint64_t first_blk, uint64_t num_blks)
+{
+    uint64_t end_blk;
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        if (!this->backend)
+            return;
+        if (!this->backend->allows_concurrent_reads()) {
+            this->prefetch(first_blk, num_blks);
+            return;
+        }
+        uint64_t img_blks = (this->backend->size() + BlockCache::BLK_SIZE - 1) / BlockCache::BLK_SIZE;
+        end_blk = std::min(first_blk + num_blks, img_blks);
+    }
+
+    std::vector<uint8_t> buf;
+
+    for (uint64_t blk = first_blk, n; (n = this->next_missing_run(blk, end_blk)); blk += n) {
+        uint64_t gen;
+        {
+            std::lock_guard<std::mutex> lk(this->mtx);
+            gen = this->write_gen;
+        }
+
+        buf.resize(n * BlockCache::BLK_SIZE);
+        uint64_t got = this->read_blocks(buf.data(), blk, n);
+
+        {
+            std::lock_guard<std::mutex> lk(this->mtx);
+            if (this->write_gen == gen)
+                this->cache_blocks(buf.data(), blk, n, got);
+        }
+
+        if (got < n * BlockCache::BLK_SIZE)
+            break;
+    }
+}
+
+/* Detect reads continuing where the previous one ended and keep
+   a growing window of blocks prefetched ahead of such streams. */
+void ImgFile::Impl::track_stream(uint64_t offset, uint64_t length)
+{
+    if (offset == this->seq_next) {
+        if (this->seq_run < SEQ_THRESHOLD)
+            this->seq_run++;
+    } else {
+        this->seq_run   = 0;
+        this->ra_window = RA_MIN_BLOCKS;
+        this->ra_end    = 0;
+    }
+
+    this->seq_next = offset + length;
+
+    if (this->seq_run < SEQ_THRESHOLD)
+        return;
+
+    uint64_t next_blk = this->seq_next / BlockCache::BLK_SIZE;
+    this->ra_end = std::max(this->ra_end, next_blk);
+
+    // refill once the guest has consumed half of the prefetched window
+    if (this->ra_end - next_blk <= this->ra_window / 2) {
+        this->schedule_prefetch(this->ra_end, this->ra_window);
+        this->ra_end   += this->ra_window;
+        this->ra_window = std::min(this->ra_window * 2, RA_MAX_BLOCKS);
+    }
+}
+
+void ImgFile::Impl::schedule_prefetch(uint64_t first_blk, uint64_t num_blks)
+{
+    // prefetch inline where reads are synchronous anyway
+#ifdef __EMSCRIPTEN__
+    if (true) {
+#else
+    if (is_deterministic) {
+#endif
+        this->prefetch(first_blk, num_blks);
+        return;
+    }
+
+    this->pending++;
+
+    Impl* img = this;
+
+    HostIoPool::get_instance().submit([img, first_blk, num_blks]() {
+        img->prefetch_unlocked(first_blk, num_blks);
+
+        std::lock_guard<std::mutex> lk(img->mtx);
+        if (!--img->pending)
+            img->idle_cv.notify_all();
+    });
+}
+
+void ImgFile::Impl::write_through(const void *buf, uint64_t offset, uint64_t length)
+{
+    if (!BlockCache::enabled() || !this->backend->is_cacheable())
+        return;
+
+    const uint8_t* src  = static_cast<const uint8_t *>(buf);
+    uint64_t       done = 0;
+
+    while (done < length) {
+        uint64_t pos     = offset + done;
+        uint32_t blk_off = pos % BlockCache::BLK_SIZE;
+        uint32_t len     = std::min<uint64_t>(BlockCache::BLK_SIZE - blk_off, length - done);
+        BlockCache::get_instance().update(this->cache_key(pos / BlockCache::BLK_SIZE),
+                                          src + done, blk_off, len);
+        done += len;
+    }
+}
+
 ImgFile::ImgFile(): impl(std::make_unique<Impl>())
 {
 
 }
 
-ImgFile::~ImgFile() = default;
+ImgFile::~ImgFile()
+{
+    // wait for outstanding async requests referencing this object
+    std::unique_lock<std::mutex> lk(impl->mtx);
+    impl->idle_cv.wait(lk, [this] { return !impl->pending; });
+
+    // make pending writes durable on shutdown
+    if (impl->backend)
+        impl->backend->flush();
+}
 
 bool ImgFile::open(const std::string &img_path)
 {
-    impl->backend = make_imgfile_backend(img_path);
+    static std::atomic<uint64_t> next_cache_id{1};
+
+    impl->backend  = make_imgfile_backend(img_path);
+    impl->cache_id = next_cache_id++; // never hit blocks cached for an earlier image
     return !!impl->backend;
 }
 
@@ -77,6 +515,9 @@ void ImgFile::close()
         LOG_F(WARNING, "ImgFile::close before disk was opened, ignoring.");
         return;
     }
+    std::unique_lock<std::mutex> lk(impl->mtx);
+    impl->idle_cv.wait(lk, [this] { return !impl->pending; });
+    impl->backend->flush();
     impl->backend->close();
     impl->backend.reset();
 }
@@ -96,7 +537,8 @@ uint64_t ImgFile::read(void* buf, uint64_t offset, uint64_t length) const
         LOG_F(WARNING, "ImgFile::read before disk was opened, ignoring.");
         return 0;
     }
-    return impl->backend->read(buf, offset, length);
+    std::lock_guard<std::mutex> lk(impl->mtx);
+    return impl->read(buf, offset, length);
 }
 
 uint64_t ImgFile::write(const void* buf, uint64_t offset, uint64_t length)
@@ -105,7 +547,64 @@ uint64_t ImgFile::write(const void* buf, uint64_t offset, uint64_t length)
         LOG_F(WARNING, "ImgFile::write before disk was opened, ignoring.");
         return 0;
     }
-    return impl->backend->write(buf, offset, length);
+    std::lock_guard<std::mutex> lk(impl->mtx);
+    impl->write_gen++;
+    uint64_t written = impl->backend->write(buf, offset, length);
+    impl->write_through(buf, offset, written);
+    return written;
+}
+
+void ImgFile::flush()
+{
+    if (!impl->backend) {
+        LOG_F(WARNING, "ImgFile::flush before disk was opened, ignoring.");
+        return;
+    }
+    std::lock_guard<std::mutex> lk(impl->mtx);
+    impl->backend->flush();
+}
+
+void ImgFile::read_async(void* buf, uint64_t offset, uint64_t length, ImgIoCallback cb)
+{
+    // deterministic mode (or no host threads): read synchronously,
+    // complete at the next timer processing point on the emulation thread
+#ifdef __EMSCRIPTEN__
+    if (true) {
+#else
+    if (is_deterministic || !impl->backend) {
+#endif
+        uint64_t got = this->read(buf, offset, length);
+        TimerManager::get_instance()->add_immediate_timer([cb, got]() { cb(got); });
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(impl->mtx);
+        impl->pending++;
+    }
+
+    Impl* img = impl.get();
+
+    HostIoPool::get_instance().submit([img, buf, offset, length, cb]() {
+        uint64_t got;
+        {
+            std::lock_guard<std::mutex> lk(img->mtx);
+            got = img->read(buf, offset, length);
+        }
+
+        // posted to the emulation thread through the timer mailbox
+        TimerManager::get_instance()->add_immediate_timer([cb, got]() { cb(got); });
+
+        std::lock_guard<std::mutex> lk(img->mtx);
+        if (!--img->pending)
+            img->idle_cv.notify_all();
+    });
+}
+
+void ImgFile::wait_idle()
+{
+    std::unique_lock<std::mutex> lk(impl->mtx);
+    impl->idle_cv.wait(lk, [this] { return !impl->pending; });
 }
 
 class FileStreamBackend : public ImgFileBackend {
@@ -141,9 +640,6 @@ public:
         stream->clear();
         stream->seekp(offset, std::ios::beg);
         stream->write(static_cast<const char *>(buf), length);
-#if defined(WIN32) || defined(__APPLE__) || defined(__linux)
-        stream->flush();
-#endif
         if (!stream->good())
             return 0;
 
@@ -151,11 +647,104 @@ public:
         return length;
     }
 
+    void flush() override {
+        stream->flush();
+    }
+
 private:
     mutable std::unique_ptr<std::fstream> stream;
     uint64_t file_size = 0;
 };
 
+#if DPPC_HAS_POSIX_IO
+/** Disk image accessed with positional reads/writes on a raw descriptor. */
+class PosixFileBackend : public ImgFileBackend {
+public:
+    ~PosixFileBackend() override {
+        close();
+    }
+
+    bool open(const std::string &img_path) override {
+        fd = ::open(img_path.c_str(), O_RDWR);
+        if (fd < 0)
+            return false;
+
+        struct stat st {};
+        if (::fstat(fd, &st) < 0) {
+            close();
+            return false;
+        }
+
+        file_size = st.st_size;
+        return true;
+    }
+
+    void close() override {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    uint64_t size() const override {
+        return file_size;
+    }
+
+    uint64_t read(void *buf, uint64_t offset, uint64_t length) const override {
+        uint64_t done = 0;
+
+        while (done < length) {
+            ssize_t res = ::pread(fd, static_cast<char *>(buf) + done, length - done,
+                                  offset + done);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                LOG_F(ERROR, "ImgFile: read error: %s", std::strerror(errno));
+                break;
+            }
+            if (!res) // end of file
+                break;
+            done += res;
+        }
+
+        return done;
+    }
+
+    uint64_t write(const void *buf, uint64_t offset, uint64_t length) override {
+        uint64_t done = 0;
+
+        while (done < length) {
+            ssize_t res = ::pwrite(fd, static_cast<const char *>(buf) + done,
+                                   length - done, offset + done);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                LOG_F(ERROR, "ImgFile: write error: %s", std::strerror(errno));
+                return 0;
+            }
+            done += res;
+        }
+
+        file_size = std::max(file_size, offset + length);
+        return length;
+    }
+
+    void flush() override {
+        if (fd >= 0 && ::fsync(fd) < 0)
+            LOG_F(ERROR, "ImgFile: fsync failed: %s", std::strerror(errno));
+    }
+
+    // pread() doesn't share a file position with anything else
+    bool allows_concurrent_reads() const override {
+        return true;
+    }
+
+private:
+    int fd = -1;
+    uint64_t file_size = 0;
+};
+#endif
+
 class MemoryStreamBackend : public ImgFileBackend {
 public:
     bool open(const std::string &img_path) override {
@@ -179,6 +768,11 @@ public:
         return file_size;
     }
 
+    // already held in host memory
+    bool is_cacheable() const override {
+        return false;
+    }
+
     uint64_t read(void *buf, uint64_t offset, uint64_t length) const override {
         stream->clear();
         stream->seekg(offset, std::ios::beg);
@@ -245,6 +839,11 @@ public:
         return file_size;
     }
 
+    // already mapped into host memory
+    bool is_cacheable() const override {
+        return false;
+    }
+
     uint64_t read(void *buf, uint64_t offset, uint64_t length) const override {
         std::memcpy(buf, mapping + offset, length);
         return length;
@@ -262,19 +861,503 @@ private:
 };
 #endif
 
+#if DPPC_HAS_POSIX_IO
+/** Copy-on-write overlay over a read-only base image.
+
+    Delta files are named <image name>-<hash of its canonical path>.ovl, so
+    images with the same name in different directories don't share a delta.
+
+    Delta file layout:
+    - header (OVL_HDR_SIZE bytes): magic, block size, base image size and
+      modification time, canonical path of the base image
+    - allocation bitmap, one bit per block, padded to OVL_HDR_SIZE
+    - block data, block N is stored at data_start + N * block size; blocks
+      that were never written are holes so the delta file remains sparse.
+ */
+class OverlayBackend : public ImgFileBackend {
+public:
+    OverlayBackend(const std::string &overlay_dir) : overlay_dir(overlay_dir) {}
+
+    ~OverlayBackend() override {
+        close();
+    }
+
+    bool open(const std::string &img_path) override {
+        base_fd = ::open(img_path.c_str(), O_RDONLY);
+        if (base_fd < 0)
+            return false;
+
+        struct stat st {};
+        if (::fstat(base_fd, &st) < 0) {
+            close();
+            return false;
+        }
+
+        file_size  = st.st_size;
+        base_mtime = st.st_mtime;
+        num_blocks = (file_size + OVL_BLOCK_SIZE - 1) / OVL_BLOCK_SIZE;
+        bitmap.assign((num_blocks + 7) / 8, 0);
+        data_start = OVL_HDR_SIZE + ((bitmap.size() + OVL_HDR_SIZE - 1) & ~(OVL_HDR_SIZE - 1));
+
+        if (overlay_dir.empty())
+            return open_temp_delta();
+
+        std::error_code ec;
+        auto canon_path = std::filesystem::canonical(img_path, ec);
+        if (ec)
+            canon_path = std::filesystem::absolute(img_path);
+        base_path = canon_path.string();
+
+        char hash_str[17];
+        std::snprintf(hash_str, sizeof(hash_str), "%016llx",
+                      (unsigned long long)path_hash(base_path));
+        std::string name = canon_path.filename().string() + "-" + hash_str + ".ovl";
+        return open_delta((std::filesystem::path(overlay_dir) / name).string());
+    }
+
+    void close() override {
+        if (delta_fd >= 0) {
+            ::close(delta_fd);
+            delta_fd = -1;
+        }
+        if (base_fd >= 0) {
+            ::close(base_fd);
+            base_fd = -1;
+        }
+    }
+
+    uint64_t size() const override {
+        return file_size;
+    }
+
+    uint64_t read(void *buf, uint64_t offset, uint64_t length) const override {
+        uint8_t *dst = static_cast<uint8_t *>(buf);
+        uint64_t done = 0;
+
+        length = std::min(length, offset < file_size ? file_size - offset : 0);
+
+        // coalesce runs of blocks coming from the same file
+        while (done < length) {
+            uint64_t pos   = offset + done;
+            uint64_t block = pos / OVL_BLOCK_SIZE;
+            bool     dirty = is_dirty(block);
+            uint64_t end   = (block + 1) * OVL_BLOCK_SIZE;
+
+            while (end < offset + length && is_dirty(end / OVL_BLOCK_SIZE) == dirty)
+                end += OVL_BLOCK_SIZE;
+
+            uint64_t len = std::min(end, offset + length) - pos;
+            uint64_t got = dirty ? pread_full(delta_fd, dst + done, len, data_start + pos)
+                                 : pread_full(base_fd, dst + done, len, pos);
+            done += got;
+            if (got < len)
+                break;
+        }
+
+        return done;
+    }
+
+    uint64_t write(const void *buf, uint64_t offset, uint64_t length) override {
+        const uint8_t *src = static_cast<const uint8_t *>(buf);
+        uint64_t done = 0;
+
+        if (offset + length > file_size) {
+            LOG_F(ERROR, "Overlay: write beyond the end of the base image");
+            return 0;
+        }
+
+        while (done < length) {
+            uint64_t pos   = offset + done;
+            uint64_t block = pos / OVL_BLOCK_SIZE;
+            uint64_t blk_start = block * OVL_BLOCK_SIZE;
+            uint64_t len   = std::min(blk_start + OVL_BLOCK_SIZE - pos, length - done);
+
+            if (!is_dirty(block) && len < OVL_BLOCK_SIZE) {
+                // copy the untouched parts of the block from the base image
+                uint8_t  blk_buf[OVL_BLOCK_SIZE] = {};
+                uint64_t blk_len = std::min<uint64_t>(OVL_BLOCK_SIZE, file_size - blk_start);
+                if (pread_full(base_fd, blk_buf, blk_len, blk_start) != blk_len) {
+                    LOG_F(ERROR, "Overlay: could not read block %llu of the base image",
+                          (unsigned long long)block);
+                    return 0;
+                }
+                std::memcpy(&blk_buf[pos - blk_start], src + done, len);
+                if (!pwrite_full(blk_buf, OVL_BLOCK_SIZE, data_start + blk_start))
+                    return 0;
+            } else if (!pwrite_full(src + done, len, data_start + pos)) {
+                return 0;
+            }
+
+            if (!is_dirty(block))
+                mark_dirty(block);
+
+            done += len;
+        }
+
+        return length;
+    }
+
+    void flush() override {
+        if (delta_fd >= 0 && !overlay_dir.empty() && ::fsync(delta_fd) < 0)
+            LOG_F(ERROR, "Overlay: fsync failed: %s", std::strerror(errno));
+    }
+
+private:
+    static constexpr uint32_t OVL_BLOCK_SIZE = 4096;
+    static constexpr uint64_t OVL_HDR_SIZE   = 4096;
+    static constexpr char     OVL_MAGIC[8]   = {'D', 'P', 'P', 'C', 'O', 'V', 'L', '1'};
+    static constexpr int      OVL_PATH_MAX   = 2048;
+
+    typedef struct {
+        char     magic[8];
+        uint32_t block_size;
+        uint32_t reserved;
+        uint64_t base_size;
+        int64_t  base_mtime;
+        char     base_path[OVL_PATH_MAX]; // zero-terminated, truncated if longer
+    } OverlayHeader;
+
+    static_assert(sizeof(OverlayHeader) <= OVL_HDR_SIZE, "overlay header too big");
+
+    // 64-bit FNV-1a, stable across hosts and runs
+    static uint64_t path_hash(const std::string &path) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (unsigned char c : path) {
+            hash ^= c;
+            hash *= 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    bool is_dirty(uint64_t block) const {
+        return (bitmap[block >> 3] >> (block & 7)) & 1;
+    }
+
+    void mark_dirty(uint64_t block) {
+        bitmap[block >> 3] |= 1 << (block & 7);
+        // persist the updated bitmap byte after the block data
+        if (!overlay_dir.empty())
+            pwrite_full(&bitmap[block >> 3], 1, OVL_HDR_SIZE + (block >> 3));
+    }
+
+    bool open_temp_delta() {
+        std::string tmpl = (std::filesystem::temp_directory_path() / "dppc-ovl-XXXXXX").string();
+        delta_fd = ::mkstemp(tmpl.data());
+        if (delta_fd < 0) {
+            LOG_F(ERROR, "Overlay: could not create temporary file: %s", std::strerror(errno));
+            return false;
+        }
+        // the file disappears as soon as it is closed
+        ::unlink(tmpl.c_str());
+        return true;
+    }
+
+    bool open_delta(const std::string &delta_path) {
+        OverlayHeader hdr {};
+        char          path_buf[OVL_PATH_MAX] = {};
+
+        std::strncpy(path_buf, base_path.c_str(), sizeof(path_buf) - 1);
+
+        delta_fd = ::open(delta_path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (delta_fd < 0) {
+            LOG_F(ERROR, "Overlay: could not open %s: %s", delta_path.c_str(),
+                  std::strerror(errno));
+            return false;
+        }
+
+        uint64_t got = pread_full(delta_fd, &hdr, sizeof(hdr), 0);
+
+        if (got == sizeof(hdr)) {
+            if (std::memcmp(hdr.magic, OVL_MAGIC, sizeof(hdr.magic)) ||
+                hdr.block_size != OVL_BLOCK_SIZE || hdr.base_size != file_size ||
+                std::memcmp(hdr.base_path, path_buf, sizeof(path_buf))) {
+                LOG_F(ERROR, "Overlay: %s doesn't match the base image", delta_path.c_str());
+                return false;
+            }
+            if (hdr.base_mtime != base_mtime)
+                LOG_F(WARNING, "Overlay: base image %s was modified after %s was created",
+                      base_path.c_str(), delta_path.c_str());
+            if (pread_full(delta_fd, bitmap.data(), bitmap.size(), OVL_HDR_SIZE) != bitmap.size()) {
+                LOG_F(ERROR, "Overlay: %s is truncated", delta_path.c_str());
+                return false;
+            }
+            LOG_F(INFO, "Overlay: using %s", delta_path.c_str());
+        } else if (got) {
+            LOG_F(ERROR, "Overlay: %s has a truncated header", delta_path.c_str());
+            return false;
+        } else {
+            std::memcpy(hdr.magic, OVL_MAGIC, sizeof(hdr.magic));
+            hdr.block_size = OVL_BLOCK_SIZE;
+            hdr.base_size  = file_size;
+            hdr.base_mtime = base_mtime;
+            std::memcpy(hdr.base_path, path_buf, sizeof(path_buf));
+            if (!pwrite_full(&hdr, sizeof(hdr), 0) ||
+                !pwrite_full(bitmap.data(), bitmap.size(), OVL_HDR_SIZE))
+                return false;
+            LOG_F(INFO, "Overlay: created %s", delta_path.c_str());
+        }
+
+        return true;
+    }
+
+    // returns the number of bytes read, less than length on EOF or error
+    static uint64_t pread_full(int fd, void *buf, uint64_t length, uint64_t offset) {
+        uint64_t done = 0;
+
+        while (done < length) {
+            ssize_t res = ::pread(fd, static_cast<char *>(buf) + done, length - done,
+                                  offset + done);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                LOG_F(ERROR, "Overlay: read error: %s", std::strerror(errno));
+                break;
+            }
+            if (!res)
+                break;
+            done += res;
+        }
+
+        return done;
+    }
+
+    bool pwrite_full(const void *buf, uint64_t length, uint64_t offset) {
+        uint64_t done = 0;
+
+        while (done < length) {
+            ssize_t res = ::pwrite(delta_fd, static_cast<const char *>(buf) + done,
+                                   length - done, offset + done);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                LOG_F(ERROR, "Overlay: write error: %s", std::strerror(errno));
+                return false;
+            }
+            done += res;
+        }
+
+        return true;
+    }
+
+    std::string             overlay_dir;
+    std::string             base_path;
+    int64_t                 base_mtime = 0;
+    int                     base_fd    = -1;
+    int                     delta_fd   = -1;
+    uint64_t                file_size  = 0;
+    uint64_t                num_blocks = 0;
+    uint64_t                data_start = 0;
+    std::vector<uint8_t>    bitmap;
+};
+#endif
+
+/** Read-only image split into independently compressed chunks,
+    see utils/cmpimg.h for the file layout.
+
+    Recently used chunks are kept decompressed in an LRU cache.
+ */
+class CompressedImgBackend : public ImgFileBackend {
+public:
+    bool open(const std::string &img_path) override {
+        uint8_t hdr[CMP_HDR_SIZE];
+
+        stream = std::make_unique<std::ifstream>(img_path, std::ios::binary | std::ios::ate);
+        if (!stream->is_open())
+            return false;
+        uint64_t stored_size = stream->tellg();
+        stream->seekg(0, std::ios::beg);
+
+        if (!stream->read(reinterpret_cast<char *>(hdr), sizeof(hdr)) ||
+            std::memcmp(hdr, CMP_MAGIC, sizeof(CMP_MAGIC))) {
+            LOG_F(ERROR, "CompressedImg: %s has no valid header", img_path.c_str());
+            return false;
+        }
+
+        chunk_size = READ_DWORD_LE_U(&hdr[8]);
+        num_chunks = READ_DWORD_LE_U(&hdr[12]);
+        file_size  = READ_QWORD_LE_U(&hdr[16]);
+
+        if (!chunk_size || chunk_size > CMP_MAX_CHUNK_SIZE ||
+            num_chunks != (file_size + chunk_size - 1) / chunk_size) {
+            LOG_F(ERROR, "CompressedImg: %s has an invalid geometry", img_path.c_str());
+            return false;
+        }
+
+        // don't trust the chunk count for sizing the index before checking it against the file
+        uint64_t index_size = (uint64_t(num_chunks) + 1) * CMP_INDEX_ENTRY_SIZE;
+        if (index_size > stored_size - CMP_HDR_SIZE) {
+            LOG_F(ERROR, "CompressedImg: %s has a truncated index", img_path.c_str());
+            return false;
+        }
+
+        std::vector<uint8_t> raw_index(index_size);
+        if (!stream->read(reinterpret_cast<char *>(raw_index.data()), raw_index.size())) {
+            LOG_F(ERROR, "CompressedImg: %s has a truncated index", img_path.c_str());
+            return false;
+        }
+
+        index.resize(size_t(num_chunks) + 1);
+        for (uint32_t i = 0; i <= num_chunks; i++) {
+            index[i] = READ_QWORD_LE_U(&raw_index[i * CMP_INDEX_ENTRY_SIZE]);
+            if (index[i] < CMP_HDR_SIZE + index_size || index[i] > stored_size ||
+                (i && index[i] < index[i - 1])) {
+                LOG_F(ERROR, "CompressedImg: %s has a corrupt index", img_path.c_str());
+                return false;
+            }
+        }
+
+        max_cached = std::max<size_t>(1, CMP_CACHE_BYTES / chunk_size);
+        return true;
+    }
+
+    void close() override {
+        stream.reset();
+        cache.clear();
+        lru.clear();
+    }
+
+    uint64_t size() const override {
+        return file_size;
+    }
+
+    // keeps its own cache of decompressed chunks
+    bool is_cacheable() const override {
+        return false;
+    }
+
+    uint64_t read(void *buf, uint64_t offset, uint64_t length) const override {
+        uint8_t *dst  = static_cast<uint8_t *>(buf);
+        uint64_t done = 0;
+
+        length = std::min(length, offset < file_size ? file_size - offset : 0);
+
+        while (done < length) {
+            uint64_t pos       = offset + done;
+            uint32_t chunk     = pos / chunk_size;
+            uint32_t chunk_off = pos % chunk_size;
+            uint64_t len       = std::min<uint64_t>(chunk_size - chunk_off, length - done);
+
+            const uint8_t *data = get_chunk(chunk);
+            if (!data)
+                break;
+
+            std::memcpy(dst + done, data + chunk_off, len);
+            done += len;
+        }
+
+        return done;
+    }
+
+    uint64_t write(const void *buf, uint64_t offset, uint64_t length) override {
+        LOG_F(ERROR, "CompressedImg: image is read-only, write ignored");
+        return 0;
+    }
+
+private:
+    static constexpr size_t CMP_CACHE_BYTES = 8 * 1024 * 1024;
+
+    typedef std::pair<uint32_t, std::vector<uint8_t>> CachedChunk;
+
+    const uint8_t *get_chunk(uint32_t chunk) const {
+        auto it = cache.find(chunk);
+        if (it != cache.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second.data();
+        }
+
+        // recycle the least recently used buffer once the cache is full
+        std::vector<uint8_t> data;
+        if (cache.size() >= max_cached) {
+            cache.erase(lru.back().first);
+            data = std::move(lru.back().second);
+            lru.pop_back();
+        }
+        data.resize(chunk_size);
+
+        if (!load_chunk(chunk, data.data()))
+            return nullptr;
+
+        lru.emplace_front(chunk, std::move(data));
+        cache[chunk] = lru.begin();
+        return lru.front().second.data();
+    }
+
+    bool load_chunk(uint32_t chunk, uint8_t *dst) const {
+        uint64_t stored   = index[chunk + 1] - index[chunk];
+        uint64_t expected = std::min<uint64_t>(chunk_size, file_size - uint64_t(chunk) * chunk_size);
+
+        if (!stored) {
+            std::memset(dst, 0, chunk_size);
+            return true;
+        }
+
+        comp_buf.resize(stored);
+        stream->clear();
+        stream->seekg(index[chunk], std::ios::beg);
+        if (!stream->read(reinterpret_cast<char *>(comp_buf.data()), stored)) {
+            LOG_F(ERROR, "CompressedImg: chunk %u is truncated", chunk);
+            return false;
+        }
+
+        if (stored == expected) {
+            std::memcpy(dst, comp_buf.data(), stored);
+        } else if (!lz4_decode_block(comp_buf.data(), stored, dst, expected)) {
+            LOG_F(ERROR, "CompressedImg: chunk %u is corrupt", chunk);
+            return false;
+        }
+
+        if (expected < chunk_size)
+            std::memset(dst + expected, 0, chunk_size - expected);
+
+        return true;
+    }
+
+    mutable std::unique_ptr<std::ifstream> stream;
+    uint64_t                file_size  = 0;
+    uint32_t                chunk_size = 0;
+    uint32_t                num_chunks = 0;
+    std::vector<uint64_t>   index;
+
+    // decompressed chunk cache, most recently used first
+    size_t                  max_cached = 0;
+    mutable std::list<CachedChunk> lru;
+    mutable std::unordered_map<uint32_t, std::list<CachedChunk>::iterator> cache;
+    mutable std::vector<uint8_t>   comp_buf;
+};
+
+static bool is_compressed_img(const std::string &img_path) {
+    char magic[sizeof(CMP_MAGIC)] = {};
+
+    std::ifstream f(img_path, std::ios::binary);
+    return f.read(magic, sizeof(magic)) && !std::memcmp(magic, CMP_MAGIC, sizeof(magic));
+}
+
 static std::unique_ptr<ImgFileBackend> make_imgfile_backend(const std::string &img_path) {
     std::unique_ptr<ImgFileBackend> backend;
+    if (is_compressed_img(img_path)) {
+        backend = std::make_unique<CompressedImgBackend>();
+    } else
+#if DPPC_HAS_POSIX_IO
+    if (g_overlay_discard || !g_overlay_dir.empty()) {
+        backend = std::make_unique<OverlayBackend>(g_overlay_discard ? "" : g_overlay_dir);
+    } else
+#endif
     if (is_deterministic) {
 #if DPPC_HAS_PRIVATE_MMAP
         backend = std::make_unique<PrivateMmapBackend>();
         if (backend->open(img_path))
             return backend;
-        // Intentional fallthrough to MemoryStreamBackend if mmap fails.
+        // Use a discarded overlay instead if mmap fails.
+        backend = std::make_unique<OverlayBackend>("");
 #else
         backend = std::make_unique<MemoryStreamBackend>();
 #endif
     } else {
+#if DPPC_HAS_POSIX_IO
+        backend = std::make_unique<PosixFileBackend>();
+#else
         backend = std::make_unique<FileStreamBackend>();
+#endif
     }
 
     if (!backend->open(img_path)) {
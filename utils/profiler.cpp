@@ -83,7 +83,7 @@ void Profiler::print_profile(std::string name)
             break;
         case ProfileVarFmt::COUNT:
             std::cout << var.value << std::fixed << std::setprecision(2) << " ("
-                      << (double(var.value) / double(var.count_total) * 100)
+                      << (var.count_total ? double(var.value) / double(var.count_total) * 100 : 0.0)
                       << "%)" << std::endl;
             break;
         default: